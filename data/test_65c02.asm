@@ -0,0 +1,69 @@
+  CPU 65C02
+
+  ; STZ, TSB/TRB
+  LDA #$FF
+  STA $E0
+  STZ $E0
+  LDA $E0
+  OUT A
+
+  LDA #$0C
+  STA $E1
+  LDA #$03
+  TSB $E1
+  LDA $E1
+  OUT A
+  LDA #$04
+  TRB $E1
+  LDA $E1
+  OUT A
+
+  ; INC/DEC A
+  LDA #$7F
+  INC A
+  OUT AF
+  DEC
+  OUT AF
+
+  ; PHX/PHY/PLX/PLY
+  LDX #$12
+  LDY #$34
+  PHX
+  PHY
+  LDX #$00
+  LDY #$00
+  PLY
+  PLX
+  OUT X
+  OUT Y
+
+  ; (zp) indirect
+  LDA #$00
+  STA $E2
+  LDA #$03
+  STA $E3
+  LDA #$56
+  STA ($E2)
+  LDA #$00
+  LDA ($E2)
+  OUT A
+
+  ; BIT immediate
+  LDA #$0F
+  BIT #$F0
+  OUT AF
+
+  ; BRA
+  LDA #$01
+  BRA SKIP
+  LDA #$02
+SKIP:
+  OUT A
+
+  ; decimal mode N/Z from result
+  SED
+  CLC
+  LDA #$99
+  ADC #$01
+  OUT AF
+  CLD
@@ -0,0 +1,21 @@
+  ; forward label references (patched after assemble)
+  LDA table
+  OUT A
+  LDX #value
+  OUT X
+  LDA #$00
+  BEQ done
+  OUT A
+done:
+  JSR sub
+  BRK
+
+sub:
+  LDA table
+  OUT A
+  RTS
+
+table:
+  DB $5A,$A5
+
+define value $37
@@ -0,0 +1,8 @@
+  LDA #$37
+  OUT A
+
+LOOP:
+  LDA $FF
+  BEQ LOOP
+
+  OUT A
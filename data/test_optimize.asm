@@ -0,0 +1,57 @@
+  ; peephole optimizer patterns (run with and without -O for same output)
+
+  ; store then load (load removed)
+  LDA #$12
+  STA $E0
+  LDA $E0
+  LDX #$00
+  OUT A
+
+  ; increment memory (INC)
+  LDX #$41
+  STX $E1
+  LDA $E1
+  CLC
+  ADC #$01
+  STA $E1
+  LDA $E1
+  OUT A
+
+  ; decrement memory (DEC)
+  LDA $E1
+  SEC
+  SBC #1
+  STA $E1
+  LDA $E1
+  OUT A
+
+  ; flags needed (unchanged)
+  LDA $E1
+  CLC
+  ADC #$01
+  STA $E1
+  BCC skip
+  OUT A
+skip:
+
+  ; jump after known flag (branch)
+  CLC
+  JMP next
+  OUT A
+next:
+
+  ; call then return (tail jump)
+  JSR sub
+  LDA #$FF
+  OUT A
+
+  BRK
+
+sub:
+  LDA #$22
+  JSR sub1
+  RTS
+
+sub1:
+  OUT A
+  RTS
@@ -0,0 +1,165 @@
+  CPU 6502X
+
+  ; SLO $E0 (ASL + ORA)
+  LDA #$81
+  STA $E0
+  LDA #$01
+  DB $07,$E0
+  OUT AF
+  LDA $E0
+  OUT A
+
+  ; RLA $E0 (ROL + AND)
+  SEC
+  LDA #$41
+  STA $E0
+  LDA #$FF
+  DB $27,$E0
+  OUT AF
+
+  ; SRE $E0 (LSR + EOR)
+  LDA #$03
+  STA $E0
+  LDA #$FF
+  DB $47,$E0
+  OUT AF
+
+  ; RRA $E0 (ROR + ADC)
+  CLC
+  LDA #$02
+  STA $E0
+  LDA #$10
+  DB $67,$E0
+  OUT AF
+
+  ; SAX $E1 (store A AND X)
+  LDA #$F0
+  LDX #$3C
+  DB $87,$E1
+  LDA $E1
+  OUT A
+
+  ; LAX $E1 (LDA + LDX)
+  LDA #$00
+  LDX #$00
+  DB $A7,$E1
+  OUT A,X
+
+  ; DCP $E1 (DEC + CMP)
+  LDA #$2F
+  DB $C7,$E1
+  OUT AF
+
+  ; ISC $E1 (INC + SBC)
+  SEC
+  LDA #$40
+  DB $E7,$E1
+  OUT AF
+
+  ; ANC #$80
+  LDA #$F0
+  DB $0B,$80
+  OUT AF
+
+  ; ALR #$0F
+  LDA #$FF
+  DB $4B,$0F
+  OUT AF
+
+  ; ARR #$FF
+  CLC
+  LDA #$C0
+  DB $6B,$FF
+  OUT AF
+
+  ; AXS #$10
+  LDA #$F0
+  LDX #$3C
+  DB $CB,$10
+  OUT X
+
+  ; SBC #$01 ($EB)
+  SEC
+  LDA #$10
+  DB $EB,$01
+  OUT AF
+
+  ; LAS $0300,Y
+  LDA #$5A
+  STA $0300
+  LDY #$00
+  TSX
+  DB $BB,$00,$03
+  OUT A,X
+
+  ; continue above zero page scratch bytes
+  JMP UNSTABLE
+
+  ORG $0400
+
+UNSTABLE:
+  ; XAA #$F0 (A = (A OR $EE) AND X AND immediate)
+  LDA #$11
+  LDX #$7C
+  DB $8B,$F0
+  OUT AF
+
+  ; LAX #$0F (A = X = (A OR $EE) AND immediate)
+  LDA #$00
+  DB $AB,$0F
+  OUT A,X
+
+  ; SHY $1200,X (store Y AND $13)
+  LDY #$FF
+  LDX #$01
+  DB $9C,$00,$12
+  LDA $1201
+  OUT A
+
+  ; SHY $12F0,X (page cross so address high byte is stored value, $0310)
+  LDY #$03
+  LDX #$20
+  DB $9C,$F0,$12
+  LDA $0310
+  OUT A
+
+  ; SHX $12F1,Y (page cross, $0311)
+  LDX #$07
+  LDY #$20
+  DB $9E,$F1,$12
+  LDA $0311
+  OUT A
+
+  ; AHX $12F2,Y (store A AND X AND $13, page cross, $0312)
+  LDA #$FF
+  LDX #$0F
+  DB $9F,$F2,$12
+  LDA $0312
+  OUT A
+
+  ; AHX ($E2),Y ($12F3 + Y, page cross, $0313)
+  LDA #$F3
+  STA $E2
+  LDA #$12
+  STA $E3
+  LDA #$FF
+  LDX #$0B
+  DB $93,$E2
+  LDA $0313
+  OUT A
+
+  ; TAS $12F4,Y (SP = A AND X, store SP AND $13, page cross, $1114)
+  LDA #$F5
+  LDX #$3D
+  DB $9B,$F4,$12
+  TSX
+  TXA
+  LDX #$FF
+  TXS
+  OUT A
+  LDA $1114
+  OUT A
+
+  ; KIL (CPU stops)
+  DB $02
+  OUT A
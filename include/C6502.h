@@ -1,14 +1,21 @@
 #ifndef C6502_H
 #define C6502_H
 
+#include <C6502Output.h>
+#include <C6502Device.h>
+
+#include <deque>
 #include <map>
 #include <set>
+#include <string_view>
 #include <vector>
 #include <iostream>
 #include <iomanip>
 #include <cstring>
 #include <cassert>
 #include <algorithm>
+#include <functional>
+#include <limits>
 
 class C6502 {
  public:
@@ -55,11 +62,48 @@ class C6502 {
   bool isUnsupported() const { return unsupported_; }
   void setUnsupported(bool b) { unsupported_ = b; }
 
+  // CPU model (each has its own instruction dispatch)
+  //  NMOS : 6502 (undocumented opcodes when unsupported enabled, e.g. 6510 or
+  //         'CPU 6502X' assembler directive)
+  //  CMOS : 65C02 (STZ, BRA, PHX/PHY/PLX/PLY, (zp), TSB/TRB, INC/DEC A, ...)
+  //  R2A03: NES 2A03 (6502 without decimal mode)
+  enum class Variant { NMOS, CMOS, R2A03 };
+
+  Variant variant() const { return variant_; }
+  void setVariant(Variant variant);
+
+  static constexpr bool hasDecimal(Variant variant) { return variant != Variant::R2A03; }
+
+  // decimal mode ADC/SBC flags (set from variant)
+  //  NMOS: ADC N/V from result before high digit adjust and Z from binary add,
+  //        SBC flags from binary subtract
+  //  CMOS: N/Z from decimal result
+  enum class DecimalMode { NMOS, CMOS };
+
+  // decimal mode result (N/V/Z/C flags)
+  struct BcdResult {
+    uchar res   { 0 };
+    uchar flags { 0 };
+  };
+
+  DecimalMode decimalMode() const { return decimalMode_; }
+  void setDecimalMode(DecimalMode mode);
+
+  // decimal mode results from lookup tables (default) or calculated each time
+  bool isDecimalTables() const { return decimalTables_; }
+  void setDecimalTables(bool b) { decimalTables_ = b; }
+
+  bool isIdleSkip() const { return idleSkip_; }
+  void setIdleSkip(bool b) { idleSkip_ = b; idle_.set = false; }
+
   bool isEnableOutputProcs() const { return enableOutputProcs_; }
-  void setEnableOutputProcs(bool b) { enableOutputProcs_ = b; }
+  void setEnableOutputProcs(bool b);
 
   bool inNMI() const { return inNMI_; }
 
+  // buffered output of OUT procs (flushed at halt/break or when full)
+  C6502Output &output() { return output_; }
+
   //------
 
   // Registers
@@ -144,28 +188,78 @@ class C6502 {
 
   inline void incT(uchar n) { t_ += n; tick(n); }
 
+  inline ulong t() const { return t_; }
+
   virtual void tick(uchar) { }
 
   //------
 
+  // Events (procs scheduled to run when cycle count reaches a given t)
+
+  using EventProc = std::function<void()>;
+
+  // schedule proc at absolute cycle t (returns id for cancel)
+  uint addEvent(ulong t, const EventProc &proc);
+
+  // schedule proc dt cycles from now
+  uint addEventIn(ulong dt, const EventProc &proc) { return addEvent(t_ + dt, proc); }
+
+  bool cancelEvent(uint id);
+
+  void clearEvents();
+
+  bool hasEvents() const { return ! events_.empty(); }
+
+  // cycle of next scheduled event (max ulong if none)
+  ulong nextEventT() const { return nextEventT_; }
+
+  void processEvents();
+
+  //------
+
   // Memory
 
-  inline uchar sumBytes(uchar c1, uchar c2) { return (c1 + c2) & 0xFF; }
+  inline uchar sumBytes(uchar c1, uchar c2) const { return (c1 + c2) & 0xFF; }
 
-  inline uchar readByte() { return readByte(PC_); }
+  inline uchar readByte() { return loadByte(PC_++); }
 
   inline uchar readByte(ushort &addr) const { return getByte(addr++); }
 
   inline schar readSByte() { return readSByte(PC_); }
   inline schar readSByte(ushort &addr) const { return schar(readByte(addr)); }
 
-  inline ushort readWord() { return readWord(PC_); }
+  inline ushort readWord() { uchar lo = readByte(); return ushort(lo | (readByte() << 8)); }
   inline ushort readWord(ushort &addr) const { return (readByte(addr) | (readByte(addr) << 8)); }
 
   inline ushort getWord(ushort addr) const { return (getByte(addr) | (getByte(addr + 1) << 8)); }
 
-  virtual uchar getByte(ushort addr) const { return mem_[addr]; }
-  virtual void  setByte(ushort addr, uchar c) { mem_[addr] = c; memChanged(addr, 1); }
+  // memory contents (no device side effects, used by tools and debugger)
+  virtual uchar getByte(ushort addr) const {
+    if (pageFlags_[addr >> 8] & PAGE_DEVICE) return peekDeviceByte(addr);
+
+    return mem_[addr];
+  }
+
+  // byte read by executing instruction (device read can have side effects)
+  inline uchar loadByte(ushort addr) {
+    if (pageFlags_[addr >> 8] & (PAGE_DEVICE | PAGE_VOLATILE)) return loadVolatileByte(addr);
+
+    return getByte(addr);
+  }
+
+  inline ushort loadWord(ushort addr) {
+    uchar lo = loadByte(addr); return ushort(lo | (loadByte(addr + 1) << 8)); }
+  virtual void  setByte(ushort addr, uchar c) { storeByte(addr, c); memChanged(addr, 1); }
+
+  // store byte in memory (counts actual changes, pages with flags use slow path)
+  inline void storeByte(ushort addr, uchar c) {
+    if (pageFlags_[addr >> 8]) { storePageByte(addr, c); return; }
+
+    if (mem_[addr] != c) { mem_[addr] = c; ++memChanges_; }
+  }
+
+  // number of memory bytes changed
+  ulong memChanges() const { return memChanges_; }
 
   inline void setWord(ushort addr, ushort c) {
     setByte(addr, uchar(c & 0xFF)); setByte(addr + 1, uchar(c >> 8)); }
@@ -175,7 +269,7 @@ class C6502 {
 
   inline uchar getSPByte(uchar sp) const { return getByte(0x0100 | sp); }
 
-  inline uchar  popByte() { setSP(SP() + 1); return getByte(0x0100 | SP()); }
+  inline uchar  popByte() { setSP(SP() + 1); return loadByte(0x0100 | SP()); }
   inline ushort popWord() { return (popByte() | (popByte() << 8)); }
 
   inline uchar peekByte() { return getByte(0x0100 | sumBytes(SP(), 1)); }
@@ -186,16 +280,33 @@ class C6502 {
 //inline ushort memAddr(ushort addr) { return getWord(addr); }
 
   inline uchar memIndexedIndirectX(uchar c) {
-    return getByte(getWord(sumBytes(c, X()))); }
+    return loadByte(loadWord(sumBytes(c, X()))); }
   inline void setMemIndexedIndirectX(uchar c, uchar v) {
-    return setByte(getWord(sumBytes(c, X())), v); }
+    return setByte(loadWord(sumBytes(c, X())), v); }
 
-  inline uchar memIndirectIndexedY(uchar c) { return getByte(getWord(c) + Y()); }
-  inline void setMemIndirectIndexedY(uchar c, uchar v) { return setByte(getWord(c) + Y(), v); }
+  inline uchar memIndirectIndexedY(uchar c) { return loadByte(loadWord(c) + Y()); }
+  inline void setMemIndirectIndexedY(uchar c, uchar v) { return setByte(loadWord(c) + Y(), v); }
 
   // store len bytes of data at 'data' in CPU at address 'addr'
   virtual void memset(ushort addr, const uchar *data, ushort len) {
-    std::memcpy(&mem_[addr], data, len); memChanged(addr, len);
+    if (isPageTracking()) prepareWritePages(addr, len);
+
+    std::memcpy(&mem_[addr], data, len); ++memChanges_;
+
+    if (! devices_.empty()) resetDevices(addr, len);
+
+    memChanged(addr, len);
+  }
+
+  // clear all memory
+  void clearMemory() {
+    if (isPageTracking()) prepareWritePages(0, 0x10000);
+
+    std::memset(&mem_[0], 0, 0x10000*sizeof(mem_[0])); ++memChanges_;
+
+    if (! devices_.empty()) resetDevices(0, 0x10000);
+
+    memChanged(0, 0xFFFF);
   }
 
   // get len bytes in 'data' from CPU memory at address 'addr'
@@ -207,6 +318,22 @@ class C6502 {
 
   //---
 
+  // Devices (called for reads/writes in address range, not owned, len 0 for
+  // checkpoint hooks only)
+  void addDevice(C6502Device *device, ushort addr, uint len);
+  void removeDevice(C6502Device *device);
+
+  bool hasDevices() const { return ! devices_.empty(); }
+
+  // device range includes address
+  bool hasDevice(ushort addr) const;
+
+  // memory which changes without CPU writes (e.g. timer or raster registers).
+  // A loop which reads it (or a device) is never skipped as idle
+  void setVolatile(ushort addr, uint len);
+
+  //---
+
   void addByte(ushort &addr, uchar c) { setByte(addr++, c); };
 
   void addWord(ushort &addr, ushort c) {
@@ -227,7 +354,7 @@ class C6502 {
     uchar c = A();           bool C = aslCalc(c); setA(c);          setNZCFlags(c, C); }
 
   inline void aslMemOp(ushort addr) {
-    uchar c = getByte(addr); bool C = aslCalc(c); setByte(addr, c); setNZCFlags(c, C); }
+    uchar c = loadByte(addr); bool C = aslCalc(c); setByte(addr, c); setNZCFlags(c, C); }
 
   inline bool aslCalc(uchar &c) { bool C = (c & 0x80); c <<= 1; return C; }
 
@@ -235,7 +362,7 @@ class C6502 {
   inline void lsrAOp() {
     uchar c = A();           bool C = lsrCalc(c); setA(c);          setNZCFlags(c, C); }
   inline void lsrMemOp(ushort addr) {
-    uchar c = getByte(addr); bool C = lsrCalc(c); setByte(addr, c); setNZCFlags(c, C); }
+    uchar c = loadByte(addr); bool C = lsrCalc(c); setByte(addr, c); setNZCFlags(c, C); }
 
   inline bool lsrCalc(uchar &c) { bool C = c & 0x01; c >>= 1; return C; }
 
@@ -244,7 +371,7 @@ class C6502 {
     uchar c = A();           bool C = rolCalc(c); setA(c);          setNZCFlags(c, C); }
 
   inline void rolMemOp(ushort addr) {
-    uchar c = getByte(addr); bool C = rolCalc(c); setByte(addr, c); setNZCFlags(c, C); }
+    uchar c = loadByte(addr); bool C = rolCalc(c); setByte(addr, c); setNZCFlags(c, C); }
 
   inline bool rolCalc(uchar &c) {
     bool C1 = Cflag();    // save old carry flag
@@ -260,7 +387,7 @@ class C6502 {
     uchar c = A();           bool C = rorCalc(c); setA(c);          setNZCFlags(c, C); }
 
   inline void rorMemOp(ushort addr) {
-    uchar c = getByte(addr); bool C = rorCalc(c); setByte(addr, c); setNZCFlags(c, C); }
+    uchar c = loadByte(addr); bool C = rorCalc(c); setByte(addr, c); setNZCFlags(c, C); }
 
   inline bool rorCalc(uchar &c) {
     bool C1 = Cflag();    // save old carry flag
@@ -289,117 +416,62 @@ class C6502 {
 
   // Add with carry
 
+  template<Variant V=Variant::NMOS>
   inline void adcOp(uchar c) {
-    if (Dflag()) {
-      bool   C   = Cflag();
-      ushort res = bcdAdd(A(), c, C);
-      bool   V   = (res & 0x80);
+    if (hasDecimal(V) && Dflag()) {
+      bcdAdcOp(c);
 
-      setA(uchar(res)); setNZCVFlags(C, V);
-    }
-    else {
-      bool   C   = Cflag();
-      ushort res = ushort(A() + c + C);
-
-      C = res > 0xFF;
-
-      bool V = ~(A() ^ c) & (A() ^ res) & 0x80;
-
-      setA(uchar(res)); setNZCVFlags(C, V);
+      if (V == Variant::CMOS) incT(1);
     }
+    else
+      binAdcOp(c);
   }
 
-  inline ushort bcdAdd(uchar a, uchar b, bool &c) {
-    uchar t1 = (a & 0xF0) >> 4; uchar u1 = (a & 0x0F);
-    uchar t2 = (b & 0xF0) >> 4; uchar u2 = (b & 0x0F);
+  inline void binAdcOp(uchar c) {
+    bool   C   = Cflag();
+    ushort res = ushort(A() + c + C);
 
-    uchar t = t1 + t2;
-    uchar u = uchar(u1 + u2 + c);
+    C = res > 0xFF;
 
-    if (u >= 10) {
-      ++t; u -= 10;
-    }
+    bool V = ~(A() ^ c) & (A() ^ res) & 0x80;
 
-    c = false;
-
-    if (t >= 10) {
-      t -= 10;
-
-      c = true;
-    }
-
-    return (((t & 0x0F) << 4) | (u & 0x0F));
+    setA(uchar(res)); setNZCVFlags(C, V);
   }
 
+  // decimal add (table lookup for decimal mode)
+  inline void bcdAdcOp(uchar c) {
+    if (decimalTables_)
+      setBcdResult(bcdAdc_[bcdIndex(c)]);
+    else
+      setBcdResult(bcdCalc(false, decimalMode_, A(), c, Cflag()));
+  }
   //---
 
   // Substract with carry
 
+  template<Variant V=Variant::NMOS>
   inline void sbcOp(uchar c) {
-    if (Dflag()) {
-      bool  C   = ! Cflag();
-      uchar res = bcdSub(A(), c, C);
-      bool  V   = false; // TODO
+    if (hasDecimal(V) && Dflag()) {
+      bcdSbcOp(c);
 
-      setA(res); setNZCVFlags(C, V);
-    }
-    else {
-/*
-      bool  C  = ! Cflag();
-      schar a  = A();
-      schar c1 = c;
-
-      int res1 = a - (c1 + C);
-
-      uchar res = res1;
-
-      C = (res1 >= 0);
-
-      bool V = (res1 < -128 || res1 > 127);
-
-      setA(res); setNZCVFlags(C, V);
-*/
-      return adcOp(~c);
+      if (V == Variant::CMOS) incT(1);
     }
+    else
+      binAdcOp(uchar(~c));
   }
 
-  inline uchar bcdSub(uchar a, uchar b, bool &c) {
-    uchar t1 = (a & 0xF0) >> 4; uchar u1 = (a & 0x0F);
-    uchar t2 = (b & 0xF0) >> 4; uchar u2 = (b & 0x0F);
-
-    schar t, u;
-
-    if (a >= b + c) {
-      t = schar(t1 - t2);
-      u = schar(u1 - u2 - c);
-
-      if (u < 0) {
-        --t; u += 10;
-      }
-
-      assert(t >= 0);
-
-      c = true;
-    }
-    else {
-      t = schar(t2 - t1);
-      u = schar(u2 - u1);
-
-      if (u < 0) {
-        --t; u += 10;
-      }
-
-      assert(t >= 0);
-
-      t = 9 - t;
-
-      if (u > 0)
-        u = 10 - u;
+  // decimal subtract (table lookup for decimal mode)
+  inline void bcdSbcOp(uchar c) {
+    if (decimalTables_)
+      setBcdResult(bcdSbc_[bcdIndex(c)]);
+    else
+      setBcdResult(bcdCalc(true, decimalMode_, A(), c, Cflag()));
+  }
 
-      c = true;
-    }
+  inline uint bcdIndex(uchar c) const { return (uint(Cflag()) << 16) | (uint(A()) << 8) | c; }
 
-    return uchar(((t & 0x0F) << 4) | (u & 0x0F));
+  inline void setBcdResult(const BcdResult &r) {
+    setA(r.res); setSR(uchar((SR() & ~0xC3) | r.flags));
   }
 
   //---
@@ -438,6 +510,127 @@ class C6502 {
 
   //------
 
+  // State (registers, cycle count, interrupt state and memory)
+  // Note: events, traps and breakpoints are host configuration and are not saved
+
+  struct State {
+    ushort PC { 0 };
+    uchar  A  { 0 };
+    uchar  X  { 0 };
+    uchar  Y  { 0 };
+    uchar  SR { 0 };
+    uchar  SP { 0xFF };
+    ulong  t  { 0 };
+
+    bool inNMI      { false };
+    bool inIRQ      { false };
+    bool inBRK      { false };
+    uint irqLines   { 0 };
+    bool nmiLine    { false };
+    bool nmiPending { false };
+
+    std::vector<uchar> mem;
+  };
+
+  void saveState(State &state) const;
+  void restoreState(const State &state);
+
+  // registers/interrupt state only (state memory not used)
+  void saveRegs(State &state) const;
+  void restoreRegs(const State &state);
+
+  bool saveState(const std::string &filename) const;
+  bool loadState(const std::string &filename);
+
+  //---
+
+  // Checkpoint (single copy on write snapshot for run-ahead, rollback, ...)
+  //  Memory pages are saved on their first write after the checkpoint is set so
+  //  restore only copies back the pages written since. Also saves halt state and
+  //  pending events (events run after the checkpoint are run again after restore)
+  //  and calls device checkpoint hooks.
+  void setCheckpoint();
+  bool restoreCheckpoint();
+  void clearCheckpoint();
+
+  bool hasCheckpoint() const { return checkpoint_.set; }
+
+  // number of pages written since checkpoint set/restored
+  uint numCheckpointPages() const { return uint(checkpoint_.saved.size()); }
+
+  //---
+
+  // Dirty page tracking (pages written since last clearDirtyPages)
+  bool isTrackDirtyPages() const { return trackDirty_; }
+  void setTrackDirtyPages(bool b);
+
+  bool isDirtyPage(uint page) const {
+    return trackDirty_ && ! (pageFlags_[page & 0xFF] & PAGE_CLEAN); }
+
+  const std::vector<uchar> &dirtyPages() const { return dirtyPages_; }
+
+  // mark page dirty (e.g. page changed relative to a rolled back copy)
+  void setDirtyPage(uint page) { dirtyPage(page & 0xFF); }
+
+  void clearDirtyPages();
+
+  //---
+
+  // Memory hashing (Zobrist style hash per page updated from write path)
+  //  Note: when enabled all writes take the page slow path
+  bool isHashMemory() const { return hashMem_; }
+  void setHashMemory(bool b);
+
+  // hash of page and of all memory (XOR of page hashes)
+  ulong pageHash(uint page) const;
+  ulong memHash() const;
+
+  // hash of memory and registers (PC, A, X, Y, SR, SP, not cycle count)
+  ulong stateHash() const;
+
+  // pages whose hashes differ between CPUs (both must be hashing memory)
+  uint diffPages(const C6502 &cpu, std::vector<uchar> &pages) const;
+
+  //---
+
+  // Write journal (address and value of every CPU memory write, not bulk writes)
+  //  Note: when enabled all writes take the page slow path
+  struct JournalEntry {
+    ushort addr  { 0 };
+    uchar  value { 0 };
+
+    JournalEntry(ushort addr1=0, uchar value1=0) :
+     addr(addr1), value(value1) {
+    }
+
+    bool operator==(const JournalEntry &e) const { return addr == e.addr && value == e.value; }
+    bool operator!=(const JournalEntry &e) const { return ! (*this == e); }
+  };
+
+  using Journal = std::vector<JournalEntry>;
+
+  bool isWriteJournal() const { return journalOn_; }
+  void setWriteJournal(bool b);
+
+  const Journal &writeJournal() const { return journal_; }
+
+  void clearWriteJournal() { journal_.clear(); }
+
+  //---
+
+  // hash of byte value at address
+  static ulong byteHash(ushort addr, uchar c) {
+    // splitmix64 finalizer
+    ulong z = ((ulong(addr) << 8) | c) + 0x9E3779B97F4A7C15UL;
+
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9UL;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBUL;
+
+    return z ^ (z >> 31);
+  }
+
+  //------
+
   // System vectors
 
   // Non-Maskable Interrupt Hardware Vector
@@ -460,15 +653,72 @@ class C6502 {
 
   //------
 
+  // Interrupt lines (sampled between instructions)
+
+  // IRQ is level triggered : taken while any source holds its line and I flag is clear
+  void setIRQLine(uint source, bool b) {
+    uint mask = (1U << source);
+
+    irqLines_ = (b ? irqLines_ | mask : irqLines_ & ~mask);
+
+    updateIntPending();
+  }
+
+  bool isIRQLine() const { return irqLines_ != 0; }
+  bool isIRQLine(uint source) const { return irqLines_ & (1U << source); }
+
+  // NMI is edge triggered : taken once on inactive to active transition
+  void setNMILine(bool b) {
+    if (b && ! nmiLine_)
+      nmiPending_ = true;
+
+    nmiLine_ = b;
+
+    updateIntPending();
+  }
+
+  bool isNMILine() const { return nmiLine_; }
+
+  // pulse NMI line
+  void triggerNMI() { setNMILine(true); setNMILine(false); }
+
+  bool isIntPending() const { return intPending_; }
+
+  void processInterrupts();
+
+  //------
+
   // assemble
 
   bool assemble(ushort addr, std::istream &is, ushort &len);
 
+  // assemble file (mapped into memory)
+  bool assembleFile(ushort addr, const std::string &filename, ushort &len);
+
+  // peephole optimize source before assemble (reports changes and cycles/bytes saved)
+  bool isOptimize() const { return optimize_; }
+  void setOptimize(bool b) { optimize_ = b; }
+
+  // labels from last assemble (name to address and value length)
+  struct AddrLen {
+    ushort addr { 0 };
+    uchar  len  { 0 };
+
+    AddrLen(ushort addr1=0, uchar len1=0) :
+     addr(addr1), len(len1) {
+    }
+  };
+
+  // transparent compare so lookup by string view does not allocate
+  using Labels = std::map<std::string,AddrLen,std::less<>>;
+
+  const Labels &labels() const { return labels_; }
+
   //------
 
   // run
 
-  void step();
+  void step() { (this->*stepProc_)(); }
 
   bool next();
 
@@ -477,6 +727,8 @@ class C6502 {
 
   bool cont();
 
+  bool contCycles(ulong n);
+
   virtual void update();
 
   //------
@@ -576,37 +828,87 @@ class C6502 {
 
   virtual void jumpPointHit(uchar /*inst*/) { }
 
+  //------
+
+  // traps (host procs run in place of 6502 routine when JSR/JMP to address)
+
+  // proc returns cycles used, or -1 to run the 6502 code at the address instead
+  using TrapProc = std::function<int(C6502 &)>;
+
+  bool addTrap(ushort addr, const TrapProc &proc);
+
+  void removeTrap(ushort addr);
+
+  void removeAllTraps();
+
+  bool isTrap(ushort addr) const { return trapInd_[addr] != 0; }
+
+  // inline operand bytes after JSR to trap (skipped by OUT procs on return)
+  uint trapInlineLen(ushort addr) const;
+
+  // address trapped routine returns to (from return address on stack)
+  ushort trapReturnAddr() const {
+    return ushort((getSPByte(sumBytes(SP(), 1)) | (getSPByte(sumBytes(SP(), 2)) << 8)) + 1);
+  }
+
+  // change address trapped routine returns to (e.g. to skip inline args)
+  void setTrapReturnAddr(ushort addr) {
+    ushort a = ushort(addr - 1);
+
+    setByte(0x0100 | sumBytes(SP(), 1), uchar(a & 0xFF));
+    setByte(0x0100 | sumBytes(SP(), 2), uchar(a >> 8));
+  }
+
  private:
   // get byte from zero page using offset from next byte
-  inline uchar getZeroPage() { return getByte(readByte()); }
+  inline uchar getZeroPage() { return loadByte(readByte()); }
   // set byte in zero page using offset from next byte
   inline void setZeroPage(uchar c) { setByte(readByte(), c); }
 
   // get byte from zero page using offset from next byte and X register
-  inline uchar getZeroPageX() { return getByte(sumBytes(readByte(), X())); }
+  inline uchar getZeroPageX() { return loadByte(sumBytes(readByte(), X())); }
   inline void setZeroPageX(uchar c) { setByte(sumBytes(readByte(), X()), c); }
 
   // get byte from zero page using offset from next byte and Y register
-  inline uchar getZeroPageY() { return getByte(sumBytes(readByte(), Y())); }
+  inline uchar getZeroPageY() { return loadByte(sumBytes(readByte(), Y())); }
   inline void setZeroPageY(uchar c) { setByte(sumBytes(readByte(), Y()), c); }
 
   // get byte from read address
-  inline uchar getAbsolute() { return getByte(readWord()); }
+  inline uchar getAbsolute() { return loadByte(readWord()); }
   inline void setAbsolute(uchar c) { setByte(readWord(), c); }
 
+  // index address for read (extra cycle if index crosses page)
+  inline ushort indexReadAddr(ushort addr, uchar ind) {
+    ushort addr1 = ushort(addr + ind);
+
+    if ((addr ^ addr1) & 0xFF00) incT(1);
+
+    return addr1;
+  }
+
+  // taken branch (extra cycle, and another if branch crosses page)
+  inline void branchTo(schar d) {
+    ushort pc = ushort(PC() + d);
+
+    incT(((PC() ^ pc) & 0xFF00) ? 2 : 1);
+
+    setPC(pc);
+  }
+
   // get byte from read address offset by X register
-  inline uchar getAbsoluteX() { return getByte(readWord() + X()); }
+  inline uchar getAbsoluteX() { return loadByte(indexReadAddr(readWord(), X())); }
   inline void setAbsoluteX(uchar c) { setByte(readWord() + X(), c); }
 
   // get byte from read address offset by Y register
-  inline uchar getAbsoluteY() { return getByte(readWord() + Y()); }
+  inline uchar getAbsoluteY() { return loadByte(indexReadAddr(readWord(), Y())); }
   inline void setAbsoluteY(uchar c) { setByte(readWord() + Y(), c); }
 
   // get byte from memory address at zero page address (from next byte plus X register)
   inline uchar getMemIndexedIndirectX() { return memIndexedIndirectX(readByte()); }
 
   // get byte from memory address at zero page address (from next byte) plus Y register
-  inline uchar getMemIndirectIndexedY() { return memIndirectIndexedY(readByte()); }
+  inline uchar getMemIndirectIndexedY() {
+    return loadByte(indexReadAddr(loadWord(readByte()), Y())); }
 
   //---
 
@@ -626,22 +928,60 @@ class C6502 {
     A
   };
 
-  using Lines = std::vector<std::string>;
+  // mnemonic and directive ids (source word looked up once per line)
+  enum class AsmOp {
+    NONE,
+
+    // directives
+    DEFINE, ORG, CPU, DB, OUT, OUTN, OUTS,
+
+    // instructions
+    ADC, AND, ASL, BCC, BCS, BEQ, BIT, BMI, BNE, BPL, BRA, BRK, BVC, BVS,
+    CLC, CLD, CLI, CLV, CMP, CPX, CPY, DEC, DEX, DEY, EOR, INC, INX, INY,
+    JMP, JSR, LDA, LDX, LDY, LSR, NOP, ORA, PHA, PHP, PHX, PHY, PLA, PLP,
+    PLX, PLY, ROL, ROR, RTI, RTS, SBC, SEC, SED, SEI, STA, STX, STY, STZ,
+    TAX, TAY, TRB, TSB, TSX, TXA, TXS, TYA
+  };
+
+  // id of mnemonic or directive (case insensitive, NONE if unknown)
+  static AsmOp lookupAsmOp(std::string_view word);
+
+  // source lines (views into source text)
+  using Lines = std::vector<std::string_view>;
+
+  void readLines(std::string_view source, Lines &lines);
+
+  // assemble source lines
+  bool assembleSource(ushort addr, Lines &lines, ushort &len);
 
-  void readLines(std::istream &is, Lines &lines);
+  using LineAddrs = std::vector<ushort>;
 
-  bool assembleLines(ushort &addr, const Lines &lines);
+  bool assembleLines(ushort &addr, const Lines &lines, LineAddrs *lineAddrs=nullptr);
 
-  bool assembleLine(ushort &addr, const std::string &line);
+  // optimized lines text (referenced by lines)
+  using Strings = std::deque<std::string>;
 
-  bool assembleOp(ushort &addr, const std::string &opName, const std::string &arg);
+  void optimizeLines(ushort addr, Lines &lines, Strings &strs);
 
-  bool decodeAssembleArg(const std::string &arg, ArgMode &mode, XYMode &xyMode,
+  bool assembleLine(ushort &addr, std::string_view line);
+
+  bool assembleOp(ushort &addr, AsmOp op, std::string_view opName, std::string_view arg);
+
+  bool decodeAssembleArg(std::string_view arg, ArgMode &mode, XYMode &xyMode,
                          ushort &value, uchar &vlen);
 
   void clearLabels();
-  void setLabel(const std::string &name, ushort addr, uchar len);
-  bool getLabel(const std::string &name, ushort &addr, uchar &len) const;
+  void setLabel(std::string_view name, ushort addr, uchar len);
+  bool getLabel(std::string_view name, ushort &addr, uchar &len) const;
+
+  // forward label references (operand patched when all labels known)
+  enum class FixupKind { BYTE, WORD, RELATIVE };
+
+  bool lookupLabel(std::string_view name, ushort &value, uchar &len);
+
+  void addFixup(ushort addr, FixupKind kind);
+
+  void applyFixups();
 
   //---
 
@@ -651,6 +991,81 @@ class C6502 {
 
   //---
 
+  // check for idle loop (called at target of backward jump/branch)
+  inline void checkIdleLoop() {
+    if (idle_.set && PC_ == idle_.pc && memChanges_ == idle_.memChanges &&
+        volatileReads_ == idle_.volatileReads &&
+        A_ == idle_.A && X_ == idle_.X && Y_ == idle_.Y && SR_ == idle_.SR && SP_ == idle_.SP) {
+      idleLoop();
+    }
+    else {
+      idle_.set = true; idle_.pc = PC_; idle_.memChanges = memChanges_;
+      idle_.volatileReads = volatileReads_;
+      idle_.A  = A_ ; idle_.X = X_; idle_.Y = Y_; idle_.SR = SR_; idle_.SP = SP_;
+    }
+  }
+
+  void idleLoop();
+
+  // run trap proc at PC and return from routine (false if proc declined)
+  bool callTrap(uchar ind);
+
+  int outTrap    (bool nl);
+  int outMemTrap (bool nl);
+  int outStrTrap ();
+
+  // store byte on page with flags (checkpoint and/or device)
+  void storePageByte(ushort addr, uchar c);
+
+  // save page to checkpoint (if not already saved)
+  void checkpointPage(uint page);
+
+  // mark page dirty (if tracked and clean)
+  void dirtyPage(uint page) {
+    if (pageFlags_[page] & PAGE_CLEAN) { dirtyPages_.push_back(uchar(page)); pageFlags_[page] &= ~PAGE_CLEAN; }
+  }
+
+  // checkpoint/mark dirty/invalidate hash of pages before bulk write
+  void prepareWritePages(ushort addr, uint len);
+
+  bool isPageTracking() const { return checkpoint_.set || trackDirty_ || hashMem_; }
+
+  // update hashes for byte change
+  void hashByte(ushort addr, uchar oldC, uchar c) {
+    ulong d = byteHash(addr, oldC) ^ byteHash(addr, c);
+
+    pageHash_[addr >> 8] ^= d; memHash_ ^= d;
+  }
+
+  void invalidatePageHash(uint page) {
+    if (! hashStale_[page]) { hashStale_[page] = 1; ++numHashStale_; }
+  }
+
+  void updateStaleHashes() const;
+
+  // load byte on device page (value from first device in range which serves it)
+  uchar loadDeviceByte(ushort addr) const;
+
+  // inspect byte on device page (no side effects)
+  uchar peekDeviceByte(ushort addr) const;
+
+  // load byte on device or volatile page (counted for idle loop check)
+  uchar loadVolatileByte(ushort addr);
+
+  // store byte on device page and notify devices in range
+  void storeDeviceByte(ushort addr, uchar c);
+
+  // notify devices overlapping range of bulk memory change
+  void resetDevices(ushort addr, uint len);
+
+  void updateIntPending() { intPending_ = (nmiPending_ || irqLines_ != 0); }
+
+  void updateNextEventT() {
+    nextEventT_ = (! events_.empty() ? events_.front().t : std::numeric_limits<ulong>::max());
+  }
+
+  //---
+
   void outputHex02(std::ostream &os, uchar value) const {
     os << std::setfill('0') << std::setw(2) << std::right << std::hex << int(value);
   }
@@ -677,10 +1092,102 @@ class C6502 {
 
   //---
 
+  // decimal mode result tables indexed by (C, A, operand)
+  static const BcdResult *bcdTable(bool sub, DecimalMode mode);
+
+  // decimal mode result of A + b + C (or A - b - !C)
+  static BcdResult bcdCalc(bool sub, DecimalMode mode, int a, int b, bool C);
+
+  // instruction dispatch for variant
+  using StepProc = void (C6502::*)();
+
+  template<Variant V> void stepVariant();
+
+  template<Variant V> void stepUndocumented(uchar c);
+
+  void stepCMOS(uchar c);
+
+  Variant  variant_  { Variant::NMOS };
+  StepProc stepProc_ { nullptr };
+
+  DecimalMode      decimalMode_ { DecimalMode::NMOS };
+  const BcdResult *bcdAdc_      { nullptr };
+  const BcdResult *bcdSbc_      { nullptr };
+  bool             decimalTables_ { true };
+
+  //---
+
   // memory
   //  stack: 0x0100 to 0x01FF
   uchar mem_[0x10000];
 
+  ulong memChanges_ { 0 };
+
+  // number of device/volatile memory reads by executed instructions
+  ulong volatileReads_ { 0 };
+
+  //---
+
+  // devices (count of devices per 256 byte page)
+  struct DeviceRange {
+    C6502Device *device { nullptr };
+    ushort       addr   { 0 };
+    uint         len    { 0 };
+  };
+
+  using Devices = std::vector<DeviceRange>;
+
+  Devices devices_;
+  uchar   devicePages_[0x100];
+
+  //---
+
+  // page flags (non-zero flags take slow path on write)
+  enum PageFlag : uchar {
+    PAGE_DEVICE     = 0x01, // device on page
+    PAGE_CHECKPOINT = 0x02, // page not yet saved in checkpoint
+    PAGE_CLEAN      = 0x04, // page not written since dirty pages cleared
+    PAGE_HASH       = 0x08, // page hash updated on write
+    PAGE_JOURNAL    = 0x10, // writes added to journal
+    PAGE_VOLATILE   = 0x20  // reads change without writes (see setVolatile)
+  };
+
+  uchar pageFlags_[0x100];
+
+  //---
+
+  // checkpoint (registers in state, saved pages in 64K page area)
+  struct Checkpoint {
+    bool               set  { false };
+    bool               halt { false };
+    State              state;
+    std::vector<uchar> pages;
+    std::vector<uchar> saved;
+  };
+
+  Checkpoint checkpoint_;
+
+  //---
+
+  // dirty pages (in write order)
+  bool               trackDirty_ { false };
+  std::vector<uchar> dirtyPages_;
+
+  //---
+
+  // memory hashes (stale pages recalculated on access after bulk writes)
+  bool          hashMem_      { false };
+  mutable ulong pageHash_[0x100];
+  mutable ulong memHash_      { 0 };
+  mutable uchar hashStale_[0x100];
+  mutable uint  numHashStale_ { 0 };
+
+  //---
+
+  // write journal
+  bool    journalOn_ { false };
+  Journal journal_;
+
   //---
 
   // interrupts
@@ -688,22 +1195,51 @@ class C6502 {
   bool inIRQ_ { false };
   bool inBRK_ { false };
 
+  // interrupt lines
+  uint irqLines_   { 0 };     // one bit per IRQ source
+  bool nmiLine_    { false };
+  bool nmiPending_ { false };
+  bool intPending_ { false }; // nmiPending_ || irqLines_ != 0
+
   //---
 
-  // labels (assember)
-  struct AddrLen {
-    ushort addr { 0 };
-    uchar  len  { 0 };
+  // events (min heap on t, id breaks ties so same t runs in post order)
+  struct Event {
+    ulong     t  { 0 };
+    uint      id { 0 };
+    EventProc proc;
 
-    AddrLen(ushort addr1=0, uchar len1=0) :
-     addr(addr1), len(len1) {
+    Event(ulong t1=0, uint id1=0, const EventProc &proc1=EventProc()) :
+     t(t1), id(id1), proc(proc1) {
+    }
+
+    bool operator>(const Event &e) const {
+      return (t != e.t ? t > e.t : id > e.id);
     }
   };
 
-  using Labels = std::map<std::string,AddrLen>;
+  using Events = std::vector<Event>;
 
-  Labels labels_;
-  int    numBadLabels_ { 0 };
+  Events events_;
+  Events checkpointEvents_; // pending events at checkpoint
+  uint   eventId_    { 0 };
+  ulong  nextEventT_ { std::numeric_limits<ulong>::max() };
+
+  //---
+
+  // labels (assember)
+  struct Fixup {
+    ushort           addr { 0 }; // operand address
+    FixupKind        kind { FixupKind::WORD };
+    std::string_view label;      // view into source
+  };
+
+  using Fixups = std::vector<Fixup>;
+
+  Labels           labels_;
+  Fixups           fixups_;
+  std::string_view fixupLabel_; // unresolved label in current operand
+  bool             optimize_ { false };
 
   //---
 
@@ -722,6 +1258,20 @@ class C6502 {
 
   //---
 
+  // idle loop detection (state at last backward jump target)
+  struct IdleState {
+    bool   set        { false };
+    ushort pc         { 0 };
+    ulong  memChanges { 0 };
+    ulong  volatileReads { 0 };
+    uchar  A { 0 }, X { 0 }, Y { 0 }, SR { 0 }, SP { 0 };
+  };
+
+  bool      idleSkip_ { false };
+  IdleState idle_;
+
+  //---
+
   // breakpoints
   using Breakpoints = std::set<ushort>;
 
@@ -739,10 +1289,20 @@ class C6502 {
 
   //---
 
+  // Traps (index per address into trap procs, 0 is no trap)
+  using TrapProcs = std::vector<TrapProc>;
+
+  uchar     trapInd_[0x10000];
+  TrapProcs traps_;
+
+  //---
+
   // Debug Output
 
   bool enableOutputProcs_ { false };
 
+  C6502Output output_;
+
   ushort outAddr_     { 0xFFF0 };
   ushort outNAddr_    { 0xFFF2 };
   ushort outMemAddr_  { 0xFFF4 };
@@ -0,0 +1,143 @@
+#ifndef C6502Analyze_H
+#define C6502Analyze_H
+
+#include <C6502.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// Static cycle analysis of assembled code.
+//
+// Code is decoded (for the CPU variant) from entry addresses, JSR targets and labelled
+// interrupt vectors into basic blocks, each with best and worst case cycles (worst
+// case includes page cross penalties which are possible for the operand and the
+// 65C02 decimal mode cycle). Taken branch cycles (including page cross) are exact as
+// the branch address is known.
+//
+// Each subroutine is then timed from its entry to RTS/RTI:
+//  . best case is the shortest path
+//  . worst case is the longest path with each loop body counted once (loop flagged)
+//  . JSR adds the called subroutine's best/worst cycles
+//
+// Indirect jumps are not followed (flagged) and JSR to a host trap only counts the JSR.
+class C6502Analyze {
+ public:
+  using uchar  = C6502::uchar;
+  using ushort = C6502::ushort;
+  using ulong  = C6502::ulong;
+
+  // subroutine timing (cycles from entry to return, including RTS/RTI)
+  struct Routine {
+    std::string name;
+    ushort      addr      { 0 };
+    ulong       minCycles { 0 };
+    ulong       maxCycles { 0 };
+    uint        numBlocks { 0 };
+    bool        loop      { false }; // contains loop (worst case counts loop once)
+    bool        recursive { false }; // calls itself (recursive call not counted)
+    bool        indirect  { false }; // indirect jump (not followed)
+    bool        noReturn  { false }; // no path to RTS/RTI (cycles to BRK/invalid)
+
+   private:
+    friend class C6502Analyze;
+
+    enum class State { NONE, ACTIVE, DONE };
+
+    State state { State::NONE };
+  };
+
+  using Routines = std::map<ushort,Routine>;
+
+ public:
+  C6502Analyze(const C6502 *cpu);
+
+  // add entry address (name from label if empty)
+  void addEntry(ushort addr, const std::string &name="");
+
+  // analyze code reachable from entries
+  void analyze();
+
+  // subroutines (by address)
+  const Routines &routines() const { return routines_; }
+
+  void print(std::ostream &os) const;
+
+  // length and cycles (base and extra for taken branch) of instruction at address
+  bool instCycles(ushort addr, uint &len, uint &cycles, uint &takenCycles) const;
+
+ private:
+  enum class Flow {
+    NEXT,     // continues to next instruction
+    BRANCH,   // conditional branch
+    JUMP,     // jump (or 65C02 BRA)
+    JUMP_IND, // indirect jump
+    CALL,     // JSR
+    RETURN,   // RTS/RTI
+    STOP      // BRK or invalid/halt opcode
+  };
+
+  // decoded instruction
+  struct Inst {
+    uchar  len         { 1 };
+    uchar  cycles      { 0 }; // base cycles
+    uchar  extraCycles { 0 }; // worst case extra cycles (page cross, decimal)
+    uchar  takenCycles { 0 }; // extra cycles for taken branch
+    Flow   flow        { Flow::NEXT };
+    ushort target      { 0 };
+  };
+
+  // basic block (from leader to control flow instruction or next leader)
+  struct Block {
+    ushort start       { 0 };
+    ushort next        { 0 }; // address after last instruction
+    ulong  minCycles   { 0 };
+    ulong  maxCycles   { 0 };
+    uint   takenCycles { 0 };
+    Flow   flow        { Flow::NEXT };
+    ushort target      { 0 };
+  };
+
+  using Blocks = std::map<ushort,Block>;
+
+  // successor block with edge cycles (taken branch or called subroutine)
+  struct Edge {
+    ushort addr      { 0 };
+    ulong  minCycles { 0 };
+    ulong  maxCycles { 0 };
+  };
+
+  using Edges = std::vector<Edge>;
+
+ private:
+  bool decode(ushort addr, Inst &inst) const;
+
+  void findLeaders();
+
+  void buildBlocks();
+
+  void blockEdges(const Block &block, Edges &edges) const;
+
+  const Routine *calledRoutine(const Block &block) const;
+
+  void analyzeRoutine(Routine &routine);
+
+  ulong maxPath(ushort addr, std::map<ushort,int> &visit, std::map<ushort,ulong> &maxTo,
+                Routine &routine);
+
+  bool minPath(ushort entry, const std::set<ushort> &blocks, bool anyExit, ulong &cycles) const;
+
+  std::string labelName(ushort addr) const;
+
+ private:
+  using Entries = std::map<ushort,std::string>;
+
+  const C6502*      cpu_ { nullptr };
+  Entries           entries_;
+  std::vector<bool> leaders_;
+  std::set<ushort>  calls_;
+  Blocks            blocks_;
+  Routines          routines_;
+};
+
+#endif
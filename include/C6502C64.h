@@ -0,0 +1,143 @@
+#ifndef C6502C64_H
+#define C6502C64_H
+
+#include <C6502.h>
+#include <deque>
+#include <string>
+
+// C64 profile
+//
+// Maps the bundled BASIC ($A000-$BFFF) and KERNAL ($E000-$FFFF) ROMs read-only
+// and installs host fast paths (traps) for the hot KERNAL entry points.
+// Disabling a fast path removes its trap so the real ROM code runs.
+class C6502C64 : public C6502 {
+ public:
+  enum class FastPath {
+    CHROUT, // $FFD2 output char to host output sink (ROM also runs if screen device attached)
+    CHRIN,  // $FFCF input char from host input queue
+    GETIN,  // $FFE4 get char from host input queue
+    LOAD,   // $FFD5 load file from host directory
+    SAVE    // $FFD8 save file to host directory
+  };
+
+  // KERNAL entry points
+  enum : ushort {
+    READY_ADDR  = 0xE112, // JSR CHRIN for BASIC input line after READY prompt
+    CHRIN_ADDR  = 0xFFCF,
+    CHROUT_ADDR = 0xFFD2,
+    LOAD_ADDR   = 0xFFD5,
+    SAVE_ADDR   = 0xFFD8,
+    GETIN_ADDR  = 0xFFE4
+  };
+
+ public:
+  C6502C64();
+
+  //---
+
+  bool isFastPath(FastPath fastPath) const { return fastPaths_ & (1U << uint(fastPath)); }
+  void setFastPath(FastPath fastPath, bool b);
+
+  void setAllFastPaths(bool b);
+
+  // directory for LOAD/SAVE fast paths
+  const std::string &hostDir() const { return hostDir_; }
+  void setHostDir(const std::string &dir) { hostDir_ = dir; }
+
+  //---
+
+  // reset to ROM power on state (memory cleared, ROMs mapped, PC at reset vector)
+  void resetC64();
+
+  // boot to BASIC READY prompt, using snapshot of first boot (keyed by ROM hash)
+  // if available (returns false if boot did not reach READY)
+  bool bootBasic();
+
+  // directory for boot snapshot files (shared between processes), empty for memory only
+  static const std::string &bootCacheDir();
+  static void setBootCacheDir(const std::string &dir);
+
+  static void clearBootCache();
+
+  // hash of ROM images
+  static ulong romHash();
+
+  //---
+
+  // place PRG image (2 byte load address header) in memory and fix up BASIC pointers
+  // as LOAD would, optionally queuing RUN in keyboard buffer (no emulated cycles used).
+  // Expects BASIC to be at READY (see bootBasic)
+  bool injectPrg(const std::string &filename, bool run=true);
+  bool injectPrg(const uchar *data, uint len, bool run=true);
+
+  // type (ASCII) keys into KERNAL keyboard buffer (max 10)
+  bool typeKeys(const std::string &str);
+
+  //---
+
+  // queue host input (ASCII) for CHRIN/GETIN fast paths
+  void addInput(const std::string &str);
+
+  bool hasInput() const { return ! input_.empty(); }
+
+  //---
+
+  static bool isRom(ushort addr) { return (addr >= 0xA000 && addr < 0xC000) || addr >= 0xE000; }
+
+  bool isReadOnly(ushort pos, ushort len) const override;
+
+  uchar getByte(ushort addr) const override {
+    // VIC raster ($D011 bit 7, $D012) (PAL 63 cycles/line, 312 lines) needed by KERNAL screen init
+    if (addr == 0xD011 || addr == 0xD012)
+      return rasterByte(addr);
+
+    return C6502::getByte(addr);
+  }
+
+  void setByte(ushort addr, uchar c) override {
+    // ROM write ignored
+    if (isRom(addr)) return;
+
+    C6502::setByte(addr, c);
+  }
+
+  //---
+
+  static char  petsciiToAscii(uchar c);
+  static uchar asciiToPetscii(char c);
+
+ private:
+  void mapRoms();
+
+  uchar rasterByte(ushort addr) const {
+    uint line = uint((t()/63) % 312);
+
+    if (addr == 0xD012)
+      return uchar(line & 0xFF);
+
+    return uchar((C6502::getByte(addr) & 0x7F) | ((line & 0x100) >> 1));
+  }
+
+  void installFastPath(FastPath fastPath);
+
+  void linkBasicLines();
+
+  int chroutTrap();
+  int chrinTrap ();
+  int getinTrap ();
+  int loadTrap  ();
+  int saveTrap  ();
+
+  std::string fileName() const;
+
+  std::string hostPath(const std::string &name, bool exists) const;
+
+ private:
+  using Input = std::deque<uchar>;
+
+  uint        fastPaths_ { 0 };
+  std::string hostDir_   { "." };
+  Input       input_;
+};
+
+#endif
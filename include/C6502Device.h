@@ -0,0 +1,38 @@
+#ifndef C6502Device_H
+#define C6502Device_H
+
+// Memory mapped device.
+//
+// Added to the CPU for an address range (see C6502::addDevice) and called from
+// the memory read and write paths for addresses in that range. Only reads by executing
+// instructions call memRead, inspection (C6502::getByte) calls memPeek.
+class C6502Device {
+ public:
+  using uchar  = unsigned char;
+  using ushort = unsigned short;
+  using uint   = unsigned int;
+
+ public:
+  C6502Device() { }
+
+  virtual ~C6502Device() { }
+
+  // byte read (return true and set value to override memory contents)
+  virtual bool memRead(ushort /*addr*/, uchar & /*value*/) { return false; }
+
+  // byte inspected by tools/debugger (no side effects, return true and set value to
+  // override memory contents)
+  virtual bool memPeek(ushort /*addr*/, uchar & /*value*/) const { return false; }
+
+  // byte written (old value is memory contents before write)
+  virtual void memWritten(ushort /*addr*/, uchar /*oldValue*/, uchar /*value*/) { }
+
+  // bulk memory change (memset, restore state, ...) overlapping device range
+  virtual void memReset(ushort /*addr*/, uint /*len*/) { }
+
+  // CPU checkpoint set/restored (save/restore device state, see C6502::setCheckpoint)
+  virtual void checkpoint() { }
+  virtual void restoreCheckpoint() { }
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef C6502Env_H
+#define C6502Env_H
+
+#include <C6502.h>
+#include <C6502Input.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Batched environment over N CPU instances (e.g. agents playing snake).
+//
+// All instances are reset from a shared state snapshot. Each step writes one action
+// per instance to the key address and runs every instance for a frame of cycles in
+// parallel (persistent worker threads).
+//
+// Screen pages of all instances are kept in one contiguous buffer which is updated
+// from the write path (device per instance) so no copy is needed after a step.
+//
+// Random address reads are served from a seeded PRNG per instance (see C6502Input).
+class C6502Env {
+ public:
+  using uchar  = C6502::uchar;
+  using ushort = C6502::ushort;
+  using ulong  = C6502::ulong;
+
+  using StateP = std::shared_ptr<const C6502::State>;
+
+ public:
+  // numThreads 0 is hardware concurrency
+  C6502Env(uint n, const StateP &state, ushort screenAddr=0x0200, uint screenLen=0x0400,
+           uint numThreads=0);
+
+ ~C6502Env();
+
+  C6502Env(const C6502Env &) = delete;
+  C6502Env &operator=(const C6502Env &) = delete;
+
+  //---
+
+  uint numInstances() const { return uint(instances_.size()); }
+
+  C6502 &cpu(uint i) { return *instances_[i]->cpu; }
+
+  uint numThreads() const { return uint(workers_.size() + 1); }
+
+  //---
+
+  const StateP &state() const { return state_; }
+
+  // change shared snapshot (used by next reset)
+  void setState(const StateP &state) { state_ = state; }
+
+  // cycles run per step
+  ulong frameCycles() const { return frameCycles_; }
+  void setFrameCycles(ulong n) { frameCycles_ = n; }
+
+  // instance i PRNG seed is seed + i (applied on reset)
+  ulong seed() const { return seed_; }
+  void setSeed(ulong seed) { seed_ = seed; }
+
+  ushort keyAddr() const { return keyAddr_; }
+
+  //---
+
+  // restore instance(s) from snapshot
+  void reset(uint i);
+  void resetAll();
+
+  // write actions[i] to key address of each instance (not done) and run for frame cycles
+  void step(const uchar *actions);
+
+  // instance stopped (halt or BRK) in last step
+  bool isDone(uint i) const { return instances_[i]->done; }
+
+  //---
+
+  // screen pages of all instances (numInstances()*screenLen() bytes)
+  const uchar *screens() const { return &screens_[0]; }
+
+  const uchar *screen(uint i) const { return &screens_[i*screenLen_]; }
+
+  ushort screenAddr() const { return screenAddr_; }
+  uint   screenLen () const { return screenLen_; }
+
+ private:
+  // copies writes to screen region into instance's part of screens buffer
+  class ScreenMirror : public C6502Device {
+   public:
+    ScreenMirror(C6502 *cpu, ushort addr, uint len, uchar *data) :
+     cpu_(cpu), addr_(addr), len_(len), data_(data) {
+    }
+
+    void memWritten(ushort addr, uchar, uchar value) override {
+      data_[addr - addr_] = value;
+    }
+
+    void memReset(ushort, uint) override {
+      cpu_->memget(addr_, data_, ushort(len_));
+    }
+
+   private:
+    C6502* cpu_  { nullptr };
+    ushort addr_ { 0 };
+    uint   len_  { 0 };
+    uchar* data_ { nullptr };
+  };
+
+  struct Instance {
+    std::unique_ptr<C6502>        cpu;
+    std::unique_ptr<C6502Input>   input;
+    std::unique_ptr<ScreenMirror> screen;
+    bool                          done { false };
+  };
+
+  using InstanceP = std::unique_ptr<Instance>;
+  using Instances = std::vector<InstanceP>;
+  using Screens   = std::vector<uchar>;
+  using Job       = std::function<void(uint)>;
+  using Workers   = std::vector<std::thread>;
+
+  // run job for each instance index using workers and calling thread
+  void runParallel(const Job &job);
+
+  void runJobs();
+
+  void workerLoop();
+
+ private:
+  Instances instances_;
+  StateP    state_;
+  ushort    screenAddr_  { 0x0200 };
+  uint      screenLen_   { 0x0400 };
+  ushort    keyAddr_     { 0xFF };
+  ulong     frameCycles_ { 63*312 };
+  ulong     seed_        { 0 };
+  Screens   screens_;
+
+  // worker threads
+  Workers                 workers_;
+  std::mutex              mutex_;
+  std::condition_variable startCond_;
+  std::condition_variable doneCond_;
+  uint                    generation_ { 0 };
+  uint                    numActive_  { 0 };
+  bool                    stop_       { false };
+  Job                     job_;
+  std::atomic<uint>       nextJob_    { 0 };
+};
+
+#endif
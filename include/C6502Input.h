@@ -0,0 +1,143 @@
+#ifndef C6502Input_H
+#define C6502Input_H
+
+#include <C6502Device.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+class C6502;
+
+// Deterministic memory mapped input (e.g. snake sysRandom $fe, sysLastKey $ff).
+//
+// Random address reads are served from a seeded PRNG and key address reads from
+// an input queue (last key is held until next key or program write).
+//
+// Every value served is logged with its cycle count so a run can be replayed
+// exactly by serving the values from the log instead.
+class C6502Input : public C6502Device {
+ public:
+  using ulong = unsigned long;
+
+  // served value
+  struct Entry {
+    ulong  t     { 0 };
+    ushort addr  { 0 };
+    uchar  value { 0 };
+
+    Entry(ulong t1=0, ushort addr1=0, uchar value1=0) :
+     t(t1), addr(addr1), value(value1) {
+    }
+  };
+
+  using Log = std::vector<Entry>;
+
+ public:
+  C6502Input(C6502 *cpu, ushort randomAddr=0xFE, ushort keyAddr=0xFF);
+
+ ~C6502Input();
+
+  C6502Input(const C6502Input &) = delete;
+  C6502Input &operator=(const C6502Input &) = delete;
+
+  //---
+
+  ushort randomAddr() const { return randomAddr_; }
+  ushort keyAddr   () const { return keyAddr_; }
+
+  // PRNG seed (restarts sequence)
+  ulong seed() const { return seed_; }
+  void setSeed(ulong seed);
+
+  //---
+
+  // queue key(s) for key address
+  void addKey (uchar key) { keys_.push_back(key); }
+  void addKeys(const std::string &str);
+
+  bool hasKeys() const { return ! keys_.empty(); }
+
+  uchar lastKey() const { return lastKey_; }
+
+  //---
+
+  // log of served values
+  bool isLogging() const { return logging_; }
+  void setLogging(bool b) { logging_ = b; }
+
+  const Log &log() const { return log_; }
+
+  void clearLog() { log_.clear(); }
+
+  bool saveLog(const std::string &filename) const;
+
+  static bool loadLog(const std::string &filename, Log &log);
+
+  //---
+
+  // serve values from log (keys and PRNG ignored), values not in log (mismatch) are
+  // served from PRNG/last key
+  void startReplay(const Log &log);
+  void stopReplay();
+
+  bool isReplay() const { return replay_; }
+
+  // replay finished (all log entries served)
+  bool isReplayDone() const { return replayPos_ >= replayLog_.size(); }
+
+  // number of values served during replay which were not at the logged cycle/address
+  uint numMismatches() const { return numMismatches_; }
+
+  //---
+
+  // device interface
+  bool memRead(ushort addr, uchar &value) override;
+  bool memPeek(ushort addr, uchar &value) const override;
+
+  void memWritten(ushort addr, uchar oldValue, uchar value) override;
+
+  void memReset(ushort addr, uint len) override;
+
+  void checkpoint() override;
+  void restoreCheckpoint() override;
+
+ private:
+  uchar nextRandom();
+
+  bool replayValue(ulong t, ushort addr, uchar &value);
+
+  void logValue(ulong t, ushort addr, uchar value) {
+    if (logging_) log_.push_back(Entry(t, addr, value));
+  }
+
+ private:
+  using Keys = std::deque<uchar>;
+
+  C6502* cpu_           { nullptr };
+  ushort randomAddr_    { 0xFE };
+  ushort keyAddr_       { 0xFF };
+  ulong  seed_          { 0 };
+  ulong  state_         { 0 };
+  Keys   keys_;
+  uchar  lastKey_       { 0 };
+  bool   logging_       { true };
+  Log    log_;
+  bool   replay_        { false };
+  Log    replayLog_;
+  size_t replayPos_     { 0 };
+  uint   numMismatches_ { 0 };
+
+  // state at CPU checkpoint
+  struct Checkpoint {
+    ulong  state         { 0 };
+    Keys   keys;
+    uchar  lastKey       { 0 };
+    size_t logSize       { 0 };
+    size_t replayPos     { 0 };
+    uint   numMismatches { 0 };
+  };
+
+  Checkpoint checkpoint_;
+};
+
+#endif
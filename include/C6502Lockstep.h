@@ -0,0 +1,77 @@
+#ifndef C6502Lockstep_H
+#define C6502Lockstep_H
+
+#include <C6502.h>
+#include <limits>
+#include <sstream>
+#include <string>
+
+// Differential lockstep check of two CPU instances (execution engines).
+//
+// Both CPUs are stepped from the same state and their registers, cycle count and
+// written memory compared after every block of instructions.
+//
+// The CPUs are run on different paths so a divergence shows a bug in one of them:
+//  . first : fast paths (page fast write path, written pages from dirty tracking)
+//  . second: reference paths (write journal forces page slow write path, decimal
+//            mode results calculated instead of looked up)
+//
+// For blocks of more than one instruction both CPUs are checkpointed at the block
+// start and, on divergence, the block is rerun one instruction at a time so the
+// report always gives the first diverging instruction (with disassembly).
+class C6502Lockstep {
+ public:
+  using uchar  = C6502::uchar;
+  using ushort = C6502::ushort;
+  using ulong  = C6502::ulong;
+
+ public:
+  C6502Lockstep(C6502 *cpu1, C6502 *cpu2);
+
+ ~C6502Lockstep();
+
+  C6502Lockstep(const C6502Lockstep &) = delete;
+  C6502Lockstep &operator=(const C6502Lockstep &) = delete;
+
+  //---
+
+  // instructions run between compares
+  uint blockSize() const { return blockSize_; }
+  void setBlockSize(uint n) { blockSize_ = std::max(n, 1U); }
+
+  //---
+
+  // run until either CPU halts/breaks or max steps (returns false on divergence)
+  bool run(ulong maxSteps=std::numeric_limits<ulong>::max());
+
+  // number of instructions run
+  ulong numSteps() const { return numSteps_; }
+
+  bool isDiverged() const { return diverged_; }
+
+  // description of first divergence
+  const std::string &report() const { return report_; }
+
+ private:
+  // run up to n instructions (returns number run, stopped set if CPU stopped)
+  uint runBlock(uint n, bool compareEach, bool &stopped);
+
+  void stepBoth();
+
+  bool compare();
+
+  void compareMemory(std::stringstream &ss);
+
+  static bool isStopped(const C6502 *cpu) { return cpu->isHalt() || cpu->isBreak(); }
+
+ private:
+  C6502*      cpu1_      { nullptr };
+  C6502*      cpu2_      { nullptr };
+  uint        blockSize_ { 1 };
+  ulong       numSteps_  { 0 };
+  ushort      lastPC_    { 0 };
+  bool        diverged_  { false };
+  std::string report_;
+};
+
+#endif
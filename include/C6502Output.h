@@ -0,0 +1,136 @@
+#ifndef C6502Output_H
+#define C6502Output_H
+
+#include <functional>
+#include <string>
+#include <cstdio>
+#include <cstring>
+
+// Buffered sink for OUT debug procs output.
+//
+// Output is collected in a large buffer and only written to the destination
+// (stdout, file, captured string or callback) when full or flushed.
+class C6502Output {
+ public:
+  using uchar  = unsigned char;
+  using ushort = unsigned short;
+
+  using WriteProc = std::function<void(const char *, size_t)>;
+
+  enum class Type {
+    STDOUT,
+    FILE,
+    STRING,
+    PROC
+  };
+
+ public:
+  C6502Output(size_t size=65536) :
+   size_(size) {
+    buffer_.reserve(size_);
+  }
+
+ ~C6502Output() { flush(); }
+
+  C6502Output(const C6502Output &) = delete;
+  C6502Output &operator=(const C6502Output &) = delete;
+
+  //---
+
+  const Type &type() const { return type_; }
+
+  void setStdout() { flush(); type_ = Type::STDOUT; fp_ = nullptr; }
+
+  void setFile(FILE *fp) { flush(); type_ = Type::FILE; fp_ = fp; }
+
+  // capture in string (see str())
+  void setString() { flush(); type_ = Type::STRING; fp_ = nullptr; }
+
+  void setProc(const WriteProc &proc) { flush(); type_ = Type::PROC; proc_ = proc; }
+
+  //---
+
+  // captured output (STRING type)
+  const std::string &str() { flush(); return str_; }
+
+  void clearStr() { str_.clear(); }
+
+  //---
+
+  // disabled output is dropped (e.g. speculative run-ahead frames)
+  bool isEnabled() const { return enabled_; }
+  void setEnabled(bool b) { enabled_ = b; }
+
+  //---
+
+  void putChar(char c) {
+    if (! enabled_) return;
+
+    buffer_ += c;
+
+    if (buffer_.size() >= size_)
+      flush();
+  }
+
+  void putStr(const char *str) { putStr(str, strlen(str)); }
+
+  void putStr(const char *str, size_t len) {
+    if (! enabled_) return;
+
+    if (buffer_.size() + len >= size_) {
+      flush();
+
+      // too big for buffer so write directly
+      if (len >= size_) { write(str, len); return; }
+    }
+
+    buffer_.append(str, len);
+  }
+
+  void putHex02(uchar c) {
+    static const char *xchars = "0123456789abcdef";
+
+    char s[2] = { xchars[c >> 4], xchars[c & 0xF] };
+
+    putStr(s, 2);
+  }
+
+  void putHex04(ushort c) { putHex02(uchar(c >> 8)); putHex02(uchar(c & 0xFF)); }
+
+  // binary fast path (raw bytes, no formatting)
+  void putBytes(const uchar *data, size_t len) {
+    putStr(reinterpret_cast<const char *>(data), len);
+  }
+
+  //---
+
+  void flush() {
+    if (buffer_.empty())
+      return;
+
+    write(buffer_.c_str(), buffer_.size());
+
+    buffer_.clear();
+  }
+
+ private:
+  void write(const char *str, size_t len) {
+    switch (type_) {
+      case Type::STDOUT: fwrite(str, 1, len, stdout); fflush(stdout); break;
+      case Type::FILE  : if (fp_) fwrite(str, 1, len, fp_); break;
+      case Type::STRING: str_.append(str, len); break;
+      case Type::PROC  : if (proc_) proc_(str, len); break;
+    }
+  }
+
+ private:
+  size_t      size_    { 65536 };
+  bool        enabled_ { true };
+  std::string buffer_;
+  Type        type_    { Type::STDOUT };
+  FILE*       fp_      { nullptr };
+  std::string str_;
+  WriteProc   proc_;
+};
+
+#endif
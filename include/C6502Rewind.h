@@ -0,0 +1,119 @@
+#ifndef C6502Rewind_H
+#define C6502Rewind_H
+
+#include <C6502.h>
+#include <deque>
+#include <vector>
+
+// Rewind buffer.
+//
+// Snapshots are taken every interval cycles (CPU event). Each snapshot stores the
+// registers and, for the pages written since the previous snapshot (CPU dirty page
+// tracking), the XOR of the page with its previous contents, run length encoded.
+//
+// A shadow copy of memory at the latest snapshot is kept so seeking back applies
+// the deltas in reverse from there and only copies changed pages to the CPU.
+//
+// Oldest snapshots are dropped when the encoded size exceeds the memory budget.
+//
+// Snapshots taken after a CPU checkpoint are undone when the checkpoint is restored
+// (e.g. run-ahead frames) so only the real timeline is recorded.
+//
+// Note: the snapshot event keeps idle programs running (see C6502::idleLoop) so use
+// a cycle budget (C6502::contCycles) when rewind is enabled.
+class C6502Rewind : public C6502Device {
+ public:
+  using uchar  = C6502::uchar;
+  using ushort = C6502::ushort;
+  using ulong  = C6502::ulong;
+
+ public:
+  C6502Rewind(C6502 *cpu, ulong interval=63*312*50, size_t budget=16*1024*1024);
+
+ ~C6502Rewind();
+
+  C6502Rewind(const C6502Rewind &) = delete;
+  C6502Rewind &operator=(const C6502Rewind &) = delete;
+
+  //---
+
+  bool isEnabled() const { return enabled_; }
+  void setEnabled(bool b);
+
+  // cycles between snapshots
+  ulong interval() const { return interval_; }
+  void setInterval(ulong n);
+
+  // max bytes of encoded snapshot data
+  size_t budget() const { return budget_; }
+  void setBudget(size_t n) { budget_ = n; dropOld(); }
+
+  size_t memUsed() const { return memUsed_; }
+
+  //---
+
+  // take snapshot now
+  void snapshot();
+
+  uint numSnapshots() const { return uint(snapshots_.size()); }
+
+  // cycle count of snapshot (0 is oldest)
+  ulong snapshotT(uint i) const { return snapshots_[i].state.t; }
+
+  // restore snapshot i (later snapshots are discarded)
+  bool seek(uint i);
+
+  // restore latest snapshot at or before cycle t
+  bool seekT(ulong t);
+
+  // restore previous snapshot (latest if CPU changed since it was taken)
+  bool stepBack();
+
+  //---
+
+  // device interface (CPU checkpoint)
+  void checkpoint() override;
+  void restoreCheckpoint() override;
+
+ private:
+  struct Snapshot {
+    C6502::State       state; // registers only
+    bool               halt { false };
+    std::vector<uchar> data;  // [page, RLE XOR delta] for each changed page
+  };
+
+  using Snapshots = std::deque<Snapshot>;
+  using Mem       = std::vector<uchar>;
+
+  void schedule();
+
+  void dropOld();
+
+  // remove latest snapshot applying its deltas to shadow (pages marked in changed)
+  void undoSnapshot(bool *changed);
+
+  static void encodePage(const uchar *delta, std::vector<uchar> &data);
+  static size_t decodePage(const uchar *data, uchar *page);
+
+ private:
+  C6502*    cpu_      { nullptr };
+  bool      enabled_  { false };
+  ulong     interval_ { 0 };
+  size_t    budget_   { 0 };
+  size_t    memUsed_  { 0 };
+  uint      eventId_  { 0 };
+  Mem       shadow_;
+  Snapshots snapshots_;
+  ulong     numTaken_ { 0 }; // snapshots taken (less undone)
+
+  // state at CPU checkpoint
+  struct Checkpoint {
+    bool  set      { false };
+    ulong numTaken { 0 };
+    uint  eventId  { 0 };
+  };
+
+  Checkpoint checkpoint_;
+};
+
+#endif
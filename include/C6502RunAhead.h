@@ -0,0 +1,48 @@
+#ifndef C6502RunAhead_H
+#define C6502RunAhead_H
+
+#include <functional>
+
+class C6502;
+
+// Run-ahead to hide a program's internal input lag.
+//
+// Each frame runs the real frame, sets a CPU checkpoint, runs numFrames more frames
+// with the same input, presents that output and restores the checkpoint.
+//
+// Uses the CPU copy on write checkpoint so the cost of save/restore is only the
+// pages written by the ahead frames.
+// Events run by the ahead frames are restored with the checkpoint and trap output
+// (OUT, CHROUT, ...) from the ahead frames is dropped.
+class C6502RunAhead {
+ public:
+  using uint  = unsigned int;
+  using ulong = unsigned long;
+
+  using PresentProc = std::function<void()>;
+
+ public:
+  C6502RunAhead(C6502 *cpu, uint numFrames=1, ulong frameCycles=63*312);
+
+  // number of frames run ahead (0 is disabled)
+  uint numFrames() const { return numFrames_; }
+  void setNumFrames(uint n) { numFrames_ = n; }
+
+  ulong frameCycles() const { return frameCycles_; }
+  void setFrameCycles(ulong n) { frameCycles_ = n; }
+
+  // run frame with run-ahead calling present at end of ahead frames
+  // (returns false if the real frame stopped early e.g. BRK or halt)
+  bool runFrame(const PresentProc &present);
+
+ private:
+  // run frame of cycles (returns false if stopped early)
+  bool runCycles();
+
+ private:
+  C6502* cpu_         { nullptr };
+  uint   numFrames_   { 1 };
+  ulong  frameCycles_ { 63*312 };
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef C6502Screen_H
+#define C6502Screen_H
+
+#include <C6502Device.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+class C6502;
+
+// Headless display of memory mapped screen region.
+//
+// Cells changed by CPU writes are tracked (as a device on the region) so frames are
+// only output when something changed.
+//
+// Modes:
+//  PIXEL : one byte per pixel, low nibble is palette index (e.g. snake 32x32 at $0200)
+//  TEXT  : one byte per character, C64 screen codes (e.g. C64 40x25 at $0400)
+class C6502Screen : public C6502Device {
+ public:
+  enum class Mode {
+    PIXEL,
+    TEXT
+  };
+
+  enum class Format {
+    PPM,  // binary PPM (P6) image per frame
+    Y4M,  // YUV4MPEG2 (4:4:4) stream
+    TEXT  // text snapshot per frame
+  };
+
+ public:
+  C6502Screen(C6502 *cpu, ushort addr, uint width, uint height, Mode mode=Mode::PIXEL);
+
+ ~C6502Screen();
+
+  C6502Screen(const C6502Screen &) = delete;
+  C6502Screen &operator=(const C6502Screen &) = delete;
+
+  //---
+
+  ushort addr  () const { return addr_; }
+  uint   width () const { return width_; }
+  uint   height() const { return height_; }
+  Mode   mode  () const { return mode_; }
+
+  // pixels per cell in image formats
+  uint scale() const { return scale_; }
+  void setScale(uint scale) { scale_ = std::max(scale, 1U); }
+
+  // frame rate in Y4M header
+  uint fps() const { return fps_; }
+  void setFps(uint fps) { fps_ = std::max(fps, 1U); }
+
+  //---
+
+  bool isDirty() const { return numDirty_ > 0; }
+
+  uint numDirty() const { return numDirty_; }
+
+  bool isCellDirty(uint x, uint y) const { return dirty_[y*width_ + x]; }
+
+  void setAllDirty();
+  void clearDirty();
+
+  uchar cell(uint x, uint y) const;
+
+  // number of frames output
+  uint numFrames() const { return numFrames_; }
+
+  //---
+
+  // output frame in format if any cell changed since last frame (returns false if unchanged)
+  bool updateFrame(std::ostream &os, Format format);
+
+  // output frame in format (always)
+  void writeFrame(std::ostream &os, Format format);
+
+  void writePPM (std::ostream &os) const;
+  void writeY4M (std::ostream &os);
+  void writeText(std::ostream &os) const;
+
+  //---
+
+  // device interface
+  void memWritten(ushort addr, uchar oldValue, uchar value) override;
+
+  void memReset(ushort addr, uint len) override;
+
+  //---
+
+  // RGB of cell (palette color for PIXEL, light on dark for TEXT)
+  void cellRGB(uint x, uint y, uchar rgb[3]) const;
+
+  static char screenCodeToAscii(uchar c);
+
+ private:
+  void setDirty(uint i) {
+    if (! dirty_[i]) { dirty_[i] = 1; ++numDirty_; }
+  }
+
+ private:
+  using Dirty = std::vector<uchar>;
+  using Image = std::vector<uchar>;
+
+  C6502* cpu_       { nullptr };
+  ushort addr_      { 0 };
+  uint   width_     { 0 };
+  uint   height_    { 0 };
+  Mode   mode_      { Mode::PIXEL };
+  uint   scale_     { 1 };
+  uint   fps_       { 50 };
+  Dirty  dirty_;
+  uint   numDirty_  { 0 };
+  uint   numFrames_ { 0 };
+  bool   y4mHeader_ { false };
+  Image  image_;
+};
+
+#endif
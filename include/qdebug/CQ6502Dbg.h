@@ -14,6 +14,7 @@ class CQ6502Stack;
 class CQ6502TraceBack;
 class CQ6502RegEdit;
 class C6502;
+class C6502Rewind;
 
 class CQTabSplit;
 
@@ -61,6 +62,10 @@ class CQ6502Dbg : public QFrame {
   C6502 *getCPU() const { return cpu_; }
   void setCPU(C6502 *cpu) { cpu_ = cpu; }
 
+  // rewind buffer used by Rewind button (not owned)
+  C6502Rewind *getRewind() const { return rewind_; }
+  void setRewind(C6502Rewind *rewind);
+
   const QFont &getFixedFont() const { return fixedFont_; }
   virtual void setFixedFont(const QFont &font);
 
@@ -200,10 +205,12 @@ class CQ6502Dbg : public QFrame {
   void continueSlot();
   void stopSlot();
   void restartSlot();
+  void rewindSlot();
   void exitSlot();
 
  protected:
-  C6502 *cpu_ { nullptr };
+  C6502*       cpu_    { nullptr };
+  C6502Rewind* rewind_ { nullptr };
 
   QFont fixedFont_;
 
@@ -296,6 +303,7 @@ class CQ6502Dbg : public QFrame {
   QPushButton *continueButton_ { nullptr };
   QPushButton *stopButton_     { nullptr };
   QPushButton *restartButton_  { nullptr };
+  QPushButton *rewindButton_   { nullptr };
   QPushButton *exitButton_     { nullptr };
 
   bool updateNeeded_ { false };
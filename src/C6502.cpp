@@ -1,14 +1,20 @@
 #include <C6502.h>
+#include <C6502Analyze.h>
 #include <CParser.h>
 
 #include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <cassert>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 
-//#include <c64_basic.h>
-//#include <c64_kernel.h>
-
-// TODO:
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // The available 16-bit address space is conceived as consisting of pages of 256 bytes each, with
 // address hi-bytes represententing the page index. An increment with carry may affect the hi-byte
@@ -18,8 +24,6 @@
 // addresses don't.  Notably this is not related in any way to the state of the carry bit of the
 // accumulator.
 
-// BCD arithmatic (D flag set)
-
 // Set B flag when break/interrupt processed
 
 C6502::
@@ -28,6 +32,185 @@ C6502()
   setIFlag(true); // interrupts disabled
 
   std::memset(&mem_[0], 0, 0x10000*sizeof(mem_[0]));
+
+  std::memset(&trapInd_[0], 0, 0x10000*sizeof(trapInd_[0]));
+
+  traps_.resize(1); // index 0 is no trap
+
+  std::memset(&devicePages_[0], 0, sizeof(devicePages_));
+  std::memset(&pageFlags_  [0], 0, sizeof(pageFlags_  ));
+  std::memset(&pageHash_   [0], 0, sizeof(pageHash_   ));
+  std::memset(&hashStale_  [0], 0, sizeof(hashStale_  ));
+
+  setVariant(Variant::NMOS);
+}
+
+void
+C6502::
+setVariant(Variant variant)
+{
+  variant_ = variant;
+
+  switch (variant_) {
+    case Variant::NMOS : stepProc_ = &C6502::stepVariant<Variant::NMOS >; break;
+    case Variant::CMOS : stepProc_ = &C6502::stepVariant<Variant::CMOS >; break;
+    case Variant::R2A03: stepProc_ = &C6502::stepVariant<Variant::R2A03>; break;
+  }
+
+  setDecimalMode(variant_ == Variant::CMOS ? DecimalMode::CMOS : DecimalMode::NMOS);
+}
+
+void
+C6502::
+setDecimalMode(DecimalMode mode)
+{
+  decimalMode_ = mode;
+
+  bcdAdc_ = bcdTable(false, mode);
+  bcdSbc_ = bcdTable(true , mode);
+}
+
+// decimal mode ADC/SBC result tables (built once, shared by all CPUs)
+//  also defined for invalid BCD digits
+const C6502::BcdResult *
+C6502::
+bcdTable(bool sub, DecimalMode mode)
+{
+  using Table = std::vector<BcdResult>;
+
+  static Table tables[4];
+
+  static bool initialized = [&]() {
+    for (uint i = 0; i < 4; ++i) {
+      bool        sub1  = (i & 1);
+      DecimalMode mode1 = ((i & 2) ? DecimalMode::CMOS : DecimalMode::NMOS);
+
+      Table &table = tables[i];
+
+      table.resize(0x20000);
+
+      for (uint ind = 0; ind < 0x20000; ++ind)
+        table[ind] = bcdCalc(sub1, mode1, int((ind >> 8) & 0xFF), int(ind & 0xFF), (ind >> 16));
+    }
+
+    return true;
+  }();
+
+  assert(initialized);
+
+  return &tables[(sub ? 1 : 0) | (mode == DecimalMode::CMOS ? 2 : 0)][0];
+}
+
+C6502::BcdResult
+C6502::
+bcdCalc(bool sub, DecimalMode mode, int a, int b, bool C)
+{
+  bool cmos = (mode == DecimalMode::CMOS);
+
+  int  res;
+  bool N, V, Z, C1;
+
+  if (! sub) {
+    int lo = (a & 0x0F) + (b & 0x0F) + C;
+
+    if (lo >= 0x0A)
+      lo = ((lo + 0x06) & 0x0F) + 0x10;
+
+    res = (a & 0xF0) + (b & 0xF0) + lo;
+
+    N = (res & 0x80);
+    V = ~(a ^ b) & (a ^ res) & 0x80;
+    Z = (((a + b + C) & 0xFF) == 0);
+
+    if (res >= 0xA0)
+      res += 0x60;
+
+    C1 = (res >= 0x100);
+  }
+  else {
+    // flags from binary subtract
+    int bin = a - b - ! C;
+
+    N  = (bin & 0x80);
+    V  = (a ^ b) & (a ^ bin) & 0x80;
+    Z  = ((bin & 0xFF) == 0);
+    C1 = (bin >= 0);
+
+    int lo = (a & 0x0F) - (b & 0x0F) + C - 1;
+
+    if (! cmos) {
+      if (lo < 0)
+        lo = ((lo - 0x06) & 0x0F) - 0x10;
+
+      res = (a & 0xF0) - (b & 0xF0) + lo;
+
+      if (res < 0)
+        res -= 0x60;
+    }
+    else {
+      res = bin;
+
+      if (res < 0)
+        res -= 0x60;
+
+      if (lo < 0)
+        res -= 0x06;
+    }
+  }
+
+  // CMOS N/Z valid for decimal result
+  if (cmos) {
+    N = (res & 0x80);
+    Z = ((res & 0xFF) == 0);
+  }
+
+  BcdResult r;
+
+  r.res   = uchar(res);
+  r.flags = uchar((N ? 0x80 : 0) | (V ? 0x40 : 0) | (Z ? 0x02 : 0) | (C1 ? 0x01 : 0));
+
+  return r;
+}
+
+void
+C6502::
+setEnableOutputProcs(bool b)
+{
+  enableOutputProcs_ = b;
+
+  // OUT procs are traps at fixed addresses
+  if (b) {
+    addTrap(outAddr_    , [](C6502 &cpu) { return cpu.outTrap(true ); });
+    addTrap(outNAddr_   , [](C6502 &cpu) { return cpu.outTrap(false); });
+    addTrap(outMemAddr_ , [](C6502 &cpu) { return cpu.outMemTrap(true ); });
+    addTrap(outMemNAddr_, [](C6502 &cpu) { return cpu.outMemTrap(false); });
+    addTrap(outStrAddr_ , [](C6502 &cpu) { return cpu.outStrTrap(); });
+  }
+  else {
+    removeTrap(outAddr_    );
+    removeTrap(outNAddr_   );
+    removeTrap(outMemAddr_ );
+    removeTrap(outMemNAddr_);
+    removeTrap(outStrAddr_ );
+  }
+}
+
+uint
+C6502::
+trapInlineLen(ushort addr) const
+{
+  if (! enableOutputProcs_ || ! isTrap(addr))
+    return 0;
+
+  // LDA #<regs>
+  if (addr == outAddr_ || addr == outNAddr_)
+    return 2;
+
+  // LDA <addr>
+  if (addr == outMemAddr_ || addr == outMemNAddr_ || addr == outStrAddr_)
+    return 3;
+
+  return 0;
 }
 
 //---
@@ -53,6 +236,10 @@ resetNMI()
 
   setIFlag(true);
 
+  // 65C02 clears decimal mode
+  if (variant_ == Variant::CMOS)
+    setDFlag(false);
+
   // jump to NMI interrupt vector
   setPC(NMI());
 
@@ -96,6 +283,10 @@ resetIRQ()
 
   setIFlag(true);
 
+  // 65C02 clears decimal mode
+  if (variant_ == Variant::CMOS)
+    setDFlag(false);
+
   // jump to IRQ interrupt vector
   setPC(IRQ());
 
@@ -121,6 +312,10 @@ resetBRK()
 
   setIFlag(true);
 
+  // 65C02 clears decimal mode
+  if (variant_ == Variant::CMOS)
+    setDFlag(false);
+
   // jump to IRQ interrupt vector
   setPC(IRQ());
 
@@ -147,855 +342,1402 @@ rti()
   incT(6);
 }
 
-//---
+// take pending interrupt (NMI has priority, IRQ only if not masked)
+void
+C6502::
+processInterrupts()
+{
+  if      (nmiPending_) {
+    nmiPending_ = false;
 
-bool
+    resetNMI();
+  }
+  else if (irqLines_ && ! Iflag()) {
+    resetIRQ();
+  }
+
+  updateIntPending();
+}
+
+// loop head reached with same registers, no memory changed and no device/volatile memory
+// read since last time round so loop can only exit when an event or interrupt changes state
+void
 C6502::
-run()
+idleLoop()
 {
-  return run(PC());
+  if      (nextEventT_ != std::numeric_limits<ulong>::max()) {
+    // skip to next event (or end of contCycles budget), through tick so per cycle
+    // devices see the elapsed cycles
+    while (t_ < nextEventT_)
+      incT(uchar(std::min(nextEventT_ - t_, ulong(0xFF))));
+  }
+  else if (! nmiPending_ && ! (irqLines_ && ! Iflag())) {
+    // nothing can wake loop
+    setHalt(true);
+  }
 }
 
-bool
+//---
+
+uint
 C6502::
-run(ushort addr)
+addEvent(ulong t, const EventProc &proc)
 {
-  reset();
+  uint id = ++eventId_;
 
-  setPC(addr);
+  events_.emplace_back(t, id, proc);
 
-  update();
+  std::push_heap(events_.begin(), events_.end(), std::greater<Event>());
 
-  return cont();
+  updateNextEventT();
+
+  return id;
 }
 
 bool
 C6502::
-cont()
+cancelEvent(uint id)
 {
-  setBreak(false);
-
-  while (! isHalt()) {
-    step();
+  auto p = std::find_if(events_.begin(), events_.end(),
+                        [&](const Event &e) { return e.id == id; });
+  if (p == events_.end()) return false;
 
-    update();
+  events_.erase(p);
 
-    if (isBreak())
-      break;
+  std::make_heap(events_.begin(), events_.end(), std::greater<Event>());
 
-    if (isTmpBreakpoint(PC()) || isBreakpoint(PC())) {
-      breakpointHit();
-      break;
-    }
-  }
+  updateNextEventT();
 
   return true;
 }
 
 void
 C6502::
-step()
+clearEvents()
 {
-  auto c = readByte();
+  events_.clear();
 
-  switch (c) {
-    case 0x00: { // BRK implicit
-      setBFlag(true);
-      setXFlag(true);
+  updateNextEventT();
+}
 
-      resetBRK();
+// run all events due at or before current cycle
+void
+C6502::
+processEvents()
+{
+  while (! events_.empty() && events_.front().t <= t_) {
+    std::pop_heap(events_.begin(), events_.end(), std::greater<Event>());
 
-      setBreak(true);
+    Event e = std::move(events_.back());
 
-      handleBreak();
+    events_.pop_back();
 
-      break;
-    }
+    updateNextEventT();
 
-    //---
+    // proc may post new events
+    if (e.proc)
+      e.proc();
+  }
 
-    // AND ...
-    case 0x21: { // AND (indirect,X)
-      andOp(getMemIndexedIndirectX()); incT(6); break;
-    }
-    case 0x25: { // AND zero page
-      andOp(getZeroPage()); incT(3); break;
-    }
-    case 0x29: { // AND immediate
-      andOp(readByte()); incT(2); break;
-    }
-    case 0x2D: { // AND absolute
-      andOp(getAbsolute()); incT(4); break;
-    }
-    case 0x31: { // AND (indirect),Y
-      andOp(getMemIndirectIndexedY()); incT(5); break;
-    }
-    case 0x35: { // AND zero page,X
-      andOp(getZeroPageX()); incT(4); break;
-    }
-    case 0x39: { // AND absolute,Y
-      andOp(getAbsoluteY()); incT(4); break;
-    }
-    case 0x3D: { // AND absolute,X
-      andOp(getAbsoluteX()); incT(4); break;
-    }
+  updateNextEventT();
+}
 
-    //---
+//---
 
-    // ORA ...
-    case 0x01: { // ORA (indirect,X)
-      orOp(getMemIndexedIndirectX()); incT(6); break;
-    }
-    case 0x05: { // ORA zero page
-      orOp(getZeroPage()); incT(3); break;
-    }
-    case 0x09: { // ORA immediate
-      orOp(readByte()); incT(2); break;
-    }
-    case 0x0D: { // ORA absolute
-      orOp(getAbsolute()); incT(4); break;
-    }
-    case 0x11: { // ORA (indirect),Y
-      orOp(getMemIndirectIndexedY()); incT(5); break;
-    }
-    case 0x15: { // ORA zero page,X
-      orOp(getZeroPageX()); incT(4); break;
-    }
-    case 0x19: { // ORA absolute,Y
-      orOp(getAbsoluteY()); incT(4); break;
-    }
-    case 0x1D: { // ORA absolute,X
-      orOp(getAbsoluteX()); incT(4); break;
-    }
+void
+C6502::
+saveState(State &state) const
+{
+  saveRegs(state);
 
-    //---
+  state.mem.resize(0x10000);
 
-    // EOR ...
-    case 0x41: { // EOR (indirect,X)
-      eorOp(getMemIndexedIndirectX()); incT(6); break;
-    }
-    case 0x45: { // EOR zero page
-      eorOp(getZeroPage()); incT(3); break;
-    }
-    case 0x49: { // EOR immediate
-      eorOp(readByte()); incT(2); break;
-    }
-    case 0x4D: { // EOR absolute
-      eorOp(getAbsolute()); incT(4); break;
-    }
-    case 0x51: { // EOR (indirect),Y
-      eorOp(getMemIndirectIndexedY()); incT(5); break;
-    }
-    case 0x55: { // EOR zero page,X
-      eorOp(getZeroPageX()); incT(4); break;
-    }
-    case 0x59: { // EOR absolute,Y
-      eorOp(getAbsoluteY()); incT(4); break;
-    }
-    case 0x5D: { // EOR absolute,X
-      eorOp(getAbsoluteX()); incT(4); break;
-    }
+  std::memcpy(&state.mem[0], &mem_[0], 0x10000);
+}
 
-    //---
+void
+C6502::
+restoreState(const State &state)
+{
+  assert(state.mem.size() == 0x10000);
 
-    // ADC ...
-    case 0x61: { // ADC (indirect,X)
-      adcOp(getMemIndexedIndirectX()); incT(6); break;
-    }
-    case 0x65: { // ADC zero page
-      adcOp(getZeroPage()); incT(3); break;
-    }
-    case 0x69: { // ADC immediate
-      adcOp(readByte()); incT(2); break;
-    }
-    case 0x6D: { // ADC absolute
-      adcOp(getAbsolute()); incT(4); break;
-    }
-    case 0x71: { // ADC (indirect),Y
-      adcOp(getMemIndirectIndexedY()); incT(5); break;
-    }
-    case 0x75: { // ADC zero page,X
-      adcOp(getZeroPageX()); incT(4); break;
-    }
-    case 0x79: { // ADC absolute,Y
-      adcOp(getAbsoluteY()); incT(4); break;
-    }
-    case 0x7D: { // ADC absolute,X
-      adcOp(getAbsoluteX()); incT(4); break;
-    }
+  if (isPageTracking())
+    prepareWritePages(0, 0x10000);
 
-    //---
+  std::memcpy(&mem_[0], &state.mem[0], 0x10000);
 
-    // SBC ...
-    case 0xE1: { // SBC (indirect,X)
-      sbcOp(getMemIndexedIndirectX()); incT(6); break;
-    }
-    case 0xE5: { // SBC zero page
-      sbcOp(getZeroPage()); incT(3); break;
-    }
-    case 0xE9: { // SBC immediate
-      sbcOp(readByte()); incT(2); break;
-    }
-    case 0xED: { // SBC absolute
-      sbcOp(getAbsolute()); incT(4); break;
-    }
-    case 0xF1: { // SBC (indirect),Y
-      sbcOp(getMemIndirectIndexedY()); incT(5); break;
-    }
-    case 0xF5: { // SBC zero page,X
-      sbcOp(getZeroPageX()); incT(4); break;
-    }
-    case 0xF9: { // SBC absolute,Y
-      sbcOp(getAbsoluteY()); incT(4); break;
-    }
-    case 0xFD: { // SBC absolute,X
-      sbcOp(getAbsoluteX()); incT(4); break;
-    }
+  ++memChanges_;
 
-    //---
+  if (! devices_.empty())
+    resetDevices(0, 0x10000);
 
-    // Bit functions
+  restoreRegs(state);
 
-    case 0x0A: { // ASL A
-      aslAOp(); incT(2); break;
-    }
-    case 0x06: { // ASL zero page
-      aslMemOp(readByte()); incT(5); break;
-    }
-    case 0x16: { // ASL zero page,X
-      aslMemOp(sumBytes(readByte(), X())); incT(6); break;
-    }
-    case 0x0E: { // ASL absolute
-      aslMemOp(readWord()); incT(6); break;
-    }
-    case 0x1E: { // ASL absolute,X
-      aslMemOp(readWord() + X()); incT(7); break;
-    }
+  // restored machine is running (not saved in state)
+  halt_ = false;
 
-    //-
+  memChanged(0, 0xFFFF);
+}
 
-    case 0x2A: { // ROL A
-      rolAOp(); incT(2); break;
-    }
-    case 0x26: { // ROL zero page
-      rolMemOp(readByte()); incT(5); break;
-    }
-    case 0x36: { // ROL zero page,X
-      rolMemOp(sumBytes(readByte(), X())); incT(6); break;
-    }
-    case 0x2E: { // ROL absolute
-      rolMemOp(readWord()); incT(6); break;
-    }
-    case 0x3E: { // ROL absolute,X
-      rolMemOp(readWord() + X()); incT(7); break;
-    }
+void
+C6502::
+saveRegs(State &state) const
+{
+  state.PC = PC_;
+  state.A  = A_;
+  state.X  = X_;
+  state.Y  = Y_;
+  state.SR = SR_;
+  state.SP = SP_;
+  state.t  = t_;
+
+  state.inNMI      = inNMI_;
+  state.inIRQ      = inIRQ_;
+  state.inBRK      = inBRK_;
+  state.irqLines   = irqLines_;
+  state.nmiLine    = nmiLine_;
+  state.nmiPending = nmiPending_;
+}
 
-    //-
+void
+C6502::
+restoreRegs(const State &state)
+{
+  PC_ = state.PC;
+  A_  = state.A;
+  X_  = state.X;
+  Y_  = state.Y;
+  SR_ = state.SR;
+  SP_ = state.SP;
+  t_  = state.t;
 
-    case 0x4A: { // LSR A
-      lsrAOp(); incT(2); break;
-    }
-    case 0x46: { // LSR zero page
-      lsrMemOp(readByte()); incT(5); break;
-    }
-    case 0x56: { // LSR zero page,X
-      lsrMemOp(sumBytes(readByte(), X())); incT(6); break;
-    }
-    case 0x4E: { // LSR absolute
-      lsrMemOp(readWord()); incT(6); break;
-    }
-    case 0x5E: { // LSR absolute,X
-      lsrMemOp(readWord() + X()); incT(7); break;
-    }
+  inNMI_      = state.inNMI;
+  inIRQ_      = state.inIRQ;
+  inBRK_      = state.inBRK;
+  irqLines_   = state.irqLines;
+  nmiLine_    = state.nmiLine;
+  nmiPending_ = state.nmiPending;
 
-    //-
+  updateIntPending();
 
-    case 0x6A: { // ROR A
-      rorAOp(); incT(2); break;
-    }
-    case 0x66: { // ROR zero page
-      rorMemOp(readByte()); incT(5); break;
-    }
-    case 0x76: { // ROR zero page,X
-      rorMemOp(sumBytes(readByte(), X())); incT(6); break;
-    }
-    case 0x6E: { // ROR absolute
-      rorMemOp(readWord()); incT(6); break;
-    }
-    case 0x7E: { // ROR absolute,X
-      rorMemOp(readWord() + X()); incT(7); break;
-    }
+  idle_.set = false;
 
-    //-
+  registerChanged(Reg::A); registerChanged(Reg::X); registerChanged(Reg::Y);
 
-    // BIT...
-    case 0x24: { // BIT zero page
-      bitOp(getZeroPage()); incT(3); break;
-    }
-    case 0x2C: { // BIT absolute
-      bitOp(getAbsolute()); incT(4); break;
-    }
+  flagsChanged(); stackChanged(); pcChanged();
+}
 
-    //---
+//---
 
-    case 0x08: { // PHP implied (Push Processor Status)
-      setBFlag(true);
-      setXFlag(true);
+void
+C6502::
+setCheckpoint()
+{
+  // registers only (memory saved per page on write)
+  saveRegs(checkpoint_.state);
 
-      pushByte(SR()); incT(3); break;
-    }
+  checkpoint_.set  = true;
+  checkpoint_.halt = halt_;
 
-    case 0x28: { // PLP implied (Pull Processor Status)
-      setSR(popByte()); incT(4); break;
-    }
+  checkpointEvents_ = events_;
 
-    case 0x48: { // PHA implied (Push A)
-      pushByte(A()); incT(3); break;
-    }
+  if (checkpoint_.pages.empty())
+    checkpoint_.pages.resize(0x10000);
 
-    case 0x68: { // PLA implied (Pull A)
-      setA(popByte()); setNZFlags(A()); incT(3); break;
-    }
+  checkpoint_.saved.clear();
 
-    //---
+  for (uint page = 0; page < 0x100; ++page)
+    pageFlags_[page] |= PAGE_CHECKPOINT;
 
-    // Branch, Jump
+  for (auto &range : devices_)
+    range.device->checkpoint();
+}
 
-    case 0x10: { // BPL (Branch Positive Result)
-      schar d = readSByte();
+bool
+C6502::
+restoreCheckpoint()
+{
+  if (! checkpoint_.set)
+    return false;
 
-      if (! Nflag()) {
-        setPC(ushort(PC() + d));
+  // copy back written pages and rearm them so checkpoint can be restored again
+  for (auto page : checkpoint_.saved) {
+    ushort addr = ushort(page << 8);
 
-        if (d == -2)
-          illegalJump();
-      }
+    std::memcpy(&mem_[addr], &checkpoint_.pages[addr], 0x100);
 
-      incT(2);
+    pageFlags_[page] |= PAGE_CHECKPOINT;
 
-      break;
-    }
+    dirtyPage(page);
 
-    case 0x20: { // JSR (Jump Save Return)
-      ushort oldPC = PC();
+    if (hashMem_)
+      invalidatePageHash(page);
 
-      pushWord(PC() + 1); // next address (PC + 2) - 1
+    if (! devices_.empty())
+      resetDevices(addr, 0x100);
 
-      setPC(readWord());
+    memChanged(addr, 0x100);
+  }
 
-      incT(6);
+  checkpoint_.saved.clear();
 
-      if (isEnableOutputProcs()) {
-        if      (PC() == outAddr_ || PC() == outNAddr_) {
-          bool nl = (PC() == outAddr_);
-
-          uchar c1 = getByte(oldPC + 3);
-
-          if (c1 & 0x01) { std::cout << " A=" ; outputHex02(std::cout, A()); }
-          if (c1 & 0x02) { std::cout << " X=" ; outputHex02(std::cout, X()); }
-          if (c1 & 0x04) { std::cout << " Y=" ; outputHex02(std::cout, Y()); }
-          if (c1 & 0x08) { std::cout << " SP="; outputHex02(std::cout, SP()); }
-          if (c1 & 0x10) { std::cout << " PC="; outputHex04(std::cout, PC()); }
-
-          if (c1 & 0x80) {
-            std::cout << " SR=";
-            std::cout << (Nflag() ? "N" : "-");
-            std::cout << (Vflag() ? "V" : "-");
-            std::cout << (Xflag() ? "X" : "-");
-            std::cout << (Bflag() ? "B" : "-");
-            std::cout << (Dflag() ? "D" : "-");
-            std::cout << (Iflag() ? "I" : "-");
-            std::cout << (Zflag() ? "Z" : "-");
-            std::cout << (Cflag() ? "C" : "-");
-          }
+  ++memChanges_;
 
-          if (nl)
-            std::cout << "\n";
+  restoreRegs(checkpoint_.state);
 
-          (void) popWord();
+  halt_ = checkpoint_.halt;
 
-          setPC(oldPC + 4);
+  // event ids are not reused so restored events can still be cancelled by id
+  events_ = checkpointEvents_;
 
-          break;
-        }
-        else if (PC() == outMemAddr_ || PC() == outMemNAddr_) {
-          bool nl = (PC() == outMemAddr_);
+  updateNextEventT();
 
-          ushort addr1 = getWord(oldPC + 3);
+  for (auto &range : devices_)
+    range.device->restoreCheckpoint();
 
-          uchar c1 = getByte(addr1);
+  return true;
+}
 
-          outputHex02(std::cout, c1);
+void
+C6502::
+clearCheckpoint()
+{
+  checkpoint_.set = false;
 
-          if (nl)
-            std::cout << "\n";
+  checkpoint_.saved.clear();
 
-          (void) popWord();
+  checkpointEvents_.clear();
 
-          setPC(oldPC + 5);
+  for (uint page = 0; page < 0x100; ++page)
+    pageFlags_[page] &= ~PAGE_CHECKPOINT;
+}
 
-          break;
-        }
-        else if (PC() == outStrAddr_) {
-          ushort addr1 = getWord(oldPC + 3);
+void
+C6502::
+checkpointPage(uint page)
+{
+  if (! (pageFlags_[page] & PAGE_CHECKPOINT))
+    return;
 
-          uchar c1 = getByte(addr1);
+  ushort addr = ushort(page << 8);
 
-          while (c1) {
-            char c2 = char(c1);
+  std::memcpy(&checkpoint_.pages[addr], &mem_[addr], 0x100);
 
-            if (isspace(c2) || isprint(c2))
-              std::cout << c2;
-            else
-              std::cout << '.';
+  checkpoint_.saved.push_back(uchar(page));
 
-            c1 = getByte(++addr1);
-          }
+  pageFlags_[page] &= ~PAGE_CHECKPOINT;
+}
 
-          (void) popWord();
+void
+C6502::
+prepareWritePages(ushort addr, uint len)
+{
+  if (len == 0)
+    return;
 
-          setPC(oldPC + 5);
+  uint page2 = std::min((uint(addr) + len - 1) >> 8, 0xFFU);
 
-          break;
-        }
-      }
+  for (uint page = (addr >> 8); page <= page2; ++page) {
+    checkpointPage(page);
 
-      if (isJumpPoint(PC()))
-        jumpPointHit(c);
+    dirtyPage(page);
 
-      if (PC() == oldPC - 1)
-        illegalJump();
+    if (hashMem_)
+      invalidatePageHash(page);
+  }
+}
 
-      break;
-    }
+//---
 
-    case 0x30: { // BMI (Branch Negative Result)
-      schar d = readSByte();
+void
+C6502::
+setTrackDirtyPages(bool b)
+{
+  trackDirty_ = b;
 
-      if (Nflag()) {
-        setPC(ushort(PC() + d));
+  dirtyPages_.clear();
 
-        if (d == -2)
-          illegalJump();
-      }
+  for (uint page = 0; page < 0x100; ++page) {
+    if (b)
+      pageFlags_[page] |= PAGE_CLEAN;
+    else
+      pageFlags_[page] &= ~PAGE_CLEAN;
+  }
+}
 
-      incT(2);
+void
+C6502::
+setHashMemory(bool b)
+{
+  hashMem_ = b;
 
-      break;
-    }
+  for (uint page = 0; page < 0x100; ++page) {
+    if (b)
+      pageFlags_[page] |= PAGE_HASH;
+    else
+      pageFlags_[page] &= ~PAGE_HASH;
+  }
 
-    case 0x50: { // BVC (Branch Overflow Clear)
-      schar d = readSByte();
+  // all pages calculated on first access
+  memHash_ = 0;
 
-      if (! Vflag()) {
-        setPC(ushort(PC() + d));
+  std::memset(&pageHash_ [0], 0, sizeof(pageHash_ ));
+  std::memset(&hashStale_[0], 0, sizeof(hashStale_));
 
-        if (d == -2)
-          illegalJump();
-      }
+  numHashStale_ = 0;
 
-      incT(2);
+  if (b) {
+    for (uint page = 0; page < 0x100; ++page)
+      invalidatePageHash(page);
+  }
+}
 
-      break;
-    }
+void
+C6502::
+setWriteJournal(bool b)
+{
+  journalOn_ = b;
 
-    case 0x70: { // BVS (Branch Overflow Set)
-      schar d = readSByte();
+  for (uint page = 0; page < 0x100; ++page) {
+    if (b)
+      pageFlags_[page] |= PAGE_JOURNAL;
+    else
+      pageFlags_[page] &= ~PAGE_JOURNAL;
+  }
 
-      if (Vflag()) {
-        setPC(ushort(PC() + d));
+  journal_.clear();
+}
 
-        if (d == -2)
-          illegalJump();
-      }
+void
+C6502::
+updateStaleHashes() const
+{
+  for (uint page = 0; numHashStale_ > 0 && page < 0x100; ++page) {
+    if (! hashStale_[page]) continue;
 
-      incT(2);
+    ulong h = 0;
 
-      break;
-    }
+    ushort addr = ushort(page << 8);
 
-    case 0x90: { // BCC (Branch Carry Clear)
-      schar d = readSByte();
+    for (uint i = 0; i < 0x100; ++i, ++addr)
+      h ^= byteHash(addr, mem_[addr]);
 
-      if (! Cflag()) {
-        setPC(ushort(PC() + d));
+    memHash_ ^= pageHash_[page] ^ h;
 
-        if (d == -2)
-          illegalJump();
-      }
+    pageHash_[page] = h;
 
-      incT(2);
+    hashStale_[page] = 0;
 
-      break;
-    }
+    --numHashStale_;
+  }
+}
 
-    case 0xB0: { // BCS (Branch Carry Set)
-      schar d = readSByte();
+C6502::ulong
+C6502::
+pageHash(uint page) const
+{
+  if (numHashStale_)
+    updateStaleHashes();
 
-      if (Cflag()) {
-        setPC(ushort(PC() + d));
+  return pageHash_[page & 0xFF];
+}
 
-        if (d == -2)
-          illegalJump();
-      }
+C6502::ulong
+C6502::
+memHash() const
+{
+  if (numHashStale_)
+    updateStaleHashes();
 
-      incT(2);
+  return memHash_;
+}
 
-      break;
-    }
+C6502::ulong
+C6502::
+stateHash() const
+{
+  ulong regs = (ulong(PC_) << 40) | (ulong(A_) << 32) | (ulong(X_) << 24) |
+               (ulong(Y_) << 16) | (ulong(SR_) << 8) | ulong(SP_);
 
-    case 0xD0: { // BNE (Branch Zero Clear)
-      schar d = readSByte();
+  // mix registers so they don't cancel with memory byte hashes
+  ulong z = regs*0xD6E8FEB86659FD93UL;
 
-      if (! Zflag()) {
-        setPC(ushort(PC() + d));
+  z ^= z >> 32;
 
-        if (d == -2)
-          illegalJump();
-      }
+  return memHash() ^ z;
+}
 
-      incT(2);
+uint
+C6502::
+diffPages(const C6502 &cpu, std::vector<uchar> &pages) const
+{
+  assert(hashMem_ && cpu.hashMem_);
 
-      break;
-    }
+  if (numHashStale_)
+    updateStaleHashes();
 
-    case 0xF0: { // BEQ (Branch Zero Set)
-      schar d = readSByte();
+  if (cpu.numHashStale_)
+    cpu.updateStaleHashes();
 
-      if (Zflag()) {
-        setPC(ushort(PC() + d));
+  pages.clear();
 
-        if (d == -2)
-          illegalJump();
-      }
+  if (memHash_ == cpu.memHash_)
+    return 0;
 
-      incT(2);
+  for (uint page = 0; page < 0x100; ++page) {
+    if (pageHash_[page] != cpu.pageHash_[page])
+      pages.push_back(uchar(page));
+  }
 
-      break;
-    }
+  return uint(pages.size());
+}
 
-    case 0x4C: { // JMP absolute
-      ushort oldPC = PC();
+void
+C6502::
+clearDirtyPages()
+{
+  if (! trackDirty_)
+    return;
 
-      setPC(readWord()); incT(3);
+  for (auto page : dirtyPages_)
+    pageFlags_[page] |= PAGE_CLEAN;
 
-      if (isJumpPoint(PC()))
-        jumpPointHit(c);
+  dirtyPages_.clear();
+}
 
-      if (PC() == oldPC - 1)
-        illegalJump();
+namespace {
 
-      break;
-    }
+const char *stateMagic = "C6502ST1";
 
-    case 0x6C: { // JMP indirect (???)
-      ushort oldPC = PC();
+}
 
-      setPC(getWord(readWord())); incT(3);
+bool
+C6502::
+saveState(const std::string &filename) const
+{
+  State state;
 
-      if (isJumpPoint(PC()))
-        jumpPointHit(c);
+  saveState(state);
 
-      if (PC() == oldPC - 1)
-        illegalJump();
+  FILE *fp = fopen(filename.c_str(), "wb");
+  if (! fp) return false;
 
-      break;
-    }
+  uchar regs[7] = { uchar(state.PC & 0xFF), uchar(state.PC >> 8),
+                    state.A, state.X, state.Y, state.SR, state.SP };
+  uchar ints[4] = { state.inNMI, state.inIRQ, state.inBRK, uchar(state.nmiLine | state.nmiPending << 1) };
 
-    case 0x40: { // RTI (Return from Interrupt)
-      rti();
+  uint64_t t        = state.t;
+  uint32_t irqLines = state.irqLines;
+
+  bool rc = (fwrite(stateMagic, 1, 8, fp) == 8 &&
+             fwrite(regs, 1, 7, fp) == 7 &&
+             fwrite(&t, sizeof(t), 1, fp) == 1 &&
+             fwrite(ints, 1, 4, fp) == 4 &&
+             fwrite(&irqLines, sizeof(irqLines), 1, fp) == 1 &&
+             fwrite(&state.mem[0], 1, 0x10000, fp) == 0x10000);
+
+  fclose(fp);
+
+  return rc;
+}
+
+bool
+C6502::
+loadState(const std::string &filename)
+{
+  FILE *fp = fopen(filename.c_str(), "rb");
+  if (! fp) return false;
+
+  State state;
+
+  state.mem.resize(0x10000);
+
+  char     magic[8];
+  uchar    regs[7];
+  uchar    ints[4];
+  uint64_t t;
+  uint32_t irqLines;
+
+  bool rc = (fread(magic, 1, 8, fp) == 8 && std::memcmp(magic, stateMagic, 8) == 0 &&
+             fread(regs, 1, 7, fp) == 7 &&
+             fread(&t, sizeof(t), 1, fp) == 1 &&
+             fread(ints, 1, 4, fp) == 4 &&
+             fread(&irqLines, sizeof(irqLines), 1, fp) == 1 &&
+             fread(&state.mem[0], 1, 0x10000, fp) == 0x10000);
+
+  fclose(fp);
+
+  if (! rc)
+    return false;
+
+  state.PC = ushort(regs[0] | (regs[1] << 8));
+  state.A  = regs[2];
+  state.X  = regs[3];
+  state.Y  = regs[4];
+  state.SR = regs[5];
+  state.SP = regs[6];
+  state.t  = ulong(t);
+
+  state.inNMI      = ints[0];
+  state.inIRQ      = ints[1];
+  state.inBRK      = ints[2];
+  state.nmiLine    = ints[3] & 0x01;
+  state.nmiPending = ints[3] & 0x02;
+  state.irqLines   = irqLines;
+
+  restoreState(state);
+
+  return true;
+}
+
+//---
+
+bool
+C6502::
+run()
+{
+  return run(PC());
+}
+
+bool
+C6502::
+run(ushort addr)
+{
+  reset();
+
+  setPC(addr);
+
+  update();
+
+  return cont();
+}
 
+// run for at most n cycles (budget end is an event so idle loops can skip to it)
+bool
+C6502::
+contCycles(ulong n)
+{
+  uint id = addEventIn(n, [this]() { setBreak(true); });
+
+  bool rc = cont();
+
+  cancelEvent(id);
+
+  return rc;
+}
+
+bool
+C6502::
+cont()
+{
+  setBreak(false);
+
+  while (! isHalt()) {
+    step();
+
+    update();
+
+    if (isBreak())
+      break;
+
+    if (isTmpBreakpoint(PC()) || isBreakpoint(PC())) {
+      breakpointHit();
       break;
     }
+  }
 
-    case 0x60: { // RTS (Return from Subroutine)
-      setPC(popWord() + 1); // JSR pushed return address - 1
+  output_.flush();
 
-      incT(6);
+  return true;
+}
+
+// instruction dispatch (switch instantiated per variant)
+template<C6502::Variant V>
+void
+C6502::
+stepVariant()
+{
+  auto c = readByte();
+
+  switch (c) {
+    case 0x00: { // BRK implicit
+      setBFlag(true);
+      setXFlag(true);
+
+      resetBRK();
+
+      setBreak(true);
+
+      handleBreak();
 
       break;
     }
 
     //---
 
-    // Compare
-
-    // CPY ...
-    case 0xC0: { // CPY immediate
-      uchar c1 = readByte();    cpyOp(c1); incT(2); break;
+    // AND ...
+    case 0x21: { // AND (indirect,X)
+      andOp(getMemIndexedIndirectX()); incT(6); break;
     }
-    case 0xC4: { // CPY zero page
-      uchar c1 = getZeroPage(); cpyOp(c1); incT(3); break;
+    case 0x25: { // AND zero page
+      andOp(getZeroPage()); incT(3); break;
     }
-    case 0xCC: { // CPY absolute
-      uchar c1 = getAbsolute(); cpyOp(c1); incT(4); break;
+    case 0x29: { // AND immediate
+      andOp(readByte()); incT(2); break;
     }
-
-    // CPX ...
-    case 0xE0: { // CPX immediate
-      uchar c1 = readByte();    cpxOp(c1); incT(2); break;
+    case 0x2D: { // AND absolute
+      andOp(getAbsolute()); incT(4); break;
     }
-    case 0xE4: { // CPX zero page
-      uchar c1 = getZeroPage(); cpxOp(c1); incT(3); break;
+    case 0x31: { // AND (indirect),Y
+      andOp(getMemIndirectIndexedY()); incT(5); break;
     }
-    case 0xEC: { // CPX absolute
-      uchar c1 = getAbsolute(); cpxOp(c1); incT(4); break;
+    case 0x35: { // AND zero page,X
+      andOp(getZeroPageX()); incT(4); break;
+    }
+    case 0x39: { // AND absolute,Y
+      andOp(getAbsoluteY()); incT(4); break;
+    }
+    case 0x3D: { // AND absolute,X
+      andOp(getAbsoluteX()); incT(4); break;
     }
 
-    // CMP ...
-    case 0xC1: { // CMP (indirect,X)
-      uchar c1 = getMemIndexedIndirectX(); cmpOp(c1); incT(5); break;
+    //---
+
+    // ORA ...
+    case 0x01: { // ORA (indirect,X)
+      orOp(getMemIndexedIndirectX()); incT(6); break;
     }
-    case 0xC5: { // CMP zero page
-      uchar c1 = getZeroPage();            cmpOp(c1); incT(3); break;
+    case 0x05: { // ORA zero page
+      orOp(getZeroPage()); incT(3); break;
     }
-    case 0xC9: { // CMP immediate
-      uchar c1 = readByte();               cmpOp(c1); incT(2); break;
+    case 0x09: { // ORA immediate
+      orOp(readByte()); incT(2); break;
     }
-    case 0xCD: { // CMP absolute
-      uchar c1 = getAbsolute();            cmpOp(c1); incT(4); break;
+    case 0x0D: { // ORA absolute
+      orOp(getAbsolute()); incT(4); break;
     }
-    case 0xD1: { // CMP (indirect),Y
-      uchar c1 = getMemIndirectIndexedY(); cmpOp(c1); incT(5); break;
+    case 0x11: { // ORA (indirect),Y
+      orOp(getMemIndirectIndexedY()); incT(5); break;
     }
-    case 0xD5: { // CMP zero page,X
-      uchar c1 = getZeroPageX();           cmpOp(c1); incT(4); break;
+    case 0x15: { // ORA zero page,X
+      orOp(getZeroPageX()); incT(4); break;
     }
-    case 0xD9: { // CMP absolute,Y
-      uchar c1 = getAbsoluteY();           cmpOp(c1); incT(4); break;
+    case 0x19: { // ORA absolute,Y
+      orOp(getAbsoluteY()); incT(4); break;
     }
-    case 0xDD: { // CMP absolute,X
-      uchar c1 = getAbsoluteX();           cmpOp(c1); incT(4); break;
+    case 0x1D: { // ORA absolute,X
+      orOp(getAbsoluteX()); incT(4); break;
     }
 
     //---
 
-    case 0x18: { // CLC (Clear carry)
-      setCFlag(false); incT(2); break;
+    // EOR ...
+    case 0x41: { // EOR (indirect,X)
+      eorOp(getMemIndexedIndirectX()); incT(6); break;
     }
-
-    case 0x38: { // SEC (Set carry)
-      setCFlag(true); incT(2); break;
+    case 0x45: { // EOR zero page
+      eorOp(getZeroPage()); incT(3); break;
     }
-
-    case 0x58: { // CLI (Clear Interrupt Disable)
-      setIFlag(false); incT(2); break;
+    case 0x49: { // EOR immediate
+      eorOp(readByte()); incT(2); break;
     }
-
-    case 0x78: { // SEI (Set Interrupt Disable)
-      setIFlag(true); incT(2); break;
+    case 0x4D: { // EOR absolute
+      eorOp(getAbsolute()); incT(4); break;
     }
-
-    case 0xB8: { // CLV (Clear overflow)
-      setVFlag(false); incT(2); break;
+    case 0x51: { // EOR (indirect),Y
+      eorOp(getMemIndirectIndexedY()); incT(5); break;
     }
-
-    case 0xD8: { // CLD (Clear Decimal Mode)
-      setDFlag(false); incT(2); break;
+    case 0x55: { // EOR zero page,X
+      eorOp(getZeroPageX()); incT(4); break;
     }
-
-    case 0xF8: { // SED (Set Decimal Mode)
-      setDFlag(true); incT(2); break;
+    case 0x59: { // EOR absolute,Y
+      eorOp(getAbsoluteY()); incT(4); break;
+    }
+    case 0x5D: { // EOR absolute,X
+      eorOp(getAbsoluteX()); incT(4); break;
     }
 
     //---
 
-    // Store
-
-    // STA ...
-    case 0x81: { // STA (indirect,X)
-      setMemIndexedIndirectX(readByte(), A()); incT(6); break;
-    }
-    case 0x85: { // STA zero page
-      setZeroPage(A()); incT(3); break;
-    }
-    case 0x8D: { // STA absolute
-      setAbsolute(A()); incT(4); break;
+    // ADC ...
+    case 0x61: { // ADC (indirect,X)
+      adcOp<V>(getMemIndexedIndirectX()); incT(6); break;
     }
-    case 0x91: { // STA (indirect),Y
-      setMemIndirectIndexedY(readByte(), A()); incT(6); break;
+    case 0x65: { // ADC zero page
+      adcOp<V>(getZeroPage()); incT(3); break;
     }
-    case 0x95: { // STA zero page,X
-      setZeroPageX(A()); incT(4); break;
+    case 0x69: { // ADC immediate
+      adcOp<V>(readByte()); incT(2); break;
     }
-    case 0x99: { // STA absolute,Y
-      setAbsoluteY(A()); incT(5); break;
+    case 0x6D: { // ADC absolute
+      adcOp<V>(getAbsolute()); incT(4); break;
     }
-    case 0x9D: { // STA absolute,X
-      setAbsoluteX(A()); incT(5); break;
+    case 0x71: { // ADC (indirect),Y
+      adcOp<V>(getMemIndirectIndexedY()); incT(5); break;
     }
-
-    // STY ...
-    case 0x84: { // STY zero page
-      setZeroPage(Y()); incT(3); break;
+    case 0x75: { // ADC zero page,X
+      adcOp<V>(getZeroPageX()); incT(4); break;
     }
-    case 0x8C: { // STY absolute
-      setAbsolute(Y()); incT(4); break;
+    case 0x79: { // ADC absolute,Y
+      adcOp<V>(getAbsoluteY()); incT(4); break;
     }
-    case 0x94: { // STY zero page,X
-      setZeroPageX(Y()); incT(4); break;
+    case 0x7D: { // ADC absolute,X
+      adcOp<V>(getAbsoluteX()); incT(4); break;
     }
 
-    // STX ...
-    case 0x86: { // STX zero page
-      setZeroPage(X()); incT(3); break;
+    //---
+
+    // SBC ...
+    case 0xE1: { // SBC (indirect,X)
+      sbcOp<V>(getMemIndexedIndirectX()); incT(6); break;
     }
-    case 0x8E: { // STX absolute
-      setAbsolute(X()); incT(4); break;
+    case 0xE5: { // SBC zero page
+      sbcOp<V>(getZeroPage()); incT(3); break;
     }
-    case 0x96: { // STX zero page,Y
-      setZeroPageY(X()); incT(4); break;
+    case 0xE9: { // SBC immediate
+      sbcOp<V>(readByte()); incT(2); break;
     }
-
-    case 0x8A: { // TXA (Transfer X to A)
-      setA(X()); setNZFlags(A()); incT(2); break;
+    case 0xED: { // SBC absolute
+      sbcOp<V>(getAbsolute()); incT(4); break;
     }
-    case 0x9A: { // TXS (Transfer X to SP)
-      setSP(X()); incT(2); break;
+    case 0xF1: { // SBC (indirect),Y
+      sbcOp<V>(getMemIndirectIndexedY()); incT(5); break;
     }
-    case 0xAA: { // TAX (Transfer A to X)
-      setX(A()); setNZFlags(X()); incT(2); break;
+    case 0xF5: { // SBC zero page,X
+      sbcOp<V>(getZeroPageX()); incT(4); break;
     }
-    case 0xBA: { // TSX (Transfer SP to X)
-      setX(SP()); setNZFlags(X()); incT(2); break;
+    case 0xF9: { // SBC absolute,Y
+      sbcOp<V>(getAbsoluteY()); incT(4); break;
+    }
+    case 0xFD: { // SBC absolute,X
+      sbcOp<V>(getAbsoluteX()); incT(4); break;
     }
 
-    case 0x98: { // TYA (Transfer Y to A)
-      setA(Y()); setNZFlags(A()); incT(2); break;
+    //---
+
+    // Bit functions
+
+    case 0x0A: { // ASL A
+      aslAOp(); incT(2); break;
     }
-    case 0xA8: { // TAY (Transfer A to Y)
-      setY(A()); setNZFlags(Y()); incT(2); break;
+    case 0x06: { // ASL zero page
+      aslMemOp(readByte()); incT(5); break;
+    }
+    case 0x16: { // ASL zero page,X
+      aslMemOp(sumBytes(readByte(), X())); incT(6); break;
+    }
+    case 0x0E: { // ASL absolute
+      aslMemOp(readWord()); incT(6); break;
+    }
+    case 0x1E: { // ASL absolute,X (65C02 6 cycles plus page cross)
+      if (V == Variant::CMOS) { aslMemOp(indexReadAddr(readWord(), X())); incT(6); }
+      else                    { aslMemOp(readWord() + X()); incT(7); }
+      break;
     }
 
-    // LDY...
-    case 0xA0: { // LDY immediate
-      setY(readByte()); setNZFlags(Y()); incT(3); break;
+    //-
+
+    case 0x2A: { // ROL A
+      rolAOp(); incT(2); break;
     }
-    case 0xA4: { // LDY zero page
-      setY(getZeroPage()); setNZFlags(Y()); incT(3); break;
+    case 0x26: { // ROL zero page
+      rolMemOp(readByte()); incT(5); break;
     }
-    case 0xAC: { // LDY absolute
-      setY(getAbsolute()); setNZFlags(Y()); incT(4); break;
+    case 0x36: { // ROL zero page,X
+      rolMemOp(sumBytes(readByte(), X())); incT(6); break;
     }
-    case 0xB4: { // LDY zero page,X
-      setY(getZeroPageX()); setNZFlags(Y()); incT(4); break;
+    case 0x2E: { // ROL absolute
+      rolMemOp(readWord()); incT(6); break;
     }
-    case 0xBC: { // LDY absolute,X
-      setY(getAbsoluteX()); setNZFlags(Y()); incT(4); break;
+    case 0x3E: { // ROL absolute,X (65C02 6 cycles plus page cross)
+      if (V == Variant::CMOS) { rolMemOp(indexReadAddr(readWord(), X())); incT(6); }
+      else                    { rolMemOp(readWord() + X()); incT(7); }
+      break;
     }
 
-    // LDX...
-    case 0xA2: { // LDX immediate
-      setX(readByte()); setNZFlags(X()); incT(3); break;
+    //-
+
+    case 0x4A: { // LSR A
+      lsrAOp(); incT(2); break;
     }
-    case 0xA6: { // LDX zero page
-      setX(getZeroPage()); setNZFlags(X()); incT(3); break;
+    case 0x46: { // LSR zero page
+      lsrMemOp(readByte()); incT(5); break;
     }
-    case 0xAE: { // LDX absolute
-      setX(getAbsolute()); setNZFlags(X()); incT(4); break;
+    case 0x56: { // LSR zero page,X
+      lsrMemOp(sumBytes(readByte(), X())); incT(6); break;
     }
-    case 0xB6: { // LDX zero page,Y
-      setX(getZeroPageY()); setNZFlags(X()); incT(4); break;
+    case 0x4E: { // LSR absolute
+      lsrMemOp(readWord()); incT(6); break;
     }
-    case 0xBE: { // LDX absolute,Y
-      setX(getAbsoluteY()); setNZFlags(X()); incT(4); break;
+    case 0x5E: { // LSR absolute,X (65C02 6 cycles plus page cross)
+      if (V == Variant::CMOS) { lsrMemOp(indexReadAddr(readWord(), X())); incT(6); }
+      else                    { lsrMemOp(readWord() + X()); incT(7); }
+      break;
     }
 
-    // LDA...
-    case 0xA1: { // LDA (indirect,X)
-      setA(getMemIndexedIndirectX()); setNZFlags(A()); incT(6); break;
-    }
-    case 0xA5: { // LDA zero page
-      setA(getZeroPage()); setNZFlags(A()); incT(3); break;
+    //-
+
+    case 0x6A: { // ROR A
+      rorAOp(); incT(2); break;
     }
-    case 0xA9: { // LDA immediate
-      setA(readByte()); setNZFlags(A()); incT(2); break;
+    case 0x66: { // ROR zero page
+      rorMemOp(readByte()); incT(5); break;
     }
-    case 0xAD: { // LDA absolute
-      setA(getAbsolute()); setNZFlags(A()); incT(4); break;
+    case 0x76: { // ROR zero page,X
+      rorMemOp(sumBytes(readByte(), X())); incT(6); break;
     }
-    case 0xB1: { // LDA (indirect),Y
-      setA(getMemIndirectIndexedY()); setNZFlags(A()); incT(5); break;
+    case 0x6E: { // ROR absolute
+      rorMemOp(readWord()); incT(6); break;
     }
-    case 0xB5: { // LDA zero page,X
-      setA(getZeroPageX()); setNZFlags(A()); incT(4); break;
+    case 0x7E: { // ROR absolute,X (65C02 6 cycles plus page cross)
+      if (V == Variant::CMOS) { rorMemOp(indexReadAddr(readWord(), X())); incT(6); }
+      else                    { rorMemOp(readWord() + X()); incT(7); }
+      break;
     }
-    case 0xB9: { // LDA absolute,Y
-      setA(getAbsoluteY()); setNZFlags(A()); incT(4); break;
+
+    //-
+
+    // BIT...
+    case 0x24: { // BIT zero page
+      bitOp(getZeroPage()); incT(3); break;
     }
-    case 0xBD: { // LDA absolute,X
-      setA(getAbsoluteX()); setNZFlags(A()); incT(4); break;
+    case 0x2C: { // BIT absolute
+      bitOp(getAbsolute()); incT(4); break;
     }
 
     //---
 
-    // Increment/Decrement
+    case 0x08: { // PHP implied (Push Processor Status)
+      setBFlag(true);
+      setXFlag(true);
 
-    case 0x88: { // DEY
-      setY(Y() - 1); setNZFlags(Y()); incT(2); break;
-    }
-    case 0xCA: { // DEX
-      setX(X() - 1); setNZFlags(X()); incT(2); break;
+      pushByte(SR()); incT(3); break;
     }
 
-    case 0xC8: { // INY
-      setY(Y() + 1); setNZFlags(Y()); incT(2); break;
-    }
-    case 0xE8: { // INX
-      setX(X() + 1); setNZFlags(X()); incT(2); break;
+    case 0x28: { // PLP implied (Pull Processor Status)
+      setSR(popByte()); incT(4); break;
     }
 
-    // DEC ...
-    case 0xC6: { // DEC zero page
-      ushort a = readByte(); uchar c1 = getByte(a) - 1;
-      setByte(a, c1); setNZFlags(c1); incT(5); break;
-    }
-    case 0xCE: { // DEC absolute
-      ushort a = readWord(); uchar c1 = getByte(a) - 1;
-      setByte(a, c1); setNZFlags(c1); incT(6); break;
-    }
-    case 0xD6: { // DEC zero page,X
-      ushort a = sumBytes(readByte(), X()); uchar c1 = getByte(a) - 1;
-      setByte(a, c1); setNZFlags(c1); incT(6); break;
+    case 0x48: { // PHA implied (Push A)
+      pushByte(A()); incT(3); break;
     }
-    case 0xDE: { // DEC absolute,X
-      ushort a = readWord() + X(); uchar c1 = getByte(a) - 1;
-      setByte(a, c1); setNZFlags(c1); incT(7); break;
+
+    case 0x68: { // PLA implied (Pull A)
+      setA(popByte()); setNZFlags(A()); incT(4); break;
     }
 
-    // INC ...
-    case 0xE6: { // INC zero page
-      ushort a = readByte(); uchar c1 = getByte(a) + 1;
-      setByte(a, c1); setNZFlags(c1); incT(5); break;
+    //---
+
+    // Branch, Jump
+
+    case 0x10: { // BPL (Branch Positive Result)
+      schar d = readSByte();
+
+      if (! Nflag()) {
+        branchTo(d);
+
+        if (d == -2)
+          illegalJump();
+
+        if (d < 0 && isIdleSkip())
+          checkIdleLoop();
+      }
+
+      incT(2);
+
+      break;
     }
-    case 0xEE: { // INC absolute
-      ushort a = readWord(); uchar c1 = getByte(a) + 1;
-      setByte(a, c1); setNZFlags(c1); incT(6); break;
+
+    case 0x20: { // JSR (Jump Save Return)
+      ushort oldPC = PC();
+
+      pushWord(PC() + 1); // next address (PC + 2) - 1
+
+      setPC(readWord());
+
+      incT(6);
+
+      if (trapInd_[PC()] && callTrap(trapInd_[PC()]))
+        break;
+
+      if (isJumpPoint(PC()))
+        jumpPointHit(c);
+
+      if (PC() == oldPC - 1)
+        illegalJump();
+
+      break;
     }
-    case 0xF6: { // INC zero page,X
-      ushort a = sumBytes(readByte(), X()); uchar c1 = getByte(a) + 1;
-      setByte(a, c1); setNZFlags(c1); incT(6); break;
+
+    case 0x30: { // BMI (Branch Negative Result)
+      schar d = readSByte();
+
+      if (Nflag()) {
+        branchTo(d);
+
+        if (d == -2)
+          illegalJump();
+
+        if (d < 0 && isIdleSkip())
+          checkIdleLoop();
+      }
+
+      incT(2);
+
+      break;
     }
-    case 0xFE: { // INC absolute,X
-      ushort a = readWord() + X(); uchar c1 = getByte(a) + 1;
-      setByte(a, c1); setNZFlags(c1); incT(7); break;
+
+    case 0x50: { // BVC (Branch Overflow Clear)
+      schar d = readSByte();
+
+      if (! Vflag()) {
+        branchTo(d);
+
+        if (d == -2)
+          illegalJump();
+
+        if (d < 0 && isIdleSkip())
+          checkIdleLoop();
+      }
+
+      incT(2);
+
+      break;
     }
 
-    //---
+    case 0x70: { // BVS (Branch Overflow Set)
+      schar d = readSByte();
 
-    case 0xEA: { // NOP
-      incT(2); break;
+      if (Vflag()) {
+        branchTo(d);
+
+        if (d == -2)
+          illegalJump();
+
+        if (d < 0 && isIdleSkip())
+          checkIdleLoop();
+      }
+
+      incT(2);
+
+      break;
     }
 
-    //---
+    case 0x90: { // BCC (Branch Carry Clear)
+      schar d = readSByte();
 
-    // unimplemented
+      if (! Cflag()) {
+        branchTo(d);
 
-              case 0x02:case 0x03:case 0x04:case 0x07:
-                        case 0x0B:case 0x0C:          case 0x0F:
-              case 0x12:case 0x13:case 0x14:case 0x17:
-              case 0x1A:case 0x1B:case 0x1C:          case 0x1F:
-              case 0x22:case 0x23:          case 0x27:
+        if (d == -2)
+          illegalJump();
+
+        if (d < 0 && isIdleSkip())
+          checkIdleLoop();
+      }
+
+      incT(2);
+
+      break;
+    }
+
+    case 0xB0: { // BCS (Branch Carry Set)
+      schar d = readSByte();
+
+      if (Cflag()) {
+        branchTo(d);
+
+        if (d == -2)
+          illegalJump();
+
+        if (d < 0 && isIdleSkip())
+          checkIdleLoop();
+      }
+
+      incT(2);
+
+      break;
+    }
+
+    case 0xD0: { // BNE (Branch Zero Clear)
+      schar d = readSByte();
+
+      if (! Zflag()) {
+        branchTo(d);
+
+        if (d == -2)
+          illegalJump();
+
+        if (d < 0 && isIdleSkip())
+          checkIdleLoop();
+      }
+
+      incT(2);
+
+      break;
+    }
+
+    case 0xF0: { // BEQ (Branch Zero Set)
+      schar d = readSByte();
+
+      if (Zflag()) {
+        branchTo(d);
+
+        if (d == -2)
+          illegalJump();
+
+        if (d < 0 && isIdleSkip())
+          checkIdleLoop();
+      }
+
+      incT(2);
+
+      break;
+    }
+
+    case 0x4C: { // JMP absolute
+      ushort oldPC = PC();
+
+      setPC(readWord()); incT(3);
+
+      if (trapInd_[PC()] && callTrap(trapInd_[PC()]))
+        break;
+
+      if (isJumpPoint(PC()))
+        jumpPointHit(c);
+
+      if (PC() == oldPC - 1)
+        illegalJump();
+
+      if (PC() < oldPC && isIdleSkip())
+        checkIdleLoop();
+
+      break;
+    }
+
+    case 0x6C: { // JMP indirect (???)
+      ushort oldPC = PC();
+
+      ushort a = readWord();
+
+      // NMOS reads high byte from start of page when address is at end of page
+      if (V == Variant::CMOS) {
+        setPC(loadWord(a)); incT(6);
+      }
+      else {
+        setPC(ushort(loadByte(a) | (loadByte(ushort((a & 0xFF00) | ((a + 1) & 0x00FF))) << 8)));
+        incT(5);
+      }
+
+      if (trapInd_[PC()] && callTrap(trapInd_[PC()]))
+        break;
+
+      if (isJumpPoint(PC()))
+        jumpPointHit(c);
+
+      if (PC() == oldPC - 1)
+        illegalJump();
+
+      if (PC() < oldPC && isIdleSkip())
+        checkIdleLoop();
+
+      break;
+    }
+
+    case 0x40: { // RTI (Return from Interrupt)
+      rti();
+
+      break;
+    }
+
+    case 0x60: { // RTS (Return from Subroutine)
+      setPC(popWord() + 1); // JSR pushed return address - 1
+
+      incT(6);
+
+      break;
+    }
+
+    //---
+
+    // Compare
+
+    // CPY ...
+    case 0xC0: { // CPY immediate
+      uchar c1 = readByte();    cpyOp(c1); incT(2); break;
+    }
+    case 0xC4: { // CPY zero page
+      uchar c1 = getZeroPage(); cpyOp(c1); incT(3); break;
+    }
+    case 0xCC: { // CPY absolute
+      uchar c1 = getAbsolute(); cpyOp(c1); incT(4); break;
+    }
+
+    // CPX ...
+    case 0xE0: { // CPX immediate
+      uchar c1 = readByte();    cpxOp(c1); incT(2); break;
+    }
+    case 0xE4: { // CPX zero page
+      uchar c1 = getZeroPage(); cpxOp(c1); incT(3); break;
+    }
+    case 0xEC: { // CPX absolute
+      uchar c1 = getAbsolute(); cpxOp(c1); incT(4); break;
+    }
+
+    // CMP ...
+    case 0xC1: { // CMP (indirect,X)
+      uchar c1 = getMemIndexedIndirectX(); cmpOp(c1); incT(6); break;
+    }
+    case 0xC5: { // CMP zero page
+      uchar c1 = getZeroPage();            cmpOp(c1); incT(3); break;
+    }
+    case 0xC9: { // CMP immediate
+      uchar c1 = readByte();               cmpOp(c1); incT(2); break;
+    }
+    case 0xCD: { // CMP absolute
+      uchar c1 = getAbsolute();            cmpOp(c1); incT(4); break;
+    }
+    case 0xD1: { // CMP (indirect),Y
+      uchar c1 = getMemIndirectIndexedY(); cmpOp(c1); incT(5); break;
+    }
+    case 0xD5: { // CMP zero page,X
+      uchar c1 = getZeroPageX();           cmpOp(c1); incT(4); break;
+    }
+    case 0xD9: { // CMP absolute,Y
+      uchar c1 = getAbsoluteY();           cmpOp(c1); incT(4); break;
+    }
+    case 0xDD: { // CMP absolute,X
+      uchar c1 = getAbsoluteX();           cmpOp(c1); incT(4); break;
+    }
+
+    //---
+
+    case 0x18: { // CLC (Clear carry)
+      setCFlag(false); incT(2); break;
+    }
+
+    case 0x38: { // SEC (Set carry)
+      setCFlag(true); incT(2); break;
+    }
+
+    case 0x58: { // CLI (Clear Interrupt Disable)
+      setIFlag(false); incT(2); break;
+    }
+
+    case 0x78: { // SEI (Set Interrupt Disable)
+      setIFlag(true); incT(2); break;
+    }
+
+    case 0xB8: { // CLV (Clear overflow)
+      setVFlag(false); incT(2); break;
+    }
+
+    case 0xD8: { // CLD (Clear Decimal Mode)
+      setDFlag(false); incT(2); break;
+    }
+
+    case 0xF8: { // SED (Set Decimal Mode)
+      setDFlag(true); incT(2); break;
+    }
+
+    //---
+
+    // Store
+
+    // STA ...
+    case 0x81: { // STA (indirect,X)
+      setMemIndexedIndirectX(readByte(), A()); incT(6); break;
+    }
+    case 0x85: { // STA zero page
+      setZeroPage(A()); incT(3); break;
+    }
+    case 0x8D: { // STA absolute
+      setAbsolute(A()); incT(4); break;
+    }
+    case 0x91: { // STA (indirect),Y
+      setMemIndirectIndexedY(readByte(), A()); incT(6); break;
+    }
+    case 0x95: { // STA zero page,X
+      setZeroPageX(A()); incT(4); break;
+    }
+    case 0x99: { // STA absolute,Y
+      setAbsoluteY(A()); incT(5); break;
+    }
+    case 0x9D: { // STA absolute,X
+      setAbsoluteX(A()); incT(5); break;
+    }
+
+    // STY ...
+    case 0x84: { // STY zero page
+      setZeroPage(Y()); incT(3); break;
+    }
+    case 0x8C: { // STY absolute
+      setAbsolute(Y()); incT(4); break;
+    }
+    case 0x94: { // STY zero page,X
+      setZeroPageX(Y()); incT(4); break;
+    }
+
+    // STX ...
+    case 0x86: { // STX zero page
+      setZeroPage(X()); incT(3); break;
+    }
+    case 0x8E: { // STX absolute
+      setAbsolute(X()); incT(4); break;
+    }
+    case 0x96: { // STX zero page,Y
+      setZeroPageY(X()); incT(4); break;
+    }
+
+    case 0x8A: { // TXA (Transfer X to A)
+      setA(X()); setNZFlags(A()); incT(2); break;
+    }
+    case 0x9A: { // TXS (Transfer X to SP)
+      setSP(X()); incT(2); break;
+    }
+    case 0xAA: { // TAX (Transfer A to X)
+      setX(A()); setNZFlags(X()); incT(2); break;
+    }
+    case 0xBA: { // TSX (Transfer SP to X)
+      setX(SP()); setNZFlags(X()); incT(2); break;
+    }
+
+    case 0x98: { // TYA (Transfer Y to A)
+      setA(Y()); setNZFlags(A()); incT(2); break;
+    }
+    case 0xA8: { // TAY (Transfer A to Y)
+      setY(A()); setNZFlags(Y()); incT(2); break;
+    }
+
+    // LDY...
+    case 0xA0: { // LDY immediate
+      setY(readByte()); setNZFlags(Y()); incT(2); break;
+    }
+    case 0xA4: { // LDY zero page
+      setY(getZeroPage()); setNZFlags(Y()); incT(3); break;
+    }
+    case 0xAC: { // LDY absolute
+      setY(getAbsolute()); setNZFlags(Y()); incT(4); break;
+    }
+    case 0xB4: { // LDY zero page,X
+      setY(getZeroPageX()); setNZFlags(Y()); incT(4); break;
+    }
+    case 0xBC: { // LDY absolute,X
+      setY(getAbsoluteX()); setNZFlags(Y()); incT(4); break;
+    }
+
+    // LDX...
+    case 0xA2: { // LDX immediate
+      setX(readByte()); setNZFlags(X()); incT(2); break;
+    }
+    case 0xA6: { // LDX zero page
+      setX(getZeroPage()); setNZFlags(X()); incT(3); break;
+    }
+    case 0xAE: { // LDX absolute
+      setX(getAbsolute()); setNZFlags(X()); incT(4); break;
+    }
+    case 0xB6: { // LDX zero page,Y
+      setX(getZeroPageY()); setNZFlags(X()); incT(4); break;
+    }
+    case 0xBE: { // LDX absolute,Y
+      setX(getAbsoluteY()); setNZFlags(X()); incT(4); break;
+    }
+
+    // LDA...
+    case 0xA1: { // LDA (indirect,X)
+      setA(getMemIndexedIndirectX()); setNZFlags(A()); incT(6); break;
+    }
+    case 0xA5: { // LDA zero page
+      setA(getZeroPage()); setNZFlags(A()); incT(3); break;
+    }
+    case 0xA9: { // LDA immediate
+      setA(readByte()); setNZFlags(A()); incT(2); break;
+    }
+    case 0xAD: { // LDA absolute
+      setA(getAbsolute()); setNZFlags(A()); incT(4); break;
+    }
+    case 0xB1: { // LDA (indirect),Y
+      setA(getMemIndirectIndexedY()); setNZFlags(A()); incT(5); break;
+    }
+    case 0xB5: { // LDA zero page,X
+      setA(getZeroPageX()); setNZFlags(A()); incT(4); break;
+    }
+    case 0xB9: { // LDA absolute,Y
+      setA(getAbsoluteY()); setNZFlags(A()); incT(4); break;
+    }
+    case 0xBD: { // LDA absolute,X
+      setA(getAbsoluteX()); setNZFlags(A()); incT(4); break;
+    }
+
+    //---
+
+    // Increment/Decrement
+
+    case 0x88: { // DEY
+      setY(Y() - 1); setNZFlags(Y()); incT(2); break;
+    }
+    case 0xCA: { // DEX
+      setX(X() - 1); setNZFlags(X()); incT(2); break;
+    }
+
+    case 0xC8: { // INY
+      setY(Y() + 1); setNZFlags(Y()); incT(2); break;
+    }
+    case 0xE8: { // INX
+      setX(X() + 1); setNZFlags(X()); incT(2); break;
+    }
+
+    // DEC ...
+    case 0xC6: { // DEC zero page
+      ushort a = readByte(); uchar c1 = loadByte(a) - 1;
+      setByte(a, c1); setNZFlags(c1); incT(5); break;
+    }
+    case 0xCE: { // DEC absolute
+      ushort a = readWord(); uchar c1 = loadByte(a) - 1;
+      setByte(a, c1); setNZFlags(c1); incT(6); break;
+    }
+    case 0xD6: { // DEC zero page,X
+      ushort a = sumBytes(readByte(), X()); uchar c1 = loadByte(a) - 1;
+      setByte(a, c1); setNZFlags(c1); incT(6); break;
+    }
+    case 0xDE: { // DEC absolute,X
+      ushort a = readWord() + X(); uchar c1 = loadByte(a) - 1;
+      setByte(a, c1); setNZFlags(c1); incT(7); break;
+    }
+
+    // INC ...
+    case 0xE6: { // INC zero page
+      ushort a = readByte(); uchar c1 = loadByte(a) + 1;
+      setByte(a, c1); setNZFlags(c1); incT(5); break;
+    }
+    case 0xEE: { // INC absolute
+      ushort a = readWord(); uchar c1 = loadByte(a) + 1;
+      setByte(a, c1); setNZFlags(c1); incT(6); break;
+    }
+    case 0xF6: { // INC zero page,X
+      ushort a = sumBytes(readByte(), X()); uchar c1 = loadByte(a) + 1;
+      setByte(a, c1); setNZFlags(c1); incT(6); break;
+    }
+    case 0xFE: { // INC absolute,X
+      ushort a = readWord() + X(); uchar c1 = loadByte(a) + 1;
+      setByte(a, c1); setNZFlags(c1); incT(7); break;
+    }
+
+    //---
+
+    case 0xEA: { // NOP
+      incT(2); break;
+    }
+
+    //---
+
+    // unimplemented
+
+              case 0x02:case 0x03:case 0x04:case 0x07:
+                        case 0x0B:case 0x0C:          case 0x0F:
+              case 0x12:case 0x13:case 0x14:case 0x17:
+              case 0x1A:case 0x1B:case 0x1C:          case 0x1F:
+              case 0x22:case 0x23:          case 0x27:
                         case 0x2B:                    case 0x2F:
               case 0x32:case 0x33:case 0x34:case 0x37:
               case 0x3A:case 0x3B:case 0x3C:          case 0x3F:
@@ -1023,288 +1765,1433 @@ step()
                         case 0xEB:                    case 0xEF:
               case 0xF2:case 0xF3:case 0xF4:case 0xF7:
               case 0xFA:case 0xFB:case 0xFC:          case 0xFF: {
-      if (isUnsupported()) {
-        switch (c) {
-          // KIL
-          case 0x02: case 0x12: case 0x22: case 0x32: case 0x42: case 0x52: case 0x62:
-          case 0x72: case 0x92: case 0xB2: case 0xD2: case 0xF2:
-            // TODO:
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
+      // 65C02 instructions and NOPs
+      if constexpr (V == Variant::CMOS) {
+        stepCMOS(c);
+        break;
+      }
+
+      if (isUnsupported())
+        stepUndocumented<V>(c);
+      else {
+        std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
+        std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
+        setBreak(true);
+      }
+
+      break;
+    }
+
+    default:
+      assert(false);
+      break;
+  }
+
+  // single compare per instruction, events (timers, IRQ sources) only run when due
+  if (t_ >= nextEventT_)
+    processEvents();
+
+  // single flag for both interrupt lines
+  if (intPending_)
+    processInterrupts();
+}
+
+// NMOS undocumented instructions
+//  unstable XAA/LAX immediate use 0xEE for the A register 'magic' constant,
+//  AHX/SHX/SHY/TAS store to (value << 8 | low byte) when index crosses page
+template<C6502::Variant V>
+void
+C6502::
+stepUndocumented(uchar c)
+{
+  // address and cycles for read/modify/write group (SLO, RLA, SRE, RRA, DCP, ISC)
+  auto rmwAddr = [&](uchar &n) {
+    switch (c & 0x1F) {
+      case 0x03: n = 8; return ushort(loadWord(sumBytes(readByte(), X()))); // (zero page,X)
+      case 0x07: n = 5; return ushort(readByte());                         // zero page
+      case 0x0F: n = 6; return readWord();                                 // absolute
+      case 0x13: n = 8; return ushort(loadWord(readByte()) + Y());          // (zero page),Y
+      case 0x17: n = 6; return ushort(sumBytes(readByte(), X()));          // zero page,X
+      case 0x1B: n = 7; return ushort(readWord() + Y());                   // absolute,Y
+      default  : n = 7; return ushort(readWord() + X());                   // absolute,X
+    }
+  };
+
+  // store (value AND high byte of address plus one) with page cross address corruption
+  auto storeHigh = [&](ushort base, uchar ind, uchar value) {
+    ushort a = ushort(base + ind);
+
+    uchar v = uchar(value & ((base >> 8) + 1));
+
+    if ((base ^ a) & 0xFF00)
+      a = ushort((v << 8) | (a & 0x00FF));
+
+    setByte(a, v);
+  };
+
+  const uchar magic = 0xEE;
+
+  switch (c) {
+    // KIL (jam: CPU stops with PC on opcode until reset)
+    case 0x02: case 0x12: case 0x22: case 0x32: case 0x42: case 0x52: case 0x62:
+    case 0x72: case 0x92: case 0xB2: case 0xD2: case 0xF2:
+      setPC(PC() - 1); setHalt(true); break;
+
+    // NOP
+    case 0x04:            case 0x44: case 0x64:
+      // zero page
+      readByte(); incT(3); break;
+    case 0x14: case 0x34: case 0x54: case 0x74: case 0xD4: case 0xF4:
+      // zero page x
+      readByte(); incT(4); break;
+    case 0x1A: case 0x3A: case 0x5A: case 0x7A: case 0xDA: case 0xFA:
+      incT(2); break;
+    case 0x0C:
+      // absolute
+      readWord(); incT(4); break;
+    case 0x1C: case 0x3C: case 0x5C: case 0x7C: case 0xDC: case 0xFC:
+      // absolute x (extra cycle if page crossed)
+      indexReadAddr(readWord(), X()); incT(4); break;
+    case 0x80: case 0x82: case 0x89: case 0xC2: case 0xE2:
+      // immediate
+      readByte(); incT(2); break;
+
+    // SLO (ASL + ORA)
+    case 0x03: case 0x07: case 0x0F:
+    case 0x13: case 0x17: case 0x1B: case 0x1F: {
+      uchar n; ushort a = rmwAddr(n); uchar c1 = loadByte(a);
+      bool C = aslCalc(c1); setByte(a, c1); setCFlag(C); orOp(c1); incT(n); break;
+    }
+    // RLA (ROL + AND)
+    case 0x23: case 0x27: case 0x2F:
+    case 0x33: case 0x37: case 0x3B: case 0x3F: {
+      uchar n; ushort a = rmwAddr(n); uchar c1 = loadByte(a);
+      bool C = rolCalc(c1); setByte(a, c1); setCFlag(C); andOp(c1); incT(n); break;
+    }
+    // SRE (LSR + EOR)
+    case 0x43: case 0x47: case 0x4F:
+    case 0x53: case 0x57: case 0x5B: case 0x5F: {
+      uchar n; ushort a = rmwAddr(n); uchar c1 = loadByte(a);
+      bool C = lsrCalc(c1); setByte(a, c1); setCFlag(C); eorOp(c1); incT(n); break;
+    }
+    // RRA (ROR + ADC)
+    case 0x63: case 0x67: case 0x6F:
+    case 0x73: case 0x77: case 0x7B: case 0x7F: {
+      uchar n; ushort a = rmwAddr(n); uchar c1 = loadByte(a);
+      bool C = rorCalc(c1); setByte(a, c1); setCFlag(C); adcOp<V>(c1); incT(n); break;
+    }
+    // DCP (DEC + CMP)
+    case 0xC3: case 0xC7: case 0xCF:
+    case 0xD3: case 0xD7: case 0xDB: case 0xDF: {
+      uchar n; ushort a = rmwAddr(n); uchar c1 = uchar(loadByte(a) - 1);
+      setByte(a, c1); cmpOp(c1); incT(n); break;
+    }
+    // ISC (INC + SBC)
+    case 0xE3: case 0xE7: case 0xEF:
+    case 0xF3: case 0xF7: case 0xFB: case 0xFF: {
+      uchar n; ushort a = rmwAddr(n); uchar c1 = uchar(loadByte(a) + 1);
+      setByte(a, c1); sbcOp<V>(c1); incT(n); break;
+    }
+
+    // SAX (store A AND X)
+    case 0x83: { // SAX (zero page,X)
+      setByte(loadWord(sumBytes(readByte(), X())), A() & X()); incT(6); break;
+    }
+    case 0x87: { // SAX zero page
+      setZeroPage(A() & X()); incT(3); break;
+    }
+    case 0x8F: { // SAX absolute
+      setAbsolute(A() & X()); incT(4); break;
+    }
+    case 0x97: { // SAX zero page,Y
+      setZeroPageY(A() & X()); incT(4); break;
+    }
+
+    // LAX (LDA + LDX)
+    case 0xA3: { // LAX (zero page,X)
+      setA(getMemIndexedIndirectX()); setX(A()); setNZFlags(A()); incT(6); break;
+    }
+    case 0xA7: { // LAX zero page
+      setA(getZeroPage()); setX(A()); setNZFlags(A()); incT(3); break;
+    }
+    case 0xAB: { // LAX immediate (unstable)
+      setA((A() | magic) & readByte()); setX(A()); setNZFlags(A()); incT(2); break;
+    }
+    case 0xAF: { // LAX absolute
+      setA(getAbsolute()); setX(A()); setNZFlags(A()); incT(4); break;
+    }
+    case 0xB3: { // LAX (zero page),Y
+      setA(getMemIndirectIndexedY()); setX(A()); setNZFlags(A()); incT(5); break;
+    }
+    case 0xB7: { // LAX zero page,Y
+      setA(getZeroPageY()); setX(A()); setNZFlags(A()); incT(4); break;
+    }
+    case 0xBF: { // LAX absolute,Y
+      setA(getAbsoluteY()); setX(A()); setNZFlags(A()); incT(4); break;
+    }
+
+    // ANC (AND, C from bit 7)
+    case 0x0B: case 0x2B: {
+      andOp(readByte()); setCFlag(Nflag()); incT(2); break;
+    }
+    // ALR (AND + LSR A)
+    case 0x4B: {
+      uchar c1 = A() & readByte();
+      bool C = lsrCalc(c1); setA(c1); setNZCFlags(C); incT(2); break;
+    }
+    // ARR (AND + ROR A, C from bit 6, V from bit 6 XOR bit 5)
+    case 0x6B: {
+      uchar t  = A() & readByte();
+      uchar c1 = uchar((t >> 1) | (Cflag() ? 0x80 : 0x00));
+
+      if (hasDecimal(V) && Dflag()) {
+        // decimal adjust on AND result digits
+        setNFlag(Cflag()); setZFlag(c1 == 0); setVFlag((t ^ c1) & 0x40);
+
+        uchar lo = t & 0x0F, hi = uchar(t >> 4);
+
+        if (lo + (lo & 0x01) > 5)
+          c1 = uchar((c1 & 0xF0) | ((c1 + 6) & 0x0F));
+
+        bool C = (hi + (hi & 0x01) > 5);
+
+        if (C)
+          c1 = uchar(c1 + 0x60);
+
+        setA(c1); setCFlag(C);
+      }
+      else {
+        setA(c1); setNZFlags(c1); setCFlag(c1 & 0x40); setVFlag(((c1 >> 6) ^ (c1 >> 5)) & 0x01);
+      }
+
+      incT(2); break;
+    }
+    // XAA (TXA + AND, unstable)
+    case 0x8B: {
+      setA((A() | magic) & X() & readByte()); setNZFlags(A()); incT(2); break;
+    }
+    // AXS (X = (A AND X) - immediate, no borrow)
+    case 0xCB: {
+      uchar ax = A() & X(); uchar c1 = readByte();
+      setX(uchar(ax - c1)); setNZCFlags(X(), ax >= c1); incT(2); break;
+    }
+    // SBC immediate
+    case 0xEB: {
+      sbcOp<V>(readByte()); incT(2); break;
+    }
+
+    // AHX (store A AND X AND (high byte + 1))
+    case 0x93: { // AHX (zero page),Y
+      storeHigh(loadWord(readByte()), Y(), A() & X()); incT(6); break;
+    }
+    case 0x9F: { // AHX absolute,Y
+      storeHigh(readWord(), Y(), A() & X()); incT(5); break;
+    }
+    // SHY (store Y AND (high byte + 1))
+    case 0x9C: {
+      storeHigh(readWord(), X(), Y()); incT(5); break;
+    }
+    // SHX (store X AND (high byte + 1))
+    case 0x9E: {
+      storeHigh(readWord(), Y(), X()); incT(5); break;
+    }
+    // TAS (SP = A AND X, store SP AND (high byte + 1))
+    case 0x9B: {
+      setSP(A() & X()); storeHigh(readWord(), Y(), SP()); incT(5); break;
+    }
+    // LAS (A, X, SP = memory AND SP)
+    case 0xBB: {
+      uchar c1 = getAbsoluteY() & SP();
+      setA(c1); setX(c1); setSP(c1); setNZFlags(c1); incT(4); break;
+    }
+
+    default:
+      assert(false);
+      break;
+  }
+}
+
+// 65C02 instructions (in NMOS undefined opcode slots)
+//  unused opcodes are NOPs (Rockwell/WDC bit instructions are not supported)
+void
+C6502::
+stepCMOS(uchar c)
+{
+  // get byte from memory address at zero page address (from next byte)
+  auto getZeroPageIndirect = [&]() { return loadByte(loadWord(readByte())); };
+
+  switch (c) {
+    // (zero page)
+    case 0x12: { // ORA (zero page)
+      orOp (getZeroPageIndirect()); incT(5); break;
+    }
+    case 0x32: { // AND (zero page)
+      andOp(getZeroPageIndirect()); incT(5); break;
+    }
+    case 0x52: { // EOR (zero page)
+      eorOp(getZeroPageIndirect()); incT(5); break;
+    }
+    case 0x72: { // ADC (zero page)
+      adcOp<Variant::CMOS>(getZeroPageIndirect()); incT(5); break;
+    }
+    case 0x92: { // STA (zero page)
+      setByte(loadWord(readByte()), A()); incT(5); break;
+    }
+    case 0xB2: { // LDA (zero page)
+      setA(getZeroPageIndirect()); setNZFlags(A()); incT(5); break;
+    }
+    case 0xD2: { // CMP (zero page)
+      uchar c1 = getZeroPageIndirect(); cmpOp(c1); incT(5); break;
+    }
+    case 0xF2: { // SBC (zero page)
+      sbcOp<Variant::CMOS>(getZeroPageIndirect()); incT(5); break;
+    }
+
+    //---
+
+    // BIT ...
+    case 0x34: { // BIT zero page,X
+      bitOp(getZeroPageX()); incT(4); break;
+    }
+    case 0x3C: { // BIT absolute,X
+      bitOp(getAbsoluteX()); incT(4); break;
+    }
+    case 0x89: { // BIT immediate (Z flag only)
+      setZFlag((readByte() & A()) == 0x00); incT(2); break;
+    }
+
+    //---
+
+    // TSB/TRB (Z flag from A AND memory, then set/reset A bits in memory)
+    case 0x04: { // TSB zero page
+      ushort a = readByte(); uchar c1 = loadByte(a);
+      setZFlag((c1 & A()) == 0x00); setByte(a, c1 | A()); incT(5); break;
+    }
+    case 0x0C: { // TSB absolute
+      ushort a = readWord(); uchar c1 = loadByte(a);
+      setZFlag((c1 & A()) == 0x00); setByte(a, c1 | A()); incT(6); break;
+    }
+    case 0x14: { // TRB zero page
+      ushort a = readByte(); uchar c1 = loadByte(a);
+      setZFlag((c1 & A()) == 0x00); setByte(a, c1 & ~A()); incT(5); break;
+    }
+    case 0x1C: { // TRB absolute
+      ushort a = readWord(); uchar c1 = loadByte(a);
+      setZFlag((c1 & A()) == 0x00); setByte(a, c1 & ~A()); incT(6); break;
+    }
+
+    //---
+
+    // STZ ...
+    case 0x64: { // STZ zero page
+      setZeroPage(0); incT(3); break;
+    }
+    case 0x74: { // STZ zero page,X
+      setZeroPageX(0); incT(4); break;
+    }
+    case 0x9C: { // STZ absolute
+      setAbsolute(0); incT(4); break;
+    }
+    case 0x9E: { // STZ absolute,X
+      setAbsoluteX(0); incT(5); break;
+    }
+
+    //---
+
+    case 0x1A: { // INC A
+      setA(A() + 1); setNZFlags(A()); incT(2); break;
+    }
+    case 0x3A: { // DEC A
+      setA(A() - 1); setNZFlags(A()); incT(2); break;
+    }
+
+    //---
+
+    case 0x5A: { // PHY implied (Push Y)
+      pushByte(Y()); incT(3); break;
+    }
+    case 0x7A: { // PLY implied (Pull Y)
+      setY(popByte()); setNZFlags(Y()); incT(4); break;
+    }
+    case 0xDA: { // PHX implied (Push X)
+      pushByte(X()); incT(3); break;
+    }
+    case 0xFA: { // PLX implied (Pull X)
+      setX(popByte()); setNZFlags(X()); incT(4); break;
+    }
+
+    //---
+
+    case 0x80: { // BRA (Branch Always)
+      schar d = readSByte();
+
+      branchTo(d);
+
+      if (d == -2)
+        illegalJump();
+
+      if (d < 0 && isIdleSkip())
+        checkIdleLoop();
+
+      incT(2);
+
+      break;
+    }
+
+    case 0x7C: { // JMP (absolute,X)
+      ushort oldPC = PC();
+
+      setPC(loadWord(ushort(readWord() + X()))); incT(6);
+
+      if (trapInd_[PC()] && callTrap(trapInd_[PC()]))
+        break;
+
+      if (isJumpPoint(PC()))
+        jumpPointHit(c);
+
+      if (PC() == oldPC - 1)
+        illegalJump();
+
+      break;
+    }
+
+    //---
+
+    // NOP ...
+    case 0x02: case 0x22: case 0x42: case 0x62: case 0x82: case 0xC2: case 0xE2:
+      // immediate
+      readByte(); incT(2); break;
+    case 0x44:
+      // zero page
+      readByte(); incT(3); break;
+    case 0x54: case 0xD4: case 0xF4:
+      // zero page x
+      readByte(); incT(4); break;
+    case 0x5C:
+      // absolute (8 cycles)
+      readWord(); incT(8); break;
+    case 0xDC: case 0xFC:
+      // absolute
+      readWord(); incT(4); break;
+
+    default:
+      // single byte
+      incT(1); break;
+  }
+}
+
+bool
+C6502::
+addTrap(ushort addr, const TrapProc &proc)
+{
+  uchar ind = trapInd_[addr];
+
+  if (! ind) {
+    // reuse free slot
+    for (uint i = 1; i < traps_.size(); ++i) {
+      if (! traps_[i]) {
+        ind = uchar(i);
+        break;
+      }
+    }
+
+    if (! ind) {
+      if (traps_.size() > 255) {
+        std::cerr << "Too many traps\n";
+        return false;
+      }
+
+      ind = uchar(traps_.size());
+
+      traps_.push_back(TrapProc());
+    }
+  }
+
+  traps_[ind] = proc;
+
+  trapInd_[addr] = ind;
+
+  return true;
+}
+
+void
+C6502::
+removeTrap(ushort addr)
+{
+  uchar ind = trapInd_[addr];
+  if (! ind) return;
+
+  traps_[ind] = TrapProc();
+
+  trapInd_[addr] = 0;
+}
+
+void
+C6502::
+removeAllTraps()
+{
+  std::memset(&trapInd_[0], 0, 0x10000*sizeof(trapInd_[0]));
+
+  traps_.resize(1);
+}
+
+//------
+
+void
+C6502::
+addDevice(C6502Device *device, ushort addr, uint len)
+{
+  if (! device)
+    return;
+
+  if (addr + len > 0x10000)
+    len = 0x10000 - addr;
+
+  DeviceRange range;
+
+  range.device = device;
+  range.addr   = addr;
+  range.len    = len;
+
+  devices_.push_back(range);
+
+  // no range (checkpoint hooks only)
+  if (len == 0)
+    return;
+
+  for (uint page = (addr >> 8); page <= ((addr + len - 1) >> 8); ++page) {
+    ++devicePages_[page];
+
+    pageFlags_[page] |= PAGE_DEVICE;
+  }
+}
+
+bool
+C6502::
+hasDevice(ushort addr) const
+{
+  if (! (pageFlags_[addr >> 8] & PAGE_DEVICE))
+    return false;
+
+  for (auto &range : devices_) {
+    if (addr >= range.addr && addr < range.addr + range.len)
+      return true;
+  }
+
+  return false;
+}
+
+void
+C6502::
+setVolatile(ushort addr, uint len)
+{
+  if (len == 0)
+    return;
+
+  if (addr + len > 0x10000)
+    len = 0x10000 - addr;
+
+  for (uint page = (addr >> 8); page <= ((addr + len - 1) >> 8); ++page)
+    pageFlags_[page] |= PAGE_VOLATILE;
+}
+
+void
+C6502::
+removeDevice(C6502Device *device)
+{
+  for (auto p = devices_.begin(); p != devices_.end(); ) {
+    if ((*p).device != device) { ++p; continue; }
+
+    uint len = (*p).len;
+
+    for (uint page = ((*p).addr >> 8); len > 0 && page <= (((*p).addr + len - 1) >> 8); ++page) {
+      if (--devicePages_[page] == 0)
+        pageFlags_[page] &= ~PAGE_DEVICE;
+    }
+
+    p = devices_.erase(p);
+  }
+}
+
+C6502::uchar
+C6502::
+loadDeviceByte(ushort addr) const
+{
+  uchar c = mem_[addr];
+
+  for (auto &range : devices_) {
+    if (addr >= range.addr && addr < range.addr + range.len && range.device->memRead(addr, c))
+      break;
+  }
+
+  return c;
+}
+
+C6502::uchar
+C6502::
+loadVolatileByte(ushort addr)
+{
+  ++volatileReads_;
+
+  if (pageFlags_[addr >> 8] & PAGE_DEVICE)
+    return loadDeviceByte(addr);
+
+  return getByte(addr);
+}
+
+C6502::uchar
+C6502::
+peekDeviceByte(ushort addr) const
+{
+  uchar c = mem_[addr];
+
+  for (auto &range : devices_) {
+    if (addr >= range.addr && addr < range.addr + range.len && range.device->memPeek(addr, c))
+      break;
+  }
+
+  return c;
+}
+
+void
+C6502::
+storePageByte(ushort addr, uchar c)
+{
+  uchar flags = pageFlags_[addr >> 8];
+
+  if (flags & PAGE_CHECKPOINT)
+    checkpointPage(addr >> 8);
+
+  if (flags & PAGE_CLEAN)
+    dirtyPage(addr >> 8);
+
+  if ((flags & PAGE_HASH) && mem_[addr] != c)
+    hashByte(addr, mem_[addr], c);
+
+  if (flags & PAGE_JOURNAL)
+    journal_.emplace_back(addr, c);
+
+  if (flags & PAGE_DEVICE) {
+    storeDeviceByte(addr, c);
+    return;
+  }
+
+  if (mem_[addr] != c) { mem_[addr] = c; ++memChanges_; }
+}
+
+void
+C6502::
+storeDeviceByte(ushort addr, uchar c)
+{
+  uchar oldC = mem_[addr];
+
+  if (oldC != c) {
+    mem_[addr] = c;
+
+    ++memChanges_;
+  }
+
+  for (auto &range : devices_) {
+    if (addr >= range.addr && addr < range.addr + range.len)
+      range.device->memWritten(addr, oldC, c);
+  }
+}
+
+void
+C6502::
+resetDevices(ushort addr, uint len)
+{
+  for (auto &range : devices_) {
+    if (addr < range.addr + range.len && addr + len > range.addr)
+      range.device->memReset(addr, len);
+  }
+}
+
+bool
+C6502::
+callTrap(uchar ind)
+{
+  int n = traps_[ind](*this);
+
+  if (n < 0)
+    return false;
+
+  // host side effects
+  ++memChanges_;
+
+  while (n > 255) {
+    incT(255);
+
+    n -= 255;
+  }
+
+  incT(uchar(n));
+
+  // return from routine (RTS)
+  setPC(popWord() + 1);
+
+  return true;
+}
+
+// OUT/OUTN trap : JSR OUT, LDA #<regs>
+int
+C6502::
+outTrap(bool nl)
+{
+  ushort raddr = trapReturnAddr();
+
+  uchar c1 = getByte(raddr + 1);
+
+  if (c1 & 0x01) { output_.putStr(" A=" , 3); output_.putHex02(A ()); }
+  if (c1 & 0x02) { output_.putStr(" X=" , 3); output_.putHex02(X ()); }
+  if (c1 & 0x04) { output_.putStr(" Y=" , 3); output_.putHex02(Y ()); }
+  if (c1 & 0x08) { output_.putStr(" SP=", 4); output_.putHex02(SP()); }
+  if (c1 & 0x10) { output_.putStr(" PC=", 4); output_.putHex04(PC()); }
+
+  if (c1 & 0x80) {
+    char fstr[4 + 8] = {
+      ' ', 'S', 'R', '=',
+      (Nflag() ? 'N' : '-'), (Vflag() ? 'V' : '-'),
+      (Xflag() ? 'X' : '-'), (Bflag() ? 'B' : '-'),
+      (Dflag() ? 'D' : '-'), (Iflag() ? 'I' : '-'),
+      (Zflag() ? 'Z' : '-'), (Cflag() ? 'C' : '-') };
+
+    output_.putStr(fstr, 12);
+  }
+
+  if (nl)
+    output_.putChar('\n');
+
+  setTrapReturnAddr(raddr + 2); // skip LDA #<regs>
+
+  return 0;
+}
+
+// OUT/OUTN memory trap : JSR OUT, LDA <addr>
+int
+C6502::
+outMemTrap(bool nl)
+{
+  ushort raddr = trapReturnAddr();
+
+  ushort addr1 = getWord(raddr + 1);
 
-          // NOP
-          case 0x04:            case 0x44: case 0x64:
-            // zero page
-            readByte(); incT(3); break;
-          case 0x14: case 0x34: case 0x54: case 0x74: case 0xD4: case 0xF4:
-            // zero page x
-            readByte(); incT(4); break;
-          case 0x1A: case 0x3A: case 0x5A: case 0x7A: case 0xDA: case 0xFA:
-            incT(2); break;
-          case 0x0C:
-            // absolute
-            readWord(); incT(4); break;
-          case 0x1C: case 0x3C: case 0x5C: case 0x7C: case 0xDC: case 0xFC:
-            // absolute x
-            readWord(); incT(4); break;
-          case 0x80: case 0x82: case 0x89: case 0xC2: case 0xE2:
-            // immediate
-            readByte(); incT(2); break;
+  uchar c1 = getByte(addr1);
+
+  output_.putHex02(c1);
+
+  if (nl)
+    output_.putChar('\n');
+
+  setTrapReturnAddr(raddr + 3); // skip LDA <addr>
+
+  return 0;
+}
+
+// OUTS trap : JSR OUT, LDA <addr>
+int
+C6502::
+outStrTrap()
+{
+  ushort raddr = trapReturnAddr();
+
+  ushort addr1 = getWord(raddr + 1);
+
+  uchar c1 = getByte(addr1);
+
+  while (c1) {
+    char c2 = char(c1);
+
+    if (isspace(c2) || isprint(c2))
+      output_.putChar(c2);
+    else
+      output_.putChar('.');
+
+    c1 = getByte(++addr1);
+  }
+
+  setTrapReturnAddr(raddr + 3); // skip LDA <addr>
+
+  return 0;
+}
+
+//---
+
+bool
+C6502::
+next()
+{
+  std::string str;
+  int         len;
+
+  if (! disassembleAddr(PC(), str, len))
+    return false;
+
+  hasTmpBrk_ = true;
+  tmpBrk_    = ushort(PC() + len);
+
+  cont();
+
+  hasTmpBrk_ = false;
+
+  return true;
+}
+
+void
+C6502::
+update()
+{
+  if (isDebug()) {
+    output_.flush();
+
+    printState();
+  }
+}
+
+//---
+
+bool
+C6502::
+assemble(ushort addr, std::istream &is, ushort &len)
+{
+  // read all source text (lines are views into it)
+  std::string source((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+
+  Lines lines;
+
+  readLines(source, lines);
+
+  return assembleSource(addr, lines, len);
+}
+
+bool
+C6502::
+assembleFile(ushort addr, const std::string &filename, ushort &len)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+
+  if (fd < 0) {
+    std::cerr << "Failed to open '" << filename << "'\n";
+    return false;
+  }
+
+  struct stat st;
+
+  if (fstat(fd, &st) != 0) {
+    std::cerr << "Failed to stat '" << filename << "'\n";
+    close(fd);
+    return false;
+  }
+
+  size_t size = size_t(st.st_size);
+
+  // map file text (empty file has no mapping)
+  void *data = nullptr;
+
+  if (size > 0) {
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (data == MAP_FAILED) {
+      std::cerr << "Failed to map '" << filename << "'\n";
+      close(fd);
+      return false;
+    }
+  }
+
+  close(fd);
+
+  Lines lines;
+
+  readLines(std::string_view(static_cast<const char *>(data), size), lines);
+
+  bool rc = assembleSource(addr, lines, len);
+
+  if (data)
+    munmap(data, size);
+
+  return rc;
+}
+
+bool
+C6502::
+assembleSource(ushort addr, Lines &lines, ushort &len)
+{
+  Strings strs;
+
+  if (isOptimize())
+    optimizeLines(addr, lines, strs);
+
+  clearLabels();
+
+  ushort addr1 = addr;
+
+  // single pass (forward label references patched after)
+  bool rc = assembleLines(addr, lines);
+
+  if (rc)
+    applyFixups();
+
+  len = addr - addr1;
+
+  return rc;
+}
+
+// split source text into lines
+void
+C6502::
+readLines(std::string_view source, Lines &lines)
+{
+  size_t pos = 0;
+
+  for (;;) {
+    auto pos1 = source.find('\n', pos);
+
+    if (pos1 == std::string_view::npos) {
+      lines.push_back(source.substr(pos));
+      break;
+    }
+
+    lines.push_back(source.substr(pos, pos1 - pos));
+
+    pos = pos1 + 1;
+  }
+}
+
+bool
+C6502::
+assembleLines(ushort &addr, const Lines &lines, LineAddrs *lineAddrs)
+{
+  if (lineAddrs)
+    lineAddrs->clear();
+
+  for (auto &line : lines) {
+    if (lineAddrs)
+      lineAddrs->push_back(addr);
+
+    if (! assembleLine(addr, line))
+      return false;
+  }
+
+  if (lineAddrs)
+    lineAddrs->push_back(addr);
+
+  return true;
+}
+
+//---
+
+namespace {
+
+// registers and flags tracked by peephole optimizer
+enum OptReg {
+  OPT_A = (1<<0), OPT_X = (1<<1), OPT_Y = (1<<2),
+  OPT_C = (1<<3), OPT_Z = (1<<4), OPT_N = (1<<5), OPT_V = (1<<6)
+};
+
+const uint OPT_NZ = (OPT_N | OPT_Z);
+
+// registers/flags used and set by op (false for control flow and unknown ops)
+bool optRegs(const std::string &op, const std::string &arg, uint &use, uint &def) {
+  use = 0; def = 0;
+
+  bool acc = (arg == "");
+
+  if (arg.find(",X") != std::string::npos || arg.find(",x") != std::string::npos) use |= OPT_X;
+  if (arg.find(",Y") != std::string::npos || arg.find(",y") != std::string::npos) use |= OPT_Y;
+
+  auto rmw = [&](uint use1, uint def1) {
+    if (acc) { use |= OPT_A | use1; def |= OPT_A | def1; }
+    else     { use |=         use1; def |=         def1; }
+  };
+
+  if      (op == "LDA") { def = OPT_A | OPT_NZ; }
+  else if (op == "LDX") { def = OPT_X | OPT_NZ; }
+  else if (op == "LDY") { def = OPT_Y | OPT_NZ; }
+  else if (op == "STA") { use |= OPT_A; }
+  else if (op == "STX") { use |= OPT_X; }
+  else if (op == "STY") { use |= OPT_Y; }
+  else if (op == "STZ") { }
+  else if (op == "ADC" || op == "SBC") {
+    use |= OPT_A | OPT_C; def = OPT_A | OPT_C | OPT_NZ | OPT_V; }
+  else if (op == "AND" || op == "ORA" || op == "EOR") {
+    use |= OPT_A; def = OPT_A | OPT_NZ; }
+  else if (op == "CMP") { use |= OPT_A; def = OPT_C | OPT_NZ; }
+  else if (op == "CPX") { use |= OPT_X; def = OPT_C | OPT_NZ; }
+  else if (op == "CPY") { use |= OPT_Y; def = OPT_C | OPT_NZ; }
+  else if (op == "BIT") { use |= OPT_A; def = (arg[0] == '#' ? uint(OPT_Z) : uint(OPT_NZ | OPT_V)); }
+  else if (op == "TSB" || op == "TRB") { use |= OPT_A; def = OPT_Z; }
+  else if (op == "INC" || op == "DEC") { rmw(0, OPT_NZ); }
+  else if (op == "ASL" || op == "LSR") { rmw(0, OPT_C | OPT_NZ); }
+  else if (op == "ROL" || op == "ROR") { rmw(OPT_C, OPT_C | OPT_NZ); }
+  else if (op == "INX" || op == "DEX") { use = OPT_X; def = OPT_X | OPT_NZ; }
+  else if (op == "INY" || op == "DEY") { use = OPT_Y; def = OPT_Y | OPT_NZ; }
+  else if (op == "TAX") { use = OPT_A; def = OPT_X | OPT_NZ; }
+  else if (op == "TAY") { use = OPT_A; def = OPT_Y | OPT_NZ; }
+  else if (op == "TXA") { use = OPT_X; def = OPT_A | OPT_NZ; }
+  else if (op == "TYA") { use = OPT_Y; def = OPT_A | OPT_NZ; }
+  else if (op == "TSX") { def = OPT_X | OPT_NZ; }
+  else if (op == "TXS") { use = OPT_X; }
+  else if (op == "PHA") { use = OPT_A; }
+  else if (op == "PHX") { use = OPT_X; }
+  else if (op == "PHY") { use = OPT_Y; }
+  else if (op == "PLA") { def = OPT_A | OPT_NZ; }
+  else if (op == "PLX") { def = OPT_X | OPT_NZ; }
+  else if (op == "PLY") { def = OPT_Y | OPT_NZ; }
+  else if (op == "PHP") { use = OPT_C | OPT_NZ | OPT_V; }
+  else if (op == "PLP") { def = OPT_C | OPT_NZ | OPT_V; }
+  else if (op == "CLC" || op == "SEC") { def = OPT_C; }
+  else if (op == "CLV") { def = OPT_V; }
+  else if (op == "CLD" || op == "SED" || op == "CLI" || op == "SEI" || op == "NOP") { }
+  else if (op == "OUT" || op == "OUTN") {
+    // output registers (or memory)
+    CParser parse(arg);
+
+    std::string word;
+
+    while (parse.readSepWord(word, ',')) {
+      if      (word == "A" ) use |= OPT_A;
+      else if (word == "AF") use |= OPT_A | OPT_C | OPT_NZ | OPT_V;
+      else if (word == "X" ) use |= OPT_X;
+      else if (word == "Y" ) use |= OPT_Y;
+      else if (word == "SR") use |= OPT_C | OPT_NZ | OPT_V;
+    }
+  }
+  else
+    return false;
+
+  return true;
+}
+
+}
+
+// peephole optimize source lines.
+//
+// A trial assemble gives the address and bytes of each line (memory is restored after)
+// so branch range and cycles/bytes saved are known. Register and flag liveness is
+// checked by scanning forward to the next control flow instruction. Changes:
+//  . STA/STX/STY x, LDA/LDX/LDY x (same x) : remove load if N/Z not used
+//  . LDA x, CLC, ADC #1, STA x : INC x if A, C, V not used (DEC x for SEC, SBC #1)
+//  . CLC, ADC #1 : INC (65C02) if C, V not used (DEC for SEC, SBC #1)
+//  . JMP label : BRA (65C02), or branch on flag set by previous instruction, if in
+//    range without page cross
+//  . JSR x, RTS : JMP x (RTS kept if labelled)
+//
+// Loads/stores are assumed to be memory (not device registers) and ADC/SBC binary
+// mode (D clear).
+void
+C6502::
+optimizeLines(ushort addr, Lines &lines, Strings &strs)
+{
+  // trial assemble for line addresses and labels (memory restored after)
+  std::vector<uchar> mem(0x10000);
+
+  memget(0x0000, &mem[0     ], 0x8000);
+  memget(0x8000, &mem[0x8000], 0x8000);
+
+  LineAddrs lineAddrs;
+
+  clearLabels();
+
+  ushort addr1 = addr;
+
+  bool rc = assembleLines(addr1, lines, &lineAddrs);
+
+  if (rc)
+    applyFixups();
+
+  auto restore = [&]() {
+    memset(0x0000, &mem[0     ], 0x8000);
+    memset(0x8000, &mem[0x8000], 0x8000);
+  };
+
+  if (! rc) {
+    restore();
+    return;
+  }
+
+  //---
+
+  // parse lines (label, op, arg), labelled set if line op may be reached from label
+  struct OptLine {
+    std::string label;
+    std::string op;
+    std::string arg;
+    bool        labelled { false };
+  };
+
+  uint numLines = uint(lines.size());
+
+  std::vector<OptLine> optLines(numLines);
+
+  bool labelled = false;
+
+  for (uint i = 0; i < numLines; ++i) {
+    auto &optLine = optLines[i];
+
+    CParser parse(lines[i]);
+
+    parse.skipSpace();
+
+    std::string word;
+
+    if (! parse.isChar(';') && parse.readWord(word)) {
+      if (word[word.size() - 1] == ':') {
+        optLine.label = word.substr(0, word.size() - 1);
+
+        labelled = true;
+
+        if (parse.isChar(';') || ! parse.readWord(word))
+          word = "";
+      }
+
+      if (word != "" && word[0] != ';') {
+        optLine.op = parse.toUpper(word);
+
+        parse.skipSpace();
+
+        if (! parse.isChar(';'))
+          parse.readWord(optLine.arg);
+
+        optLine.labelled = labelled;
+
+        labelled = false;
+      }
+    }
+  }
+
+  // next line with op
+  auto nextOp = [&](uint i) {
+    for ( ; i < numLines; ++i) {
+      if (optLines[i].op != "") return int(i);
+    }
+
+    return -1;
+  };
+
+  // check registers/flags not used before set from line
+  auto isDead = [&](int i, uint regs) {
+    for ( ; i >= 0 && i < int(numLines); ++i) {
+      const auto &optLine = optLines[uint(i)];
+
+      if (optLine.op == "")
+        continue;
+
+      uint use, def;
+
+      if (! optRegs(optLine.op, optLine.arg, use, def))
+        return false;
+
+      if (use & regs)
+        return false;
+
+      regs &= ~def;
+
+      if (! regs)
+        return true;
+    }
+
+    return false;
+  };
+
+  auto isOneArg = [&](const std::string &arg) {
+    CParser parse(arg);
+
+    if (! parse.isChar('#')) return false;
+
+    parse.skipChar();
+
+    if (! parse.isValue()) return false;
+
+    uchar vlen;
+
+    return (parse.getValue(vlen) == 1);
+  };
+
+  auto isSameArg = [&](const OptLine &optLine1, const OptLine &optLine2) {
+    return (optLine1.arg != "" && optLine1.arg[0] != '#' &&
+            CParser(optLine1.arg).toUpper(optLine1.arg) ==
+            CParser(optLine2.arg).toUpper(optLine2.arg));
+  };
+
+  // line cycles (branch taken) and length from trial assembled bytes
+  C6502Analyze analyze(this);
+
+  auto lineCycles = [&](uint i, uint &len) {
+    uint cycles, takenCycles;
+
+    analyze.instCycles(lineAddrs[i], len, cycles, takenCycles);
+
+    len = uint(lineAddrs[i + 1] - lineAddrs[i]);
+
+    return cycles + takenCycles;
+  };
+
+  //---
+
+  std::vector<int> removed(numLines, 0);
+
+  int totalCycles = 0, totalBytes = 0, numChanges = 0;
+
+  // replace line i by op (remove other lines) and report saving
+  auto change = [&](uint i, const std::vector<int> &inds, const std::string &newOp,
+                    bool keepLast) {
+    int  cycles = 0, bytes = 0;
+    uint len;
+
+    std::string desc;
+
+    for (auto ind : inds) {
+      cycles += int(lineCycles(uint(ind), len));
+      bytes  += int(len);
+
+      desc += (desc != "" ? ", " : "") + optLines[uint(ind)].op;
+
+      if (optLines[uint(ind)].arg != "")
+        desc += " " + optLines[uint(ind)].arg;
+    }
+
+    // assemble new op at same address for cycles/length
+    if (newOp != "") {
+      ushort addr2 = lineAddrs[i];
+
+      assembleLine(addr2, newOp);
+
+      uint cycles1, takenCycles;
+
+      analyze.instCycles(lineAddrs[i], len, cycles1, takenCycles);
+
+      cycles -= int(cycles1 + takenCycles);
+      bytes  -= int(len);
+
+      strs.push_back((optLines[i].label != "" ? optLines[i].label + ":" : "") + "  " + newOp);
+
+      lines[i] = strs.back();
+    }
+    else
+      removed[i] = 1;
 
-          // SLO
-          case 0x03: case 0x07: case 0x0F:
-          case 0x13: case 0x17: case 0x1B: case 0x1F:
-            // TODO: asl + ora
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // RLA
-          case 0x23: case 0x27: case 0x2F:
-          case 0x33: case 0x37: case 0x3B: case 0x3F:
-            // TODO: rol + and
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // SRE
-          case 0x43: case 0x47: case 0x4F:
-          case 0x53: case 0x57: case 0x5B: case 0x5F:
-            // TODO: lsr + eor
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // RRA
-          case 0x63: case 0x67: case 0x6F:
-          case 0x73: case 0x77: case 0x7B: case 0x7F:
-            // TODO: ror + adc
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // SAX
-          case 0x83: case 0x87: case 0x8F: case 0x97:
-            // TODO: store A&X into {adr}
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // LAX
-          case 0xA3: case 0xA7: case 0xAB: case 0xAF:
-          case 0xB3: case 0xB7: case 0xBF:
-            // TODO: lda + ldx
-            // TODO: lda + tax (0xAB)
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // DCP
-          case 0xC3: case 0xC7: case 0xCF:
-          case 0xD3: case 0xD7: case 0xDB: case 0xDF:
-            // TODO: dec + cmp
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // ISC
-          case 0xE3: case 0xE7: case 0xEF:
-          case 0xF3: case 0xF7: case 0xFB: case 0xFF:
-            // TODO: inc + sbc
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // ANC
-          case 0x0B: case 0x2B:
-            // TODO: and + asl
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // ALR
-          case 0x4B:
-            // TODO: and + lsr
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // ARR
-          case 0x6B:
-            // TODO: and + ror
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // XAA
-          case 0x8B:
-            // TODO: txa + and
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // AXS
-          case 0xCB:
-            // TODO: a&x minus #{imm} into X
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // SBC
-          case 0xEB:
-            // TODO: sbc #{imm} + NOP
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // AHX
-          case 0x93: case 0x9F:
-            // TODO: store A&X&H into {adr}
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // SHY
-          case 0x9C:
-            // TODO: stores Y&H into {adr}
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // SHX
-          case 0x9E:
-            // TODO: stores X&H into {adr}
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // TAS
-          case 0x9B:
-            // TODO: stores A&X into S and A&X&H into {adr}
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          // LAS
-          case 0xBB:
-            // TODO: stores {adr}&S into A, X and S
-            std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-            std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-            setBreak(true);
-            break;
-          default:
-            assert(false);
-            break;
-        }
-      }
-      else {
-        std::cerr << "Invalid byte "; outputHex02(std::cerr, c);
-        std::cerr << " @ "; outputHex04(std::cerr, PC() - 1); std::cerr << "\n";
-        setBreak(true);
+    for (size_t j = 1; j < inds.size(); ++j) {
+      uint ind = uint(inds[j]);
+
+      if (keepLast && j == inds.size() - 1) {
+        bytes -= int(lineAddrs[ind + 1] - lineAddrs[ind]);
+        continue;
       }
 
-      break;
+      removed[ind] = 1;
     }
 
-    default:
-      assert(false);
-      break;
-  }
-}
+    std::cerr << "Optimize line " << i + 1 << ": " << desc << " -> " <<
+                 (newOp != "" ? newOp : "removed") << " (" << cycles << " cycles, " <<
+                 bytes << " bytes)\n";
 
-bool
-C6502::
-next()
-{
-  std::string str;
-  int         len;
+    totalCycles += cycles;
+    totalBytes  += bytes;
 
-  if (! disassembleAddr(PC(), str, len))
-    return false;
+    ++numChanges;
+  };
 
-  hasTmpBrk_ = true;
-  tmpBrk_    = ushort(PC() + len);
+  bool cmos = (variant_ == Variant::CMOS);
 
-  cont();
+  for (int i = nextOp(0); i >= 0; ) {
+    uint ui = uint(i);
 
-  hasTmpBrk_ = false;
+    const auto &optLine = optLines[ui];
 
-  return true;
-}
+    int j = nextOp(ui + 1);
+    int k = (j >= 0 ? nextOp(uint(j) + 1) : -1);
+    int l = (k >= 0 ? nextOp(uint(k) + 1) : -1);
 
-void
-C6502::
-update()
-{
-  if (isDebug())
-    printState();
-}
+    const OptLine *optLine1 = (j >= 0 ? &optLines[uint(j)] : nullptr);
+    const OptLine *optLine2 = (k >= 0 ? &optLines[uint(k)] : nullptr);
+    const OptLine *optLine3 = (l >= 0 ? &optLines[uint(l)] : nullptr);
 
-//---
+    bool unlabelled1 = (optLine1 && ! optLine1->labelled);
+    bool unlabelled2 = (unlabelled1 && optLine2 && ! optLine2->labelled);
+    bool unlabelled3 = (unlabelled2 && optLine3 && ! optLine3->labelled);
 
-bool
-C6502::
-assemble(ushort addr, std::istream &is, ushort &len)
-{
-  Lines lines;
+    const std::string &op = optLine.op;
 
-  readLines(is, lines);
+    int next = j;
 
-  clearLabels();
+    // STA x, LDA x : remove load
+    if      (unlabelled1 && (op == "STA" || op == "STX" || op == "STY") &&
+             optLine1->op == "LD" + op.substr(2) && isSameArg(optLine, *optLine1) &&
+             isDead(j + 1, OPT_NZ)) {
+      change(uint(j), { j }, "", false);
 
-  numBadLabels_ = 0;
+      next = nextOp(uint(j) + 1);
+    }
+    // LDA x, CLC, ADC #1, STA x : INC x
+    else if (unlabelled3 && op == "LDA" && optLine3->op == "STA" &&
+             isSameArg(optLine, *optLine3) &&
+             ((optLine1->op == "CLC" && optLine2->op == "ADC") ||
+              (optLine1->op == "SEC" && optLine2->op == "SBC")) &&
+             isOneArg(optLine2->arg) && optLine.arg[0] != '(' &&
+             optLine.arg.find(",Y") == std::string::npos &&
+             optLine.arg.find(",y") == std::string::npos &&
+             isDead(l + 1, OPT_A | OPT_C | OPT_V)) {
+      std::string newOp = (optLine2->op == "ADC" ? "INC " : "DEC ") + optLine.arg;
 
-  ushort addr1 = addr;
+      change(ui, { i, j, k, l }, newOp, false);
 
-  bool rc = assembleLines(addr, lines);
+      next = nextOp(uint(l) + 1);
+    }
+    // CLC, ADC #1 : INC A (65C02)
+    else if (cmos && unlabelled1 &&
+             ((op == "CLC" && optLine1->op == "ADC") || (op == "SEC" && optLine1->op == "SBC")) &&
+             isOneArg(optLine1->arg) && isDead(j + 1, OPT_C | OPT_V)) {
+      change(ui, { i, j }, (optLine1->op == "ADC" ? "INC" : "DEC"), false);
+
+      next = nextOp(uint(j) + 1);
+    }
+    // JMP label : branch
+    else if (op == "JMP" && ! optLine.labelled) {
+      std::string branch;
+
+      if (cmos)
+        branch = "BRA";
+      else {
+        // previous op (if adjacent) sets known flag
+        int p = i - 1;
+
+        while (p >= 0 && optLines[uint(p)].op == "" && optLines[uint(p)].label == "")
+          --p;
+
+        const OptLine *prevLine = (p >= 0 ? &optLines[uint(p)] : nullptr);
+
+        if (prevLine) {
+          const std::string &pop = prevLine->op;
+
+          if      (pop == "CLC") branch = "BCC";
+          else if (pop == "SEC") branch = "BCS";
+          else if (pop == "CLV") branch = "BVC";
+          else if ((pop == "LDA" || pop == "LDX" || pop == "LDY") && prevLine->arg[0] == '#') {
+            CParser parse(std::string_view(prevLine->arg).substr(1));
+
+            uchar vlen;
+
+            if (parse.isValue())
+              branch = (parse.getValue(vlen) == 0 ? "BEQ" : "BNE");
+          }
+        }
+      }
+
+      ushort taddr;
+      uchar  tlen;
+
+      if (branch != "" && getLabel(optLine.arg, taddr, tlen) && tlen == 4) {
+        int from = lineAddrs[ui] + 2;
+        int d    = int(taddr) - from;
+
+        if (d >= -128 && d <= 127 && (from >> 8) == (taddr >> 8))
+          change(ui, { i }, branch + " " + optLine.arg, false);
+      }
+    }
+    // JSR x, RTS : JMP x
+    else if (op == "JSR" && optLine1 && optLine1->op == "RTS") {
+      change(ui, { i, j }, "JMP " + optLine.arg, optLine1->labelled);
 
-  if (numBadLabels_ > 0) {
-    addr = addr1;
+      next = nextOp(uint(j) + 1);
+    }
 
-    rc = assembleLines(addr, lines);
+    i = next;
   }
 
-  len = addr - addr1;
+  //---
 
-  return rc;
-}
+  restore();
 
-void
-C6502::
-readLines(std::istream &is, Lines &lines)
-{
-  while (! is.eof()) {
-    std::string line;
+  if (numChanges == 0)
+    return;
 
-    std::getline(is, line);
+  Lines lines1;
 
-    lines.push_back(line);
+  for (uint i = 0; i < numLines; ++i) {
+    if (! removed[i])
+      lines1.push_back(lines[i]);
   }
+
+  lines = lines1;
+
+  std::cerr << "Optimize: " << numChanges << " changes, " << totalCycles << " cycles, " <<
+               totalBytes << " bytes saved\n";
 }
 
-bool
+// mnemonic/directive id from sorted name table (upper case copy in local buffer)
+C6502::AsmOp
 C6502::
-assembleLines(ushort &addr, const Lines &lines)
+lookupAsmOp(std::string_view word)
 {
-  for (auto &line : lines) {
-    if (! assembleLine(addr, line))
-      return false;
-  }
+  struct AsmOpName {
+    const char *name;
+    AsmOp       op;
+  };
 
-  return true;
+  // sorted by name
+  static const AsmOpName opNames[] = {
+    { "ADC"   , AsmOp::ADC    }, { "AND"   , AsmOp::AND    }, { "ASL"   , AsmOp::ASL    },
+    { "BCC"   , AsmOp::BCC    }, { "BCS"   , AsmOp::BCS    }, { "BEQ"   , AsmOp::BEQ    },
+    { "BIT"   , AsmOp::BIT    }, { "BMI"   , AsmOp::BMI    }, { "BNE"   , AsmOp::BNE    },
+    { "BPL"   , AsmOp::BPL    }, { "BRA"   , AsmOp::BRA    }, { "BRK"   , AsmOp::BRK    },
+    { "BVC"   , AsmOp::BVC    }, { "BVS"   , AsmOp::BVS    }, { "CLC"   , AsmOp::CLC    },
+    { "CLD"   , AsmOp::CLD    }, { "CLI"   , AsmOp::CLI    }, { "CLV"   , AsmOp::CLV    },
+    { "CMP"   , AsmOp::CMP    }, { "CPU"   , AsmOp::CPU    }, { "CPX"   , AsmOp::CPX    },
+    { "CPY"   , AsmOp::CPY    }, { "DB"    , AsmOp::DB     }, { "DEC"   , AsmOp::DEC    },
+    { "DEFINE", AsmOp::DEFINE }, { "DEX"   , AsmOp::DEX    }, { "DEY"   , AsmOp::DEY    },
+    { "EOR"   , AsmOp::EOR    }, { "INC"   , AsmOp::INC    }, { "INX"   , AsmOp::INX    },
+    { "INY"   , AsmOp::INY    }, { "JMP"   , AsmOp::JMP    }, { "JSR"   , AsmOp::JSR    },
+    { "LDA"   , AsmOp::LDA    }, { "LDX"   , AsmOp::LDX    }, { "LDY"   , AsmOp::LDY    },
+    { "LSR"   , AsmOp::LSR    }, { "NOP"   , AsmOp::NOP    }, { "ORA"   , AsmOp::ORA    },
+    { "ORG"   , AsmOp::ORG    }, { "OUT"   , AsmOp::OUT    }, { "OUTN"  , AsmOp::OUTN   },
+    { "OUTS"  , AsmOp::OUTS   }, { "PHA"   , AsmOp::PHA    }, { "PHP"   , AsmOp::PHP    },
+    { "PHX"   , AsmOp::PHX    }, { "PHY"   , AsmOp::PHY    }, { "PLA"   , AsmOp::PLA    },
+    { "PLP"   , AsmOp::PLP    }, { "PLX"   , AsmOp::PLX    }, { "PLY"   , AsmOp::PLY    },
+    { "ROL"   , AsmOp::ROL    }, { "ROR"   , AsmOp::ROR    }, { "RTI"   , AsmOp::RTI    },
+    { "RTS"   , AsmOp::RTS    }, { "SBC"   , AsmOp::SBC    }, { "SEC"   , AsmOp::SEC    },
+    { "SED"   , AsmOp::SED    }, { "SEI"   , AsmOp::SEI    }, { "STA"   , AsmOp::STA    },
+    { "STX"   , AsmOp::STX    }, { "STY"   , AsmOp::STY    }, { "STZ"   , AsmOp::STZ    },
+    { "TAX"   , AsmOp::TAX    }, { "TAY"   , AsmOp::TAY    }, { "TRB"   , AsmOp::TRB    },
+    { "TSB"   , AsmOp::TSB    }, { "TSX"   , AsmOp::TSX    }, { "TXA"   , AsmOp::TXA    },
+    { "TXS"   , AsmOp::TXS    }, { "TYA"   , AsmOp::TYA    },
+  };
+
+  static bool sorted = std::is_sorted(std::begin(opNames), std::end(opNames),
+    [](const AsmOpName &n1, const AsmOpName &n2) { return strcmp(n1.name, n2.name) < 0; });
+
+  assert(sorted);
+
+  // longest name is 6 characters
+  char buffer[6];
+
+  if (word.empty() || word.size() > sizeof(buffer))
+    return AsmOp::NONE;
+
+  for (size_t i = 0; i < word.size(); ++i)
+    buffer[i] = char(toupper(uchar(word[i])));
+
+  std::string_view name(buffer, word.size());
+
+  auto p = std::lower_bound(std::begin(opNames), std::end(opNames), name,
+    [](const AsmOpName &n, std::string_view name1) { return name1.compare(n.name) > 0; });
+
+  if (p == std::end(opNames) || name != p->name)
+    return AsmOp::NONE;
+
+  return p->op;
 }
 
 bool
 C6502::
-assembleLine(ushort &addr, const std::string &line)
+assembleLine(ushort &addr, std::string_view line)
 {
   if (isDebug())
     std::cerr << "Line: '" << line << "'\n";
 
   CParser parse(line);
 
+  fixupLabel_ = "";
+
   while (! parse.eof()) {
     parse.skipSpace();
 
@@ -1312,14 +3199,14 @@ assembleLine(ushort &addr, const std::string &line)
     if (parse.isChar(';')) break;
 
     // read first word
-    std::string word;
+    std::string_view word;
 
     if (! parse.readWord(word))
       continue;
 
     // handle label and update first word
     if (word[word.size() - 1] == ':') {
-      std::string label = word.substr(0, word.size() - 1);
+      std::string_view label = word.substr(0, word.size() - 1);
 
       setLabel(label, addr, 4);
 
@@ -1327,14 +3214,14 @@ assembleLine(ushort &addr, const std::string &line)
         continue;
     }
 
-    std::string opName = parse.toUpper(word);
+    AsmOp op = lookupAsmOp(word);
 
     //---
 
     // handle define
 
-    if (opName == "DEFINE") {
-      auto stringToValue = [](const std::string &str, ushort &ivalue, int &ilen) {
+    if (op == AsmOp::DEFINE) {
+      auto stringToValue = [](std::string_view str, ushort &ivalue, int &ilen) {
         static std::string xchars = "0123456789abcdef";
         static std::string dchars = "0123456789";
 
@@ -1375,14 +3262,14 @@ assembleLine(ushort &addr, const std::string &line)
       };
 
       // read label
-      std::string label;
+      std::string_view label;
 
       if (! parse.readWord(label)) {
         std::cerr << "Invalid define '" << line << "'\n";
         return false;
       }
 
-      std::string value;
+      std::string_view value;
 
       if (! parse.readWord(value)) {
         std::cerr << "Invalid define '" << line << "'\n";
@@ -1404,8 +3291,8 @@ assembleLine(ushort &addr, const std::string &line)
 
     //---
 
-    if (opName == "ORG") {
-      std::string arg;
+    if (op == AsmOp::ORG) {
+      std::string_view arg;
 
       if (! parse.readWord(arg)) {
         std::cerr << "Invalid ORG '" << line << "'\n";
@@ -1428,8 +3315,33 @@ assembleLine(ushort &addr, const std::string &line)
 
     //---
 
-    if (opName == "DB") {
-      std::string arg;
+    // CPU variant (6502, 6502X (undocumented instructions), 65C02, 2A03)
+    if (op == AsmOp::CPU) {
+      std::string_view arg;
+
+      if (! parse.readWord(arg)) {
+        std::cerr << "Invalid CPU '" << line << "'\n";
+        return false;
+      }
+
+      std::string name = parse.toUpper(arg);
+
+      if      (name == "6502" ) setVariant(Variant::NMOS);
+      else if (name == "6502X") { setVariant(Variant::NMOS); setUnsupported(true); }
+      else if (name == "65C02") setVariant(Variant::CMOS);
+      else if (name == "2A03" ) setVariant(Variant::R2A03);
+      else {
+        std::cerr << "Invalid CPU '" << line << "'\n";
+        return false;
+      }
+
+      break;
+    }
+
+    //---
+
+    if (op == AsmOp::DB) {
+      std::string_view arg;
 
       if (! parse.readWord(arg)) {
         std::cerr << "Invalid DB '" << line << "'\n";
@@ -1439,7 +3351,7 @@ assembleLine(ushort &addr, const std::string &line)
       CParser parse1(arg);
 
       while (! parse1.eof()) {
-        std::string word1;
+        std::string_view word1;
 
         if (! parse1.readSepWord(word1, ','))
           break;
@@ -1475,8 +3387,8 @@ assembleLine(ushort &addr, const std::string &line)
 
     //---
 
-    if (opName == "OUT" || opName == "OUTN") {
-      std::string arg;
+    if (op == AsmOp::OUT || op == AsmOp::OUTN) {
+      std::string_view arg;
 
       if (! parse.readWord(arg)) {
         std::cerr << "Invalid OUT/OUTN '" << line << "'\n";
@@ -1490,7 +3402,7 @@ assembleLine(ushort &addr, const std::string &line)
         ushort a = 0x0000; bool aSet = false;
 
         while (! parse1.eof()) {
-          std::string word1;
+          std::string_view word1;
 
           if (! parse1.readSepWord(word1, ','))
             break;
@@ -1506,7 +3418,7 @@ assembleLine(ushort &addr, const std::string &line)
           else {
             CParser parse2(word1);
 
-            std::string label;
+            std::string_view label;
 
             if      (parse2.isValue()) {
               uchar vlen;
@@ -1515,13 +3427,10 @@ assembleLine(ushort &addr, const std::string &line)
               aSet = true;
             }
             else if (parse2.readLabel(label)) {
-              ushort lvalue;
-              uchar  llen;
+              uchar llen;
 
-              if (! getLabel(label, lvalue, llen))
-                ++numBadLabels_;
+              lookupLabel(label, a, llen);
 
-              a    = lvalue;
               aSet = true;
             }
             else {
@@ -1533,15 +3442,16 @@ assembleLine(ushort &addr, const std::string &line)
 
         if (o != 0x00) {
           addByte(addr, 0x20                                    ); // JSR
-          addWord(addr, (opName == "OUT" ? outAddr_ : outNAddr_)); // OUT
+          addWord(addr, (op == AsmOp::OUT ? outAddr_ : outNAddr_)); // OUT
           addByte(addr, 0xA9                                    ); // LDA
           addByte(addr, o                                       ); // VALUE
         }
 
         if (aSet) {
           addByte(addr, 0x20                                          ); // JSR
-          addWord(addr, (opName == "OUT" ? outMemAddr_ : outMemNAddr_)); // OUT
+          addWord(addr, (op == AsmOp::OUT ? outMemAddr_ : outMemNAddr_)); // OUT
           addByte(addr, 0xAD                                          ); // LDA
+          addFixup(addr, FixupKind::WORD);
           addWord(addr, a                                             ); // VALUE
         }
       }
@@ -1555,8 +3465,8 @@ assembleLine(ushort &addr, const std::string &line)
 
     //---
 
-    if (opName == "OUTS") {
-      std::string arg;
+    if (op == AsmOp::OUTS) {
+      std::string_view arg;
 
       if (! parse.readWord(arg)) {
         std::cerr << "Invalid OUTS '" << line << "'\n";
@@ -1568,7 +3478,7 @@ assembleLine(ushort &addr, const std::string &line)
 
         ushort a = 0x0000;
 
-        std::string label;
+        std::string_view label;
 
         if      (parse1.isValue()) {
           uchar vlen;
@@ -1576,13 +3486,9 @@ assembleLine(ushort &addr, const std::string &line)
           a = parse1.getValue(vlen);
         }
         else if (parse1.readLabel(label)) {
-          ushort lvalue;
-          uchar  llen;
-
-          if (! getLabel(label, lvalue, llen))
-            ++numBadLabels_;
+          uchar llen;
 
-          a = lvalue;
+          lookupLabel(label, a, llen);
         }
         else {
           std::cerr << "Invalid OUTS arg '" << arg << "'\n";
@@ -1592,6 +3498,7 @@ assembleLine(ushort &addr, const std::string &line)
         addByte(addr, 0x20       ); // JSR
         addWord(addr, outStrAddr_); // OUT
         addByte(addr, 0xAD       ); // LDA
+        addFixup(addr, FixupKind::WORD);
         addWord(addr, a          ); // VALUE
       }
       else {
@@ -1607,21 +3514,35 @@ assembleLine(ushort &addr, const std::string &line)
     // handle op
 
     if (isDebug())
-      std::cerr << "  " << opName;
+      std::cerr << "  " << word;
 
     // read optional arg
-    std::string arg;
+    std::string_view arg;
 
     if (parse.readWord(arg)) {
       if (isDebug())
         std::cerr << " " << arg;
     }
 
-    if (! assembleOp(addr, opName, arg)) {
+    ushort opAddr = addr;
+
+    if (! assembleOp(addr, op, word, arg)) {
       std::cerr << "Bad OP : '" << line << "'\n";
       break;
     }
 
+    // operand with unresolved label (relative for branch)
+    if (fixupLabel_ != "" && addr - opAddr > 1) {
+      bool branch = (op == AsmOp::BCC || op == AsmOp::BCS || op == AsmOp::BEQ ||
+                     op == AsmOp::BMI || op == AsmOp::BNE || op == AsmOp::BPL ||
+                     op == AsmOp::BRA || op == AsmOp::BVC || op == AsmOp::BVS);
+
+      FixupKind kind = (branch ? FixupKind::RELATIVE :
+                        addr - opAddr == 2 ? FixupKind::BYTE : FixupKind::WORD);
+
+      addFixup(opAddr + 1, kind);
+    }
+
     if (isDebug())
       std::cerr << "\n";
 
@@ -1633,7 +3554,7 @@ assembleLine(ushort &addr, const std::string &line)
 
 bool
 C6502::
-assembleOp(ushort &addr, const std::string &opName, const std::string &arg)
+assembleOp(ushort &addr, AsmOp op, std::string_view opName, std::string_view arg)
 {
   auto addByte = [&](ushort c) { setByte(addr++, uchar(c & 0xFF)); };
   auto addWord = [&](ushort c) { addByte(c & 0x00FF); addByte((c & 0xFF00) >> 8); };
@@ -1655,7 +3576,14 @@ assembleOp(ushort &addr, const std::string &opName, const std::string &arg)
   uchar   vlen   = 0;
   schar   rvalue = 0;
 
-  if (arg != "") {
+  bool cmos = (variant_ == Variant::CMOS);
+
+  // shift/rotate (and 65C02 INC/DEC) with no arg is accumulator
+  if      (arg == "" && (op == AsmOp::ASL || op == AsmOp::LSR || op == AsmOp::ROL || op == AsmOp::ROR ||
+                         (cmos && (op == AsmOp::INC || op == AsmOp::DEC)))) {
+    mode = ArgMode::A;
+  }
+  else if (arg != "") {
     if (! decodeAssembleArg(arg, mode, xyMode, value, vlen)) {
       std::cerr << "Invalid arg '" << arg << "'\n";
       return false;
@@ -1667,638 +3595,716 @@ assembleOp(ushort &addr, const std::string &opName, const std::string &arg)
 
   //---
 
-  if      (opName == "ADC") {
-    if      (xyMode == XYMode::NONE) {
-      // ADC #$xx (immediate)
-      if      (mode == ArgMode::LITERAL) {
-        if (vlen <= 2) { return addOpByte(0x69, value); }
-      }
-      // ADC $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x65, value); } // zero page
-        else           { return addOpWord(0x6D, value); }
-      }
-    }
-    else if (xyMode == XYMode::X) {
-      // ADC $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x75, value); } // zero page
-        else           { return addOpWord(0x7D, value); }
-      }
-      // ADC ($xx,X)
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0x61, value);
-      }
-    }
-    else if (xyMode == XYMode::Y) {
-      // ADC $xx,Y (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return false; } // zero page
-        else           { return addOpWord(0x79, value); }
-      }
-      // ADC ($xx),Y
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0x71, value);
+  // 65C02 instructions
+  if (cmos) {
+    // OP ($xx) (zero page indirect)
+    if (mode == ArgMode::MEMORY_CONTENTS && xyMode == XYMode::NONE && vlen <= 2) {
+      switch (op) {
+        case AsmOp::ORA: { return addOpByte(0x12, value); }
+        case AsmOp::AND: { return addOpByte(0x32, value); }
+        case AsmOp::EOR: { return addOpByte(0x52, value); }
+        case AsmOp::ADC: { return addOpByte(0x72, value); }
+        case AsmOp::STA: { return addOpByte(0x92, value); }
+        case AsmOp::LDA: { return addOpByte(0xB2, value); }
+        case AsmOp::CMP: { return addOpByte(0xD2, value); }
+        case AsmOp::SBC: { return addOpByte(0xF2, value); }
+        default: break;
       }
     }
 
-    return false;
-  }
+    switch (op) {
+      case AsmOp::BIT: {
+        // BIT #$xx (immediate)
+        if      (mode == ArgMode::LITERAL && vlen <= 2) {
+          return addOpByte(0x89, value);
+        }
+        // BIT $xx,X (absolute or zero page)
+        else if (mode == ArgMode::MEMORY && xyMode == XYMode::X) {
+          if (vlen <= 2) { return addOpByte(0x34, value); } // zero page
+          else           { return addOpWord(0x3C, value); }
+        }
 
-  else if (opName == "AND") {
-    if      (xyMode == XYMode::NONE) {
-      // AND #$xx (immediate)
-      if      (mode == ArgMode::LITERAL) {
-        if (vlen <= 2) { return addOpByte(0x29, value); }
+        break;
       }
-      // AND $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x25, value); } // zero page
-        else           { return addOpWord(0x2D, value); }
+      case AsmOp::INC: { if (mode == ArgMode::A) return addOp(0x1A); break; }
+      case AsmOp::DEC: { if (mode == ArgMode::A) return addOp(0x3A); break; }
+      case AsmOp::JMP: {
+        // JMP ($xxxx,X)
+        if (mode == ArgMode::MEMORY_CONTENTS && xyMode == XYMode::X)
+          return addOpWord(0x7C, value);
+
+        break;
       }
-    }
-    else if (xyMode == XYMode::X) {
-      // AND $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x35, value); } // zero page
-        else           { return addOpWord(0x3D, value); }
-      }
-      // AND ($xx,X)
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0x21, value);
-      }
-    }
-    else if (xyMode == XYMode::Y) {
-      // AND $xx,Y (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return false; } // zero page
-        else           { return addOpWord(0x39, value); }
-      }
-      // AND ($xx),Y
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0x31, value);
-      }
-    }
+      case AsmOp::TSB: case AsmOp::TRB: {
+        bool tsb = (op == AsmOp::TSB);
 
-    return false;
-  }
+        // TSB/TRB $xx (absolute or zero page)
+        if (mode == ArgMode::MEMORY && xyMode == XYMode::NONE) {
+          if (vlen <= 2) { return addOpByte(tsb ? 0x04 : 0x14, value); } // zero page
+          else           { return addOpWord(tsb ? 0x0C : 0x1C, value); }
+        }
 
-  else if (opName == "ASL") {
-    if      (xyMode == XYMode::NONE) {
-      // ASL #$xx (immediate)
-      if      (mode == ArgMode::A) {
-        return addOp(0x0A);
-      }
-      // ASL $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x06, value); } // zero page
-        else           { return addOpWord(0x0E, value); }
-      }
-    }
-    else if (xyMode == XYMode::X) {
-      // ASL $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x16, value); } // zero page
-        else           { return addOpWord(0x1E, value); }
+        return false;
       }
-    }
-
-    return false;
-  }
-
-  else if (opName == "BCC") { return addOpRelative(0x90, rvalue); }
-  else if (opName == "BCS") { return addOpRelative(0xB0, rvalue); }
-  else if (opName == "BEQ") { return addOpRelative(0xF0, rvalue); }
+      case AsmOp::STZ: {
+        if      (mode == ArgMode::MEMORY && xyMode == XYMode::NONE) {
+          // STZ $xx (absolute or zero page)
+          if (vlen <= 2) { return addOpByte(0x64, value); } // zero page
+          else           { return addOpWord(0x9C, value); }
+        }
+        else if (mode == ArgMode::MEMORY && xyMode == XYMode::X) {
+          // STZ $xx,X (absolute or zero page)
+          if (vlen <= 2) { return addOpByte(0x74, value); } // zero page
+          else           { return addOpWord(0x9E, value); }
+        }
 
-  else if (opName == "BIT") {
-    if (xyMode == XYMode::NONE) {
-      // BIT $xx (absolute or zero page)
-      if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x24, value); } // zero page
-        else           { return addOpWord(0x2C, value); }
+        return false;
       }
+      case AsmOp::BRA: { return addOpRelative(0x80, rvalue); }
+      case AsmOp::PHX: { return addOp(0xDA); }
+      case AsmOp::PHY: { return addOp(0x5A); }
+      case AsmOp::PLX: { return addOp(0xFA); }
+      case AsmOp::PLY: { return addOp(0x7A); }
+      default: break;
     }
-
-    return false;
   }
 
-  else if (opName == "BMI") { return addOpRelative(0x30, rvalue); }
-  else if (opName == "BNE") { return addOpRelative(0xD0, rvalue); }
-  else if (opName == "BPL") { return addOpRelative(0x10, rvalue); }
-
-  else if (opName == "BRK") { return addOp(0x00); }
-
-  else if (opName == "BVC") { return addOpRelative(0x50, rvalue); }
-  else if (opName == "BVS") { return addOpRelative(0x70, rvalue); }
-
-  else if (opName == "CLC") { return addOp(0x18); }
-  else if (opName == "CLD") { return addOp(0xD8); }
-  else if (opName == "CLI") { return addOp(0x58); }
-  else if (opName == "CLV") { return addOp(0xB8); }
+  //---
 
-  else if (opName == "CMP") {
-    if      (xyMode == XYMode::NONE) {
-      // CMP #$xx (immediate)
-      if      (mode == ArgMode::LITERAL && vlen <= 2) {
-        return addOpByte(0xC9, value);
-      }
-      // CMP $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xC5, value); } // zero page
-        else           { return addOpWord(0xCD, value); }
-      }
-    }
-    else if (xyMode == XYMode::X) {
-      // CMP $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xD5, value); } // zero page
-        else           { return addOpWord(0xDD, value); }
-      }
-      // CMP ($xx,X)
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0xC1, value);
+  switch (op) {
+    case AsmOp::ADC: {
+      if      (xyMode == XYMode::NONE) {
+        // ADC #$xx (immediate)
+        if      (mode == ArgMode::LITERAL) {
+          if (vlen <= 2) { return addOpByte(0x69, value); }
+        }
+        // ADC $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x65, value); } // zero page
+          else           { return addOpWord(0x6D, value); }
+        }
       }
-    }
-    else if (xyMode == XYMode::Y) {
-      // CMP $xx,Y (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return false; } // zero page
-        else           { return addOpWord(0xD9, value); }
+      else if (xyMode == XYMode::X) {
+        // ADC $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x75, value); } // zero page
+          else           { return addOpWord(0x7D, value); }
+        }
+        // ADC ($xx,X)
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0x61, value);
+        }
       }
-      // CMP ($xx),Y
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0xD1, value);
+      else if (xyMode == XYMode::Y) {
+        // ADC $xx,Y (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return false; } // zero page
+          else           { return addOpWord(0x79, value); }
+        }
+        // ADC ($xx),Y
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0x71, value);
+        }
       }
-    }
 
-    return false;
-  }
-
-  else if (opName == "CPX") {
-    if (xyMode == XYMode::NONE) {
-      // CPX #$xx (immediate)
-      if      (mode == ArgMode::LITERAL && vlen <= 2) {
-        return addOpByte(0xE0, value);
-      }
-      // CPX $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xE4, value); } // zero page
-        else           { return addOpWord(0xEC, value); }
-      }
+      return false;
     }
 
-    return false;
-  }
-
-  else if (opName == "CPY") {
-    if (xyMode == XYMode::NONE) {
-      // CPY #$xx (immediate)
-      if      (mode == ArgMode::LITERAL && vlen <= 2) {
-        return addOpByte(0xC0, value);
-      }
-      // CPY $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xC4, value); } // zero page
-        else           { return addOpWord(0xCC, value); }
+    case AsmOp::AND: {
+      if      (xyMode == XYMode::NONE) {
+        // AND #$xx (immediate)
+        if      (mode == ArgMode::LITERAL) {
+          if (vlen <= 2) { return addOpByte(0x29, value); }
+        }
+        // AND $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x25, value); } // zero page
+          else           { return addOpWord(0x2D, value); }
+        }
       }
-    }
-
-    return false;
-  }
-
-  else if (opName == "DEC") {
-    if      (xyMode == XYMode::NONE) {
-      // DEC $xx (absolute or zero page)
-      if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xC6, value); } // zero page
-        else           { return addOpWord(0xCE, value); }
+      else if (xyMode == XYMode::X) {
+        // AND $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x35, value); } // zero page
+          else           { return addOpWord(0x3D, value); }
+        }
+        // AND ($xx,X)
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0x21, value);
+        }
       }
-    }
-    else if (xyMode == XYMode::X) {
-      // DEC $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xD6, value); } // zero page
-        else           { return addOpWord(0xDE, value); }
+      else if (xyMode == XYMode::Y) {
+        // AND $xx,Y (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return false; } // zero page
+          else           { return addOpWord(0x39, value); }
+        }
+        // AND ($xx),Y
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0x31, value);
+        }
       }
-    }
-
-    return false;
-  }
 
-  else if (opName == "DEX") { return addOp(0xCA); }
-  else if (opName == "DEY") { return addOp(0x88); }
-
-  else if (opName == "EOR") {
-    if      (xyMode == XYMode::NONE) {
-      // EOR #$xx (immediate)
-      if      (mode == ArgMode::LITERAL) {
-        if (vlen <= 2) { return addOpByte(0x49, value); }
-      }
-      // EOR $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x45, value); } // zero page
-        else           { return addOpWord(0x4D, value); }
-      }
-    }
-    else if (xyMode == XYMode::X) {
-      // EOR $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x55, value); } // zero page
-        else           { return addOpWord(0x5D, value); }
-      }
-      // EOR ($xx,X)
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0x41, value);
-      }
-    }
-    else if (xyMode == XYMode::Y) {
-      // EOR $xx,Y (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return false; } // zero page
-        else           { return addOpWord(0x59, value); }
-      }
-      // EOR ($xx),Y
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0x51, value);
-      }
+      return false;
     }
 
-    return false;
-  }
-
-  else if (opName == "INC") {
-    if      (xyMode == XYMode::NONE) {
-      // INC $xx (absolute or zero page)
-      if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xE6, value); } // zero page
-        else           { return addOpWord(0xEE, value); }
+    case AsmOp::ASL: {
+      if      (xyMode == XYMode::NONE) {
+        // ASL #$xx (immediate)
+        if      (mode == ArgMode::A) {
+          return addOp(0x0A);
+        }
+        // ASL $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x06, value); } // zero page
+          else           { return addOpWord(0x0E, value); }
+        }
       }
-    }
-    else if (xyMode == XYMode::X) {
-      // INC $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xF6, value); } // zero page
-        else           { return addOpWord(0xFE, value); }
+      else if (xyMode == XYMode::X) {
+        // ASL $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x16, value); } // zero page
+          else           { return addOpWord(0x1E, value); }
+        }
       }
-    }
 
-    return false;
-  }
+      return false;
+    }
 
-  else if (opName == "INX") { return addOp(0xE8); }
-  else if (opName == "INY") { return addOp(0xC8); }
+    case AsmOp::BCC: { return addOpRelative(0x90, rvalue); }
+    case AsmOp::BCS: { return addOpRelative(0xB0, rvalue); }
+    case AsmOp::BEQ: { return addOpRelative(0xF0, rvalue); }
 
-  else if (opName == "JMP") {
-    if (xyMode == XYMode::NONE) {
-      // JMP $xx (absolute)
-      if      (mode == ArgMode::MEMORY) {
-        return addOpWord(0x4C, value);
-      }
-      // JMP $xx (indirect)
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0x6C, value);
+    case AsmOp::BIT: {
+      if (xyMode == XYMode::NONE) {
+        // BIT $xx (absolute or zero page)
+        if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x24, value); } // zero page
+          else           { return addOpWord(0x2C, value); }
+        }
       }
+
+      return false;
     }
 
-    return false;
-  }
+    case AsmOp::BMI: { return addOpRelative(0x30, rvalue); }
+    case AsmOp::BNE: { return addOpRelative(0xD0, rvalue); }
+    case AsmOp::BPL: { return addOpRelative(0x10, rvalue); }
 
-  else if (opName == "JSR") {
-    if (xyMode == XYMode::NONE) {
-      // JMP $xx (absolute)
-      if (mode == ArgMode::MEMORY) {
-        return addOpWord(0x20, value);
-      }
-    }
+    case AsmOp::BRK: { return addOp(0x00); }
 
-    return false;
-  }
+    case AsmOp::BVC: { return addOpRelative(0x50, rvalue); }
+    case AsmOp::BVS: { return addOpRelative(0x70, rvalue); }
 
-  else if (opName == "LDA") {
-    if      (xyMode == XYMode::NONE) {
-      // LDA #$xx (immediate)
-      if      (mode == ArgMode::LITERAL) {
-        if (vlen <= 2) { return addOpByte(0xA9, value); }
+    case AsmOp::CLC: { return addOp(0x18); }
+    case AsmOp::CLD: { return addOp(0xD8); }
+    case AsmOp::CLI: { return addOp(0x58); }
+    case AsmOp::CLV: { return addOp(0xB8); }
+
+    case AsmOp::CMP: {
+      if      (xyMode == XYMode::NONE) {
+        // CMP #$xx (immediate)
+        if      (mode == ArgMode::LITERAL && vlen <= 2) {
+          return addOpByte(0xC9, value);
+        }
+        // CMP $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xC5, value); } // zero page
+          else           { return addOpWord(0xCD, value); }
+        }
+      }
+      else if (xyMode == XYMode::X) {
+        // CMP $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xD5, value); } // zero page
+          else           { return addOpWord(0xDD, value); }
+        }
+        // CMP ($xx,X)
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0xC1, value);
+        }
       }
-      // LDA $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xA5, value); } // zero page
-        else           { return addOpWord(0xAD, value); }
+      else if (xyMode == XYMode::Y) {
+        // CMP $xx,Y (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return false; } // zero page
+          else           { return addOpWord(0xD9, value); }
+        }
+        // CMP ($xx),Y
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0xD1, value);
+        }
       }
+
+      return false;
     }
-    else if (xyMode == XYMode::X) {
-      // LDA $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xB5, value); } // zero page
-        else           { return addOpWord(0xBD, value); }
+
+    case AsmOp::CPX: {
+      if (xyMode == XYMode::NONE) {
+        // CPX #$xx (immediate)
+        if      (mode == ArgMode::LITERAL && vlen <= 2) {
+          return addOpByte(0xE0, value);
+        }
+        // CPX $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xE4, value); } // zero page
+          else           { return addOpWord(0xEC, value); }
+        }
       }
-      // LDA ($xx,X)
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0xA1, value);
+
+      return false;
+    }
+
+    case AsmOp::CPY: {
+      if (xyMode == XYMode::NONE) {
+        // CPY #$xx (immediate)
+        if      (mode == ArgMode::LITERAL && vlen <= 2) {
+          return addOpByte(0xC0, value);
+        }
+        // CPY $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xC4, value); } // zero page
+          else           { return addOpWord(0xCC, value); }
+        }
       }
+
+      return false;
     }
-    else if (xyMode == XYMode::Y) {
-      // LDA $xx,Y (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return false; } // zero page
-        else           { return addOpWord(0xB9, value); }
+
+    case AsmOp::DEC: {
+      if      (xyMode == XYMode::NONE) {
+        // DEC $xx (absolute or zero page)
+        if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xC6, value); } // zero page
+          else           { return addOpWord(0xCE, value); }
+        }
       }
-      // LDA ($xx),Y
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0xB1, value);
+      else if (xyMode == XYMode::X) {
+        // DEC $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xD6, value); } // zero page
+          else           { return addOpWord(0xDE, value); }
+        }
       }
+
+      return false;
     }
 
-    return false;
-  }
+    case AsmOp::DEX: { return addOp(0xCA); }
+    case AsmOp::DEY: { return addOp(0x88); }
 
-  else if (opName == "LDX") {
-    if      (xyMode == XYMode::NONE) {
-      // LDX #$xx (immediate)
-      if      (mode == ArgMode::LITERAL && vlen <= 2) {
-        return addOpByte(0xA2, value);
+    case AsmOp::EOR: {
+      if      (xyMode == XYMode::NONE) {
+        // EOR #$xx (immediate)
+        if      (mode == ArgMode::LITERAL) {
+          if (vlen <= 2) { return addOpByte(0x49, value); }
+        }
+        // EOR $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x45, value); } // zero page
+          else           { return addOpWord(0x4D, value); }
+        }
       }
-      // LDX $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xA6, value); } // zero page
-        else           { return addOpWord(0xAE, value); }
+      else if (xyMode == XYMode::X) {
+        // EOR $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x55, value); } // zero page
+          else           { return addOpWord(0x5D, value); }
+        }
+        // EOR ($xx,X)
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0x41, value);
+        }
       }
-    }
-    else if (xyMode == XYMode::Y) {
-      // LDX $xx,Y (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xB6, value); } // zero page
-        else           { return addOpWord(0xBE, value); }
+      else if (xyMode == XYMode::Y) {
+        // EOR $xx,Y (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return false; } // zero page
+          else           { return addOpWord(0x59, value); }
+        }
+        // EOR ($xx),Y
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0x51, value);
+        }
       }
+
+      return false;
     }
 
-    return false;
-  }
-  else if (opName == "LDY") {
-    if      (xyMode == XYMode::NONE) {
-      // LDY #$xx (immediate)
-      if      (mode == ArgMode::LITERAL && vlen <= 2) {
-        return addOpByte(0xA0, value);
-      }
-      // LDY $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xA4, value); } // zero page
-        else           { return addOpWord(0xAC, value); }
+    case AsmOp::INC: {
+      if      (xyMode == XYMode::NONE) {
+        // INC $xx (absolute or zero page)
+        if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xE6, value); } // zero page
+          else           { return addOpWord(0xEE, value); }
+        }
       }
-    }
-    else if (xyMode == XYMode::X) {
-      // LDY $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xB4, value); } // zero page
-        else           { return addOpWord(0xBC, value); }
+      else if (xyMode == XYMode::X) {
+        // INC $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xF6, value); } // zero page
+          else           { return addOpWord(0xFE, value); }
+        }
       }
+
+      return false;
     }
 
-    return false;
-  }
+    case AsmOp::INX: { return addOp(0xE8); }
+    case AsmOp::INY: { return addOp(0xC8); }
 
-  else if (opName == "LSR") {
-    if      (xyMode == XYMode::NONE) {
-      // LSR #$xx (immediate)
-      if      (mode == ArgMode::A) {
-        return addOp(0x4A);
-      }
-      // LSR $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x46, value); } // zero page
-        else           { return addOpWord(0x4E, value); }
-      }
-    }
-    else if (xyMode == XYMode::X) {
-      // LSR $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x56, value); } // zero page
-        else           { return addOpWord(0x5E, value); }
+    case AsmOp::JMP: {
+      if (xyMode == XYMode::NONE) {
+        // JMP $xx (absolute)
+        if      (mode == ArgMode::MEMORY) {
+          return addOpWord(0x4C, value);
+        }
+        // JMP $xx (indirect)
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpWord(0x6C, value);
+        }
       }
+
+      return false;
     }
 
-    return false;
-  }
+    case AsmOp::JSR: {
+      if (xyMode == XYMode::NONE) {
+        // JMP $xx (absolute)
+        if (mode == ArgMode::MEMORY) {
+          return addOpWord(0x20, value);
+        }
+      }
 
-  else if (opName == "NOP") { return addOp(0xEA); }
+      return false;
+    }
 
-  else if (opName == "ORA") {
-    if      (xyMode == XYMode::NONE) {
-      // ORA #$xx (immediate)
-      if      (mode == ArgMode::LITERAL) {
-        if (vlen <= 2) { return addOpByte(0x09, value); }
+    case AsmOp::LDA: {
+      if      (xyMode == XYMode::NONE) {
+        // LDA #$xx (immediate)
+        if      (mode == ArgMode::LITERAL) {
+          if (vlen <= 2) { return addOpByte(0xA9, value); }
+        }
+        // LDA $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xA5, value); } // zero page
+          else           { return addOpWord(0xAD, value); }
+        }
       }
-      // ORA $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x05, value); } // zero page
-        else           { return addOpWord(0x0D, value); }
+      else if (xyMode == XYMode::X) {
+        // LDA $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xB5, value); } // zero page
+          else           { return addOpWord(0xBD, value); }
+        }
+        // LDA ($xx,X)
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0xA1, value);
+        }
+      }
+      else if (xyMode == XYMode::Y) {
+        // LDA $xx,Y (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return false; } // zero page
+          else           { return addOpWord(0xB9, value); }
+        }
+        // LDA ($xx),Y
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0xB1, value);
+        }
       }
+
+      return false;
     }
-    else if (xyMode == XYMode::X) {
-      // ORA $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x15, value); } // zero page
-        else           { return addOpWord(0x1D, value); }
+
+    case AsmOp::LDX: {
+      if      (xyMode == XYMode::NONE) {
+        // LDX #$xx (immediate)
+        if      (mode == ArgMode::LITERAL && vlen <= 2) {
+          return addOpByte(0xA2, value);
+        }
+        // LDX $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xA6, value); } // zero page
+          else           { return addOpWord(0xAE, value); }
+        }
       }
-      // ORA ($xx,X)
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0x01, value);
+      else if (xyMode == XYMode::Y) {
+        // LDX $xx,Y (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xB6, value); } // zero page
+          else           { return addOpWord(0xBE, value); }
+        }
       }
+
+      return false;
     }
-    else if (xyMode == XYMode::Y) {
-      // ORA $xx,Y (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return false; } // zero page
-        else           { return addOpWord(0x19, value); }
+    case AsmOp::LDY: {
+      if      (xyMode == XYMode::NONE) {
+        // LDY #$xx (immediate)
+        if      (mode == ArgMode::LITERAL && vlen <= 2) {
+          return addOpByte(0xA0, value);
+        }
+        // LDY $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xA4, value); } // zero page
+          else           { return addOpWord(0xAC, value); }
+        }
       }
-      // ORA ($xx),Y
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0x11, value);
+      else if (xyMode == XYMode::X) {
+        // LDY $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xB4, value); } // zero page
+          else           { return addOpWord(0xBC, value); }
+        }
       }
-    }
-
-    return false;
-  }
 
-  else if (opName == "PHA") { return addOp(0x48); }
-  else if (opName == "PHP") { return addOp(0x08); }
-  else if (opName == "PLA") { return addOp(0x68); }
-  else if (opName == "PLP") { return addOp(0x28); }
+      return false;
+    }
 
-  else if (opName == "ROL") {
-    if      (xyMode == XYMode::NONE) {
-      // ROL #$xx (immediate)
-      if      (mode == ArgMode::A) {
-        return addOp(0x2A);
-      }
-      // ROL $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x26, value); } // zero page
-        else           { return addOpWord(0x2E, value); }
+    case AsmOp::LSR: {
+      if      (xyMode == XYMode::NONE) {
+        // LSR #$xx (immediate)
+        if      (mode == ArgMode::A) {
+          return addOp(0x4A);
+        }
+        // LSR $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x46, value); } // zero page
+          else           { return addOpWord(0x4E, value); }
+        }
       }
-    }
-    else if (xyMode == XYMode::X) {
-      // ROL $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x36, value); } // zero page
-        else           { return addOpWord(0x3E, value); }
+      else if (xyMode == XYMode::X) {
+        // LSR $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x56, value); } // zero page
+          else           { return addOpWord(0x5E, value); }
+        }
       }
+
+      return false;
     }
 
-    return false;
-  }
+    case AsmOp::NOP: { return addOp(0xEA); }
 
-  else if (opName == "ROR") {
-    if      (xyMode == XYMode::NONE) {
-      // ROR #$xx (immediate)
-      if      (mode == ArgMode::A) {
-        return addOp(0x6A);
+    case AsmOp::ORA: {
+      if      (xyMode == XYMode::NONE) {
+        // ORA #$xx (immediate)
+        if      (mode == ArgMode::LITERAL) {
+          if (vlen <= 2) { return addOpByte(0x09, value); }
+        }
+        // ORA $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x05, value); } // zero page
+          else           { return addOpWord(0x0D, value); }
+        }
       }
-      // ROR $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x66, value); } // zero page
-        else           { return addOpWord(0x6E, value); }
+      else if (xyMode == XYMode::X) {
+        // ORA $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x15, value); } // zero page
+          else           { return addOpWord(0x1D, value); }
+        }
+        // ORA ($xx,X)
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0x01, value);
+        }
       }
-    }
-    else if (xyMode == XYMode::X) {
-      // ROR $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x76, value); } // zero page
-        else           { return addOpWord(0x7E, value); }
+      else if (xyMode == XYMode::Y) {
+        // ORA $xx,Y (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return false; } // zero page
+          else           { return addOpWord(0x19, value); }
+        }
+        // ORA ($xx),Y
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0x11, value);
+        }
       }
-    }
 
-    return false;
-  }
+      return false;
+    }
 
-  else if (opName == "RTI") { return addOp(0x40); }
-  else if (opName == "RTS") { return addOp(0x60); }
+    case AsmOp::PHA: { return addOp(0x48); }
+    case AsmOp::PHP: { return addOp(0x08); }
+    case AsmOp::PLA: { return addOp(0x68); }
+    case AsmOp::PLP: { return addOp(0x28); }
 
-  else if (opName == "SBC") {
-    if      (xyMode == XYMode::NONE) {
-      // SBC #$xx (immediate)
-      if      (mode == ArgMode::LITERAL) {
-        if (vlen <= 2) { return addOpByte(0xE9, value); }
-      }
-      // SBC $xx (absolute or zero page)
-      else if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xE5, value); } // zero page
-        else           { return addOpWord(0xED, value); }
-      }
-    }
-    else if (xyMode == XYMode::X) {
-      // SBC $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0xF5, value); } // zero page
-        else           { return addOpWord(0xFD, value); }
+    case AsmOp::ROL: {
+      if      (xyMode == XYMode::NONE) {
+        // ROL #$xx (immediate)
+        if      (mode == ArgMode::A) {
+          return addOp(0x2A);
+        }
+        // ROL $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x26, value); } // zero page
+          else           { return addOpWord(0x2E, value); }
+        }
       }
-      // SBC ($xx,X)
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0xE1, value);
+      else if (xyMode == XYMode::X) {
+        // ROL $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x36, value); } // zero page
+          else           { return addOpWord(0x3E, value); }
+        }
       }
+
+      return false;
     }
-    else if (xyMode == XYMode::Y) {
-      // SBC $xx,Y (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return false; } // zero page
-        else           { return addOpWord(0xF9, value); }
+
+    case AsmOp::ROR: {
+      if      (xyMode == XYMode::NONE) {
+        // ROR #$xx (immediate)
+        if      (mode == ArgMode::A) {
+          return addOp(0x6A);
+        }
+        // ROR $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x66, value); } // zero page
+          else           { return addOpWord(0x6E, value); }
+        }
       }
-      // SBC ($xx),Y
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0xF1, value);
+      else if (xyMode == XYMode::X) {
+        // ROR $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x76, value); } // zero page
+          else           { return addOpWord(0x7E, value); }
+        }
       }
-    }
 
-    return false;
-  }
+      return false;
+    }
 
-  else if (opName == "SEC") { return addOp(0x38); }
-  else if (opName == "SED") { return addOp(0xF8); }
-  else if (opName == "SEI") { return addOp(0x78); }
+    case AsmOp::RTI: { return addOp(0x40); }
+    case AsmOp::RTS: { return addOp(0x60); }
 
-  else if (opName == "STA") {
-    if      (xyMode == XYMode::NONE) {
-      // STA $xx (absolute or zero page)
-      if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { // zero page
-          return addOpByte(0x85, value);
+    case AsmOp::SBC: {
+      if      (xyMode == XYMode::NONE) {
+        // SBC #$xx (immediate)
+        if      (mode == ArgMode::LITERAL) {
+          if (vlen <= 2) { return addOpByte(0xE9, value); }
         }
-        else {
-          return addOpWord(0x8D, value);
+        // SBC $xx (absolute or zero page)
+        else if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xE5, value); } // zero page
+          else           { return addOpWord(0xED, value); }
         }
       }
-    }
-    else if (xyMode == XYMode::X) {
-      // STA $xx,X (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x95, value); } // zero page
-        else           { return addOpWord(0x9D, value); }
-      }
-      // STA ($xx,X)
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0x81, value);
-      }
-    }
-    else if (xyMode == XYMode::Y) {
-      // STA $xx,Y (absolute or zero page)
-      if      (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return false; } // zero page
-        else           { return addOpWord(0x99, value); }
+      else if (xyMode == XYMode::X) {
+        // SBC $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0xF5, value); } // zero page
+          else           { return addOpWord(0xFD, value); }
+        }
+        // SBC ($xx,X)
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0xE1, value);
+        }
       }
-      // STA ($xx),Y
-      else if (mode == ArgMode::MEMORY_CONTENTS) {
-        return addOpWord(0x91, value);
+      else if (xyMode == XYMode::Y) {
+        // SBC $xx,Y (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return false; } // zero page
+          else           { return addOpWord(0xF9, value); }
+        }
+        // SBC ($xx),Y
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0xF1, value);
+        }
       }
+
+      return false;
     }
 
-    return false;
-  }
+    case AsmOp::SEC: { return addOp(0x38); }
+    case AsmOp::SED: { return addOp(0xF8); }
+    case AsmOp::SEI: { return addOp(0x78); }
 
-  else if (opName == "STX") {
-    if      (xyMode == XYMode::NONE) {
-      // STX $xx (absolute or zero page)
-      if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x86, value); } // zero page
-        else           { return addOpWord(0x8E, value); }
+    case AsmOp::STA: {
+      if      (xyMode == XYMode::NONE) {
+        // STA $xx (absolute or zero page)
+        if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { // zero page
+            return addOpByte(0x85, value);
+          }
+          else {
+            return addOpWord(0x8D, value);
+          }
+        }
       }
-    }
-    else if (xyMode == XYMode::Y) {
-      // STX $xx,Y (absolute or zero page)
-      if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x96, value); } // zero page
+      else if (xyMode == XYMode::X) {
+        // STA $xx,X (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x95, value); } // zero page
+          else           { return addOpWord(0x9D, value); }
+        }
+        // STA ($xx,X)
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0x81, value);
+        }
       }
+      else if (xyMode == XYMode::Y) {
+        // STA $xx,Y (absolute or zero page)
+        if      (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return false; } // zero page
+          else           { return addOpWord(0x99, value); }
+        }
+        // STA ($xx),Y
+        else if (mode == ArgMode::MEMORY_CONTENTS) {
+          return addOpByte(0x91, value);
+        }
+      }
+
+      return false;
     }
 
-    return false;
-  }
-  else if (opName == "STY") {
-    if      (xyMode == XYMode::NONE) {
-      // STY $xx (absolute or zero page)
-      if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x84, value); } // zero page
-        else           { return addOpWord(0x8C, value); }
+    case AsmOp::STX: {
+      if      (xyMode == XYMode::NONE) {
+        // STX $xx (absolute or zero page)
+        if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x86, value); } // zero page
+          else           { return addOpWord(0x8E, value); }
+        }
       }
-    }
-    else if (xyMode == XYMode::Y) {
-      // STY $xx,Y (absolute or zero page)
-      if (mode == ArgMode::MEMORY) {
-        if (vlen <= 2) { return addOpByte(0x94, value); } // zero page
+      else if (xyMode == XYMode::Y) {
+        // STX $xx,Y (absolute or zero page)
+        if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x96, value); } // zero page
+        }
       }
+
+      return false;
     }
+    case AsmOp::STY: {
+      if      (xyMode == XYMode::NONE) {
+        // STY $xx (absolute or zero page)
+        if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x84, value); } // zero page
+          else           { return addOpWord(0x8C, value); }
+        }
+      }
+      else if (xyMode == XYMode::Y) {
+        // STY $xx,Y (absolute or zero page)
+        if (mode == ArgMode::MEMORY) {
+          if (vlen <= 2) { return addOpByte(0x94, value); } // zero page
+        }
+      }
 
-    return false;
-  }
+      return false;
+    }
 
-  else if (opName == "TAX") { return addOp(0xAA); }
-  else if (opName == "TAY") { return addOp(0xA8); }
-  else if (opName == "TSX") { return addOp(0xBA); }
-  else if (opName == "TXA") { return addOp(0x8A); }
-  else if (opName == "TXS") { return addOp(0x9A); }
-  else if (opName == "TYA") { return addOp(0x98); }
+    case AsmOp::TAX: { return addOp(0xAA); }
+    case AsmOp::TAY: { return addOp(0xA8); }
+    case AsmOp::TSX: { return addOp(0xBA); }
+    case AsmOp::TXA: { return addOp(0x8A); }
+    case AsmOp::TXS: { return addOp(0x9A); }
+    case AsmOp::TYA: { return addOp(0x98); }
 
-  else {
-    std::cerr << "Invalid OP '" << opName << "\n";
-    return false;
+    default: {
+      std::cerr << "Invalid OP '" << opName << "\n";
+      return false;
+    }
   }
 
   return true;
@@ -2306,7 +4312,7 @@ assembleOp(ushort &addr, const std::string &opName, const std::string &arg)
 
 bool
 C6502::
-decodeAssembleArg(const std::string &arg, ArgMode &mode, XYMode &xyMode, ushort &value, uchar &vlen)
+decodeAssembleArg(std::string_view arg, ArgMode &mode, XYMode &xyMode, ushort &value, uchar &vlen)
 {
   mode  = ArgMode::NONE;
   value = 0;
@@ -2352,17 +4358,12 @@ decodeAssembleArg(const std::string &arg, ArgMode &mode, XYMode &xyMode, ushort
       value = parse.getValue(vlen);
     }
     else {
-      std::string label;
+      std::string_view label;
 
       if (parse.readLabel(label)) {
-        ushort lvalue;
-        uchar  llen;
-
-        if (! getLabel(label, lvalue, llen))
-          ++numBadLabels_;
-
-        value = lvalue;
-        vlen  = llen;
+        // unresolved (forward defined) value is byte
+        if (! lookupLabel(label, value, vlen))
+          vlen = 2;
       }
     }
   }
@@ -2385,17 +4386,10 @@ decodeAssembleArg(const std::string &arg, ArgMode &mode, XYMode &xyMode, ushort
       value = parse.getValue(vlen);
     }
     else {
-      std::string label;
+      std::string_view label;
 
       if (parse.readLabel(label)) {
-        ushort lvalue;
-        uchar  llen;
-
-        if (! getLabel(label, lvalue, llen))
-          ++numBadLabels_;
-
-        value = lvalue;
-        vlen  = llen;
+        lookupLabel(label, value, vlen);
       }
     }
 
@@ -2429,8 +4423,7 @@ decodeAssembleArg(const std::string &arg, ArgMode &mode, XYMode &xyMode, ushort
   else {
     mode = ArgMode::MEMORY;
 
-    if (! getLabel(arg, value, vlen))
-      ++numBadLabels_;
+    lookupLabel(arg, value, vlen);
   }
 
   return true;
@@ -2441,22 +4434,30 @@ C6502::
 clearLabels()
 {
   labels_.clear();
+
+  fixups_.clear();
 }
 
 void
 C6502::
-setLabel(const std::string &name, ushort addr, uchar len)
+setLabel(std::string_view name, ushort addr, uchar len)
 {
   if (isDebug()) {
     std::cerr << "setLabel '" << name << "' " << std::hex << int(addr) << "\n";
   }
 
-  labels_[name] = AddrLen(addr, len);
+  // name only copied for new label
+  auto p = labels_.find(name);
+
+  if (p != labels_.end())
+    (*p).second = AddrLen(addr, len);
+  else
+    labels_.emplace(std::string(name), AddrLen(addr, len));
 }
 
 bool
 C6502::
-getLabel(const std::string &name, ushort &value, uchar &len) const
+getLabel(std::string_view name, ushort &value, uchar &len) const
 {
   value = 0;
 
@@ -2473,6 +4474,75 @@ getLabel(const std::string &name, ushort &value, uchar &len) const
   return true;
 }
 
+// get label value for operand (unresolved label is assumed to be a word address
+// and recorded for fixup)
+bool
+C6502::
+lookupLabel(std::string_view name, ushort &value, uchar &len)
+{
+  if (getLabel(name, value, len))
+    return true;
+
+  value = 0;
+  len   = 4;
+
+  fixupLabel_ = name;
+
+  return false;
+}
+
+// add fixup for unresolved label (if any) at operand address
+void
+C6502::
+addFixup(ushort addr, FixupKind kind)
+{
+  if (fixupLabel_ == "")
+    return;
+
+  Fixup fixup;
+
+  fixup.addr  = addr;
+  fixup.kind  = kind;
+  fixup.label = fixupLabel_;
+
+  fixups_.push_back(fixup);
+
+  fixupLabel_ = "";
+}
+
+// patch operands with forward referenced labels (undefined label left as zero)
+void
+C6502::
+applyFixups()
+{
+  for (const auto &fixup : fixups_) {
+    ushort value;
+    uchar  len;
+
+    if (! getLabel(fixup.label, value, len)) {
+      if (isDebug())
+        std::cerr << "Undefined label '" << fixup.label << "'\n";
+
+      continue;
+    }
+
+    switch (fixup.kind) {
+      case FixupKind::BYTE:
+        setByte(fixup.addr, uchar(value & 0xFF));
+        break;
+      case FixupKind::WORD:
+        setByte(fixup.addr    , uchar( value & 0x00FF      ));
+        setByte(fixup.addr + 1, uchar((value & 0xFF00) >> 8));
+        break;
+      case FixupKind::RELATIVE:
+        setByte(fixup.addr, uchar(schar(int(value) - int(fixup.addr) - 1)));
+        break;
+    }
+  }
+
+  fixups_.clear();
+}
+
 //---
 
 bool
@@ -2828,6 +4898,62 @@ disassembleAddr(ushort &addr, std::ostream &os) const
                         case 0xEB:                    case 0xEF:
               case 0xF2:case 0xF3:case 0xF4:case 0xF7:
               case 0xFA:case 0xFB:case 0xFC:          case 0xFF: {
+      // 65C02 instructions and NOPs
+      if (variant_ == Variant::CMOS) {
+        auto outputZeroPageIndirect = [&]() { os << "("; outputZeroPage(); os << ")"; };
+
+        switch (c) {
+          case 0x12: { os << "ORA "; outputZeroPageIndirect(); os << "\n"; break; }
+          case 0x32: { os << "AND "; outputZeroPageIndirect(); os << "\n"; break; }
+          case 0x52: { os << "EOR "; outputZeroPageIndirect(); os << "\n"; break; }
+          case 0x72: { os << "ADC "; outputZeroPageIndirect(); os << "\n"; break; }
+          case 0x92: { os << "STA "; outputZeroPageIndirect(); os << "\n"; break; }
+          case 0xB2: { os << "LDA "; outputZeroPageIndirect(); os << "\n"; break; }
+          case 0xD2: { os << "CMP "; outputZeroPageIndirect(); os << "\n"; break; }
+          case 0xF2: { os << "SBC "; outputZeroPageIndirect(); os << "\n"; break; }
+
+          case 0x34: { os << "BIT "; outputZeroPageX(); os << "\n"; break; }
+          case 0x3C: { os << "BIT "; outputAbsoluteX(); os << "\n"; break; }
+          case 0x89: { os << "BIT "; outputImmediate(); os << "\n"; break; }
+
+          case 0x04: { os << "TSB "; outputZeroPage(); os << "\n"; break; }
+          case 0x0C: { os << "TSB "; outputAbsolute(); os << "\n"; break; }
+          case 0x14: { os << "TRB "; outputZeroPage(); os << "\n"; break; }
+          case 0x1C: { os << "TRB "; outputAbsolute(); os << "\n"; break; }
+
+          case 0x64: { os << "STZ "; outputZeroPage (); os << "\n"; break; }
+          case 0x74: { os << "STZ "; outputZeroPageX(); os << "\n"; break; }
+          case 0x9C: { os << "STZ "; outputAbsolute (); os << "\n"; break; }
+          case 0x9E: { os << "STZ "; outputAbsoluteX(); os << "\n"; break; }
+
+          case 0x1A: { os << "INC A\n"; break; }
+          case 0x3A: { os << "DEC A\n"; break; }
+
+          case 0x5A: { os << "PHY\n"; break; }
+          case 0x7A: { os << "PLY\n"; break; }
+          case 0xDA: { os << "PHX\n"; break; }
+          case 0xFA: { os << "PLX\n"; break; }
+
+          case 0x80: { os << "BRA "; outputRelative(); os << "\n"; break; }
+
+          case 0x7C: { os << "JMP ("; outputAbsolute(); os << ",X)\n"; break; }
+
+          case 0x02: case 0x22: case 0x42: case 0x62: case 0x82: case 0xC2: case 0xE2:
+            os << "NOP "; outputImmediate(); os << "\n"; break;
+          case 0x44:
+            os << "NOP "; outputZeroPage(); os << "\n"; break;
+          case 0x54: case 0xD4: case 0xF4:
+            os << "NOP "; outputZeroPageX(); os << "\n"; break;
+          case 0x5C: case 0xDC: case 0xFC:
+            os << "NOP "; outputAbsolute(); os << "\n"; break;
+
+          default:
+            os << "NOP\n"; break;
+        }
+
+        break;
+      }
+
       if (isUnsupported()) {
         switch (c) {
           // KIL
@@ -2851,30 +4977,41 @@ disassembleAddr(ushort &addr, std::ostream &os) const
             os << "NOP ", outputImmediate(); os << "\n"; break;
             break;
 
-          // SLO
+          // SLO, RLA, SRE, RRA, DCP, ISC (read/modify/write group)
           case 0x03: case 0x07: case 0x0F:
           case 0x13: case 0x17: case 0x1B: case 0x1F:
-            os << "SLO\n";
-            break;
-          // RLA
           case 0x23: case 0x27: case 0x2F:
           case 0x33: case 0x37: case 0x3B: case 0x3F:
-            os << "RLA\n";
-            break;
-          // SRE
           case 0x43: case 0x47: case 0x4F:
           case 0x53: case 0x57: case 0x5B: case 0x5F:
-            os << "SRE\n";
-            break;
-          // RRA
           case 0x63: case 0x67: case 0x6F:
           case 0x73: case 0x77: case 0x7B: case 0x7F:
-            os << "RRA\n";
-            break;
+          case 0xC3: case 0xC7: case 0xCF:
+          case 0xD3: case 0xD7: case 0xDB: case 0xDF:
+          case 0xE3: case 0xE7: case 0xEF:
+          case 0xF3: case 0xF7: case 0xFB: case 0xFF: {
+            static const char *names[8] = { "SLO", "RLA", "SRE", "RRA", "", "", "DCP", "ISC" };
+
+            os << names[c >> 5] << " ";
+
+            switch (c & 0x1F) {
+              case 0x03: outputIndirectX(); break;
+              case 0x07: outputZeroPage (); break;
+              case 0x0F: outputAbsolute (); break;
+              case 0x13: outputIndirectY(); break;
+              case 0x17: outputZeroPageX(); break;
+              case 0x1B: outputAbsoluteY(); break;
+              default  : outputAbsoluteX(); break;
+            }
+
+            os << "\n"; break;
+          }
+
           // SAX
-          case 0x83: case 0x87: case 0x8F: case 0x97:
-            os << "SAX\n";
-            break;
+          case 0x83: { os << "SAX "; outputIndirectX(); os << "\n"; break; }
+          case 0x87: { os << "SAX "; outputZeroPage (); os << "\n"; break; }
+          case 0x8F: { os << "SAX "; outputAbsolute (); os << "\n"; break; }
+          case 0x97: { os << "SAX "; outputZeroPageY(); os << "\n"; break; }
 
           // LAX
           case 0xA3: { os << "LAX "; outputIndirectX(); os << "\n"; break; }
@@ -2885,60 +5022,24 @@ disassembleAddr(ushort &addr, std::ostream &os) const
           case 0xB7: { os << "LAX "; outputZeroPageY(); os << "\n"; break; }
           case 0xBF: { os << "LAX "; outputAbsoluteY(); os << "\n"; break; }
 
-          // DCP
-          case 0xC3: case 0xC7: case 0xCF:
-          case 0xD3: case 0xD7: case 0xDB: case 0xDF:
-            os << "DCP\n";
-            break;
-          // ISC
-          case 0xE3: case 0xE7: case 0xEF:
-          case 0xF3: case 0xF7: case 0xFB: case 0xFF:
-            os << "ISC\n";
-            break;
-          // ANC
-          case 0x0B: case 0x2B:
-            os << "ANC\n";
-            break;
-          // ALR
-          case 0x4B:
-            os << "ALR\n";
-            break;
-          // ARR
-          case 0x6B:
-            os << "ARR\n";
-            break;
-          // XAA
-          case 0x8B:
-            os << "XAA\n";
-            break;
-          // AXS
-          case 0xCB:
-            os << "AXS\n";
-            break;
-          // SBC
-          case 0xEB:
-            os << "SBC\n";
-            break;
-          // AHX
-          case 0x93: case 0x9F:
-            os << "AHX\n";
-            break;
-          // SHY
-          case 0x9C:
-            os << "SHY\n";
-            break;
-          // SHX
-          case 0x9E:
-            os << "SHX\n";
-            break;
-          // TAS
-          case 0x9B:
-            os << "TAS\n";
-            break;
+          // immediate
+          case 0x0B: case 0x2B: { os << "ANC "; outputImmediate(); os << "\n"; break; }
+          case 0x4B: { os << "ALR "; outputImmediate(); os << "\n"; break; }
+          case 0x6B: { os << "ARR "; outputImmediate(); os << "\n"; break; }
+          case 0x8B: { os << "XAA "; outputImmediate(); os << "\n"; break; }
+          case 0xCB: { os << "AXS "; outputImmediate(); os << "\n"; break; }
+          case 0xEB: { os << "SBC "; outputImmediate(); os << "\n"; break; }
+
+          // store high byte
+          case 0x93: { os << "AHX "; outputIndirectY(); os << "\n"; break; }
+          case 0x9F: { os << "AHX "; outputAbsoluteY(); os << "\n"; break; }
+          case 0x9C: { os << "SHY "; outputAbsoluteX(); os << "\n"; break; }
+          case 0x9E: { os << "SHX "; outputAbsoluteY(); os << "\n"; break; }
+          case 0x9B: { os << "TAS "; outputAbsoluteY(); os << "\n"; break; }
+
           // LAS
-          case 0xBB:
-            os << "LAS\n";
-            break;
+          case 0xBB: { os << "LAS "; outputAbsoluteY(); os << "\n"; break; }
+
           default:
             assert(false);
             break;
@@ -0,0 +1,669 @@
+#include <C6502Analyze.h>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace {
+
+using uchar = C6502::uchar;
+using ulong = C6502::ulong;
+
+// NMOS cycles (0 is KIL)
+const uchar nmosCycles[256] = {
+/*        0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F */
+/* 0 */   7, 6, 0, 8, 3, 3, 5, 5, 3, 2, 2, 2, 4, 4, 6, 6,
+/* 1 */   2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* 2 */   6, 6, 0, 8, 3, 3, 5, 5, 4, 2, 2, 2, 4, 4, 6, 6,
+/* 3 */   2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* 4 */   6, 6, 0, 8, 3, 3, 5, 5, 3, 2, 2, 2, 3, 4, 6, 6,
+/* 5 */   2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* 6 */   6, 6, 0, 8, 3, 3, 5, 5, 4, 2, 2, 2, 5, 4, 6, 6,
+/* 7 */   2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* 8 */   2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4,
+/* 9 */   2, 6, 0, 6, 4, 4, 4, 4, 2, 5, 2, 5, 5, 5, 5, 5,
+/* A */   2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4,
+/* B */   2, 5, 0, 5, 4, 4, 4, 4, 2, 4, 2, 4, 4, 4, 4, 4,
+/* C */   2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6,
+/* D */   2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* E */   2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6,
+/* F */   2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+};
+
+enum class Mode { IMP, IMM, ZP, ZPX, ZPY, ABS, ABX, ABY, IND, IZX, IZY, REL, ZPI, AIX };
+
+// NMOS addressing mode (from opcode row/column)
+Mode nmosMode(uchar c) {
+  bool odd = (c & 0x10);
+
+  switch (c & 0x0F) {
+    case 0x0:
+      if (odd) return Mode::REL;
+      if (c == 0x20) return Mode::ABS;
+      return (c >= 0x80 ? Mode::IMM : Mode::IMP);
+    case 0x1: case 0x3:
+      return (odd ? Mode::IZY : Mode::IZX);
+    case 0x2:
+      return (! odd && c >= 0x80 ? Mode::IMM : Mode::IMP);
+    case 0x4: case 0x5: case 0x6: case 0x7:
+      if (! odd) return Mode::ZP;
+      return ((c == 0x96 || c == 0x97 || c == 0xB6 || c == 0xB7) ? Mode::ZPY : Mode::ZPX);
+    case 0x8: case 0xA:
+      return Mode::IMP;
+    case 0x9: case 0xB:
+      return (odd ? Mode::ABY : Mode::IMM);
+    default:
+      if (! odd) return (c == 0x6C ? Mode::IND : Mode::ABS);
+      return ((c == 0x9E || c == 0x9F || c == 0xBE || c == 0xBF) ? Mode::ABY : Mode::ABX);
+  }
+}
+
+// documented NMOS opcode
+bool isDocumented(uchar c) {
+  bool odd = (c & 0x10);
+
+  switch (c & 0x0F) {
+    case 0x3: case 0x7: case 0xB: case 0xF: return false;
+    case 0x0: return (c != 0x80);
+    case 0x2: return (c == 0xA2);
+    case 0x4: return (odd ? (c == 0x94 || c == 0xB4) : (c != 0x04 && c != 0x44 && c != 0x64));
+    case 0x9: return (c != 0x89);
+    case 0xA: return (! odd || c == 0x9A || c == 0xBA);
+    case 0xC: return (odd ? (c == 0xBC) : (c != 0x0C));
+    case 0xE: return (c != 0x9E);
+    default : return true;
+  }
+}
+
+// 65C02 instructions and NOPs (replacing NMOS undocumented) and changed timings
+bool cmosInst(uchar c, Mode &mode, uint &cycles) {
+  switch (c) {
+    case 0x12: case 0x32: case 0x52: case 0x72: case 0x92: case 0xB2: case 0xD2: case 0xF2:
+      mode = Mode::ZPI; cycles = 5; return true;
+
+    case 0x34: mode = Mode::ZPX; cycles = 4; return true; // BIT zero page,X
+    case 0x3C: mode = Mode::ABX; cycles = 4; return true; // BIT absolute,X
+    case 0x89: mode = Mode::IMM; cycles = 2; return true; // BIT immediate
+
+    case 0x04: case 0x14: mode = Mode::ZP ; cycles = 5; return true; // TSB/TRB
+    case 0x0C: case 0x1C: mode = Mode::ABS; cycles = 6; return true;
+
+    case 0x64: mode = Mode::ZP ; cycles = 3; return true; // STZ
+    case 0x74: mode = Mode::ZPX; cycles = 4; return true;
+    case 0x9C: mode = Mode::ABS; cycles = 4; return true;
+    case 0x9E: mode = Mode::ABX; cycles = 5; return true;
+
+    case 0x1A: case 0x3A: mode = Mode::IMP; cycles = 2; return true; // INC/DEC A
+    case 0x5A: case 0xDA: mode = Mode::IMP; cycles = 3; return true; // PHY/PHX
+    case 0x7A: case 0xFA: mode = Mode::IMP; cycles = 4; return true; // PLY/PLX
+
+    case 0x80: mode = Mode::REL; cycles = 3; return true; // BRA
+    case 0x7C: mode = Mode::AIX; cycles = 6; return true; // JMP (absolute,X)
+    case 0x6C: mode = Mode::IND; cycles = 6; return true; // JMP (indirect)
+
+    case 0x1E: case 0x3E: case 0x5E: case 0x7E: // shift absolute,X (page cross)
+      mode = Mode::ABX; cycles = 6; return true;
+
+    // NOPs
+    case 0x02: case 0x22: case 0x42: case 0x62: case 0x82: case 0xC2: case 0xE2:
+      mode = Mode::IMM; cycles = 2; return true;
+    case 0x44:
+      mode = Mode::ZP ; cycles = 3; return true;
+    case 0x54: case 0xD4: case 0xF4:
+      mode = Mode::ZPX; cycles = 4; return true;
+    case 0x5C:
+      mode = Mode::ABS; cycles = 8; return true;
+    case 0xDC: case 0xFC:
+      mode = Mode::ABS; cycles = 4; return true;
+
+    default:
+      if (isDocumented(c)) return false;
+
+      // single byte
+      mode = Mode::IMP; cycles = 1; return true;
+  }
+}
+
+uchar modeLen(Mode mode) {
+  switch (mode) {
+    case Mode::IMP:
+      return 1;
+    case Mode::ABS: case Mode::ABX: case Mode::ABY: case Mode::IND: case Mode::AIX:
+      return 3;
+    default:
+      return 2;
+  }
+}
+
+const ulong maxULong = std::numeric_limits<ulong>::max();
+
+}
+
+//---
+
+C6502Analyze::
+C6502Analyze(const C6502 *cpu) :
+ cpu_(cpu)
+{
+}
+
+void
+C6502Analyze::
+addEntry(ushort addr, const std::string &name)
+{
+  entries_[addr] = name;
+}
+
+void
+C6502Analyze::
+analyze()
+{
+  routines_.clear();
+
+  findLeaders();
+
+  buildBlocks();
+
+  // subroutines are entries and JSR targets
+  auto addRoutine = [&](ushort addr, const std::string &name) {
+    if (routines_.find(addr) != routines_.end())
+      return;
+
+    Routine &routine = routines_[addr];
+
+    routine.name = (name != "" ? name : labelName(addr));
+    routine.addr = addr;
+  };
+
+  for (const auto &entry : entries_)
+    addRoutine(entry.first, entry.second);
+
+  for (const auto &addr : calls_)
+    addRoutine(addr, "");
+
+  for (auto &routine : routines_)
+    analyzeRoutine(routine.second);
+}
+
+bool
+C6502Analyze::
+decode(ushort addr, Inst &inst) const
+{
+  inst = Inst();
+
+  uchar c = cpu_->getByte(addr);
+
+  auto variant = cpu_->variant();
+
+  Mode mode;
+  uint cycles;
+
+  if (variant != C6502::Variant::CMOS || ! cmosInst(c, mode, cycles)) {
+    mode   = nmosMode(c);
+    cycles = nmosCycles[c];
+
+    // undocumented stops unless enabled, KIL halts
+    if ((! isDocumented(c) && ! cpu_->isUnsupported()) || cycles == 0) {
+      inst.flow = Flow::STOP;
+      return false;
+    }
+  }
+
+  inst.len    = modeLen(mode);
+  inst.cycles = uchar(cycles);
+
+  ushort operand = (inst.len == 3 ? cpu_->getWord(ushort(addr + 1)) :
+                    inst.len == 2 ? cpu_->getByte(ushort(addr + 1)) : 0);
+
+  // page cross possible for indexed read (index $FF crosses unless base low byte is zero)
+  bool readX = ((mode == Mode::ABX || mode == Mode::ABY) && cycles == 4);
+  bool rmwX  = (variant == C6502::Variant::CMOS && mode == Mode::ABX && cycles == 6);
+
+  if      (readX || rmwX)
+    inst.extraCycles = ((operand & 0xFF) != 0 ? 1 : 0);
+  else if (mode == Mode::IZY && cycles == 5)
+    inst.extraCycles = 1;
+
+  // 65C02 decimal mode ADC/SBC
+  if (variant == C6502::Variant::CMOS && (c & 0x60) == 0x60 &&
+      ((c & 0x03) == 0x01 || mode == Mode::ZPI))
+    ++inst.extraCycles;
+
+  //---
+
+  ushort next = ushort(addr + inst.len);
+
+  if      (c == 0x00) {
+    inst.flow = Flow::STOP;
+  }
+  else if (c == 0x20) {
+    // host trap (e.g. OUT) is not followed, its inline operand is skipped
+    if (cpu_->isTrap(operand)) {
+      inst.len = uchar(inst.len + cpu_->trapInlineLen(operand));
+      return true;
+    }
+
+    inst.flow   = Flow::CALL;
+    inst.target = operand;
+  }
+  else if (c == 0x40 || c == 0x60) {
+    inst.flow = Flow::RETURN;
+  }
+  else if (c == 0x4C) {
+    inst.flow   = Flow::JUMP;
+    inst.target = operand;
+  }
+  else if (mode == Mode::IND || mode == Mode::AIX) {
+    inst.flow = Flow::JUMP_IND;
+  }
+  else if (mode == Mode::REL) {
+    inst.target = ushort(next + int(C6502::schar(operand)));
+
+    uchar cross = ((next >> 8) != (inst.target >> 8) ? 1 : 0);
+
+    // BRA always taken
+    if (c == 0x80) {
+      inst.flow    = Flow::JUMP;
+      inst.cycles += cross;
+    }
+    else {
+      inst.flow        = Flow::BRANCH;
+      inst.takenCycles = uchar(1 + cross);
+    }
+  }
+
+  return true;
+}
+
+bool
+C6502Analyze::
+instCycles(ushort addr, uint &len, uint &cycles, uint &takenCycles) const
+{
+  Inst inst;
+
+  bool rc = decode(addr, inst);
+
+  len         = inst.len;
+  cycles      = inst.cycles;
+  takenCycles = inst.takenCycles;
+
+  return rc;
+}
+
+void
+C6502Analyze::
+findLeaders()
+{
+  leaders_.assign(0x10000, false);
+
+  calls_.clear();
+
+  std::vector<ushort> todo;
+
+  auto addLeader = [&](ushort addr) {
+    if (leaders_[addr]) return;
+
+    leaders_[addr] = true;
+
+    todo.push_back(addr);
+  };
+
+  for (const auto &entry : entries_)
+    addLeader(entry.first);
+
+  // interrupt vectors with labelled handlers
+  for (ushort vector : { ushort(0xFFFA), ushort(0xFFFE) }) {
+    ushort addr = cpu_->getWord(vector);
+
+    if (labelName(addr)[0] != '$') {
+      entries_.emplace(addr, "");
+
+      addLeader(addr);
+    }
+  }
+
+  while (! todo.empty()) {
+    ushort addr = todo.back();
+
+    todo.pop_back();
+
+    for (uint i = 0; i < 0x10000; ++i) {
+      Inst inst;
+
+      decode(addr, inst);
+
+      ushort next = ushort(addr + inst.len);
+
+      if (inst.flow == Flow::BRANCH) {
+        addLeader(inst.target);
+        addLeader(next);
+        break;
+      }
+
+      if (inst.flow == Flow::CALL) {
+        calls_.insert(inst.target);
+
+        addLeader(inst.target);
+        addLeader(next);
+        break;
+      }
+
+      if (inst.flow == Flow::JUMP) {
+        addLeader(inst.target);
+        break;
+      }
+
+      if (inst.flow != Flow::NEXT || leaders_[next])
+        break;
+
+      addr = next;
+    }
+  }
+}
+
+void
+C6502Analyze::
+buildBlocks()
+{
+  blocks_.clear();
+
+  for (uint addr1 = 0; addr1 < 0x10000; ++addr1) {
+    if (! leaders_[addr1])
+      continue;
+
+    Block block;
+
+    block.start = ushort(addr1);
+
+    ushort addr = block.start;
+
+    for (uint i = 0; i < 0x10000; ++i) {
+      Inst inst;
+
+      decode(addr, inst);
+
+      block.minCycles += inst.cycles;
+      block.maxCycles += inst.cycles + inst.extraCycles;
+
+      addr = ushort(addr + inst.len);
+
+      if (inst.flow != Flow::NEXT) {
+        block.flow        = inst.flow;
+        block.target      = inst.target;
+        block.takenCycles = inst.takenCycles;
+        break;
+      }
+
+      if (leaders_[addr])
+        break;
+    }
+
+    block.next = addr;
+
+    blocks_[block.start] = block;
+  }
+}
+
+void
+C6502Analyze::
+blockEdges(const Block &block, Edges &edges) const
+{
+  edges.clear();
+
+  auto addEdge = [&](ushort addr, ulong minCycles, ulong maxCycles) {
+    Edge edge;
+
+    edge.addr      = addr;
+    edge.minCycles = minCycles;
+    edge.maxCycles = maxCycles;
+
+    edges.push_back(edge);
+  };
+
+  switch (block.flow) {
+    case Flow::NEXT:
+      addEdge(block.next, 0, 0);
+      break;
+    case Flow::BRANCH:
+      addEdge(block.next, 0, 0);
+      addEdge(block.target, block.takenCycles, block.takenCycles);
+      break;
+    case Flow::JUMP:
+      addEdge(block.target, 0, 0);
+      break;
+    case Flow::CALL: {
+      // called subroutine cycles (zero while being analyzed, i.e. recursive)
+      const Routine *called = calledRoutine(block);
+
+      if      (! called)
+        addEdge(block.next, 0, 0);
+      else if (! called->noReturn)
+        addEdge(block.next, called->minCycles, called->maxCycles);
+
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+// called subroutine (if analyzed)
+const C6502Analyze::Routine *
+C6502Analyze::
+calledRoutine(const Block &block) const
+{
+  auto p = routines_.find(block.target);
+
+  if (p == routines_.end() || (*p).second.state != Routine::State::DONE)
+    return nullptr;
+
+  return &(*p).second;
+}
+
+void
+C6502Analyze::
+analyzeRoutine(Routine &routine)
+{
+  if (routine.state != Routine::State::NONE)
+    return;
+
+  routine.state = Routine::State::ACTIVE;
+
+  // blocks reachable from entry
+  std::set<ushort> blocks;
+
+  std::vector<ushort> todo { routine.addr };
+
+  Edges edges;
+
+  while (! todo.empty()) {
+    ushort addr = todo.back();
+
+    todo.pop_back();
+
+    if (! blocks.insert(addr).second)
+      continue;
+
+    const Block &block = blocks_[addr];
+
+    // time called subroutines first
+    if (block.flow == Flow::CALL) {
+      Routine &called = routines_[block.target];
+
+      if (called.state == Routine::State::ACTIVE)
+        routine.recursive = true;
+      else
+        analyzeRoutine(called);
+
+      routine.loop      |= called.loop;
+      routine.recursive |= called.recursive;
+      routine.indirect  |= called.indirect;
+    }
+
+    if (block.flow == Flow::JUMP_IND)
+      routine.indirect = true;
+
+    blockEdges(block, edges);
+
+    for (const auto &edge : edges)
+      todo.push_back(edge.addr);
+  }
+
+  routine.numBlocks = uint(blocks.size());
+
+  // worst case
+  std::map<ushort,int>   visit;
+  std::map<ushort,ulong> maxTo;
+
+  routine.maxCycles = maxPath(routine.addr, visit, maxTo, routine);
+
+  // best case (to return or, if none, any exit)
+  if (! minPath(routine.addr, blocks, false, routine.minCycles)) {
+    routine.noReturn = true;
+
+    if (! minPath(routine.addr, blocks, true, routine.minCycles))
+      routine.minCycles = 0;
+  }
+
+  routine.state = Routine::State::DONE;
+}
+
+// longest path from block (back edges, i.e. loops, not followed)
+C6502Analyze::ulong
+C6502Analyze::
+maxPath(ushort addr, std::map<ushort,int> &visit, std::map<ushort,ulong> &maxTo,
+        Routine &routine)
+{
+  int &state = visit[addr];
+
+  if (state == 2)
+    return maxTo[addr];
+
+  if (state == 1) {
+    routine.loop = true;
+    return 0;
+  }
+
+  state = 1;
+
+  const Block &block = blocks_[addr];
+
+  Edges edges;
+
+  blockEdges(block, edges);
+
+  ulong maxCycles = 0;
+
+  for (const auto &edge : edges) {
+    if (visit[edge.addr] == 1) {
+      routine.loop = true;
+      continue;
+    }
+
+    maxCycles = std::max(maxCycles, edge.maxCycles + maxPath(edge.addr, visit, maxTo, routine));
+  }
+
+  visit[addr] = 2;
+
+  // call which does not return ends path
+  if (block.flow == Flow::CALL && edges.empty())
+    maxCycles = calledRoutine(block)->maxCycles;
+
+  ulong cycles = block.maxCycles + maxCycles;
+
+  maxTo[addr] = cycles;
+
+  return cycles;
+}
+
+// shortest path from entry block to exit block (RTS/RTI or any end of code)
+bool
+C6502Analyze::
+minPath(ushort entry, const std::set<ushort> &blocks, bool anyExit, ulong &cycles) const
+{
+  std::map<ushort,ulong> minTo;
+
+  for (const auto &addr : blocks)
+    minTo[addr] = maxULong;
+
+  Edges edges;
+
+  bool changed = true;
+
+  while (changed) {
+    changed = false;
+
+    for (const auto &addr : blocks) {
+      const Block &block = (*blocks_.find(addr)).second;
+
+      ulong minCycles = maxULong;
+
+      if      (block.flow == Flow::RETURN)
+        minCycles = block.minCycles;
+      else if (block.flow == Flow::STOP || block.flow == Flow::JUMP_IND) {
+        if (anyExit)
+          minCycles = block.minCycles;
+      }
+      else {
+        blockEdges(block, edges);
+
+        // call which does not return
+        if (block.flow == Flow::CALL && edges.empty() && anyExit)
+          minCycles = block.minCycles + calledRoutine(block)->minCycles;
+
+        for (const auto &edge : edges) {
+          ulong minCycles1 = minTo[edge.addr];
+
+          if (minCycles1 != maxULong)
+            minCycles = std::min(minCycles, block.minCycles + edge.minCycles + minCycles1);
+        }
+      }
+
+      if (minCycles < minTo[addr]) {
+        minTo[addr] = minCycles;
+        changed     = true;
+      }
+    }
+  }
+
+  cycles = minTo[entry];
+
+  return (cycles != maxULong);
+}
+
+// name of (code) label at address or hex address
+std::string
+C6502Analyze::
+labelName(ushort addr) const
+{
+  // code labels have 4 digit value (defines have value length)
+  for (const auto &label : cpu_->labels()) {
+    if (label.second.addr == addr && label.second.len == 4)
+      return label.first;
+  }
+
+  std::stringstream ss;
+
+  ss << "$" << std::hex << std::setfill('0') << std::setw(4) << addr;
+
+  return ss.str();
+}
+
+void
+C6502Analyze::
+print(std::ostream &os) const
+{
+  for (const auto &p : routines_) {
+    const Routine &routine = p.second;
+
+    os << routine.name << " $" << std::hex << std::setfill('0') << std::setw(4) <<
+          routine.addr << std::dec << ": " << routine.minCycles << "-" <<
+          routine.maxCycles << " cycles, " << routine.numBlocks << " blocks";
+
+    if (routine.loop     ) os << ", loop";
+    if (routine.recursive) os << ", recursive";
+    if (routine.indirect ) os << ", indirect jump";
+    if (routine.noReturn ) os << ", no return";
+
+    os << "\n";
+  }
+}
@@ -0,0 +1,664 @@
+#include <C6502C64.h>
+
+#include <c64_basic.h>
+#include <c64_kernel.h>
+
+#include <cstdio>
+#include <cctype>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+// KERNAL zero page locations
+enum : C6502::ushort {
+  STATUS = 0x90, // I/O status
+  DFLTN  = 0x99, // default input device
+  DFLTO  = 0x9A, // default output device
+  EAL    = 0xAE, // end address of load/save
+  FNLEN  = 0xB7, // filename length
+  SA     = 0xB9, // secondary address
+  FA     = 0xBA, // device number
+  FNADR  = 0xBB, // filename pointer
+  NDX    = 0xC6  // keyboard buffer count
+};
+
+// BASIC pointers
+enum : C6502::ushort {
+  TXTTAB = 0x2B, // start of program
+  VARTAB = 0x2D, // start of variables
+  ARYTAB = 0x2F, // start of arrays
+  STREND = 0x31  // end of arrays
+};
+
+// KERNAL keyboard buffer
+const C6502::ushort KEYD    = 0x0277;
+const C6502::uchar  KEYDLEN = 10;
+
+// KERNAL screen memory page
+const C6502::ushort HIBASE = 0x0288;
+
+// nominal cycle costs of fast paths
+enum {
+  CHAR_CYCLES = 20,
+  FILE_CYCLES = 100
+};
+
+// max cycles for boot to reach READY
+const C6502::ulong bootCycles = 10000000;
+
+// boot snapshots shared by all instances
+struct BootCache {
+  using StateP = std::shared_ptr<C6502::State>;
+  using States = std::map<C6502::ulong, StateP>;
+
+  std::mutex  mutex;
+  std::string dir;
+  States      states;
+};
+
+BootCache &bootCache() {
+  static BootCache cache;
+
+  return cache;
+}
+
+}
+
+C6502C64::
+C6502C64()
+{
+  mapRoms();
+
+  // 6510 runs undocumented opcodes
+  setUnsupported(true);
+
+  // I/O registers (raster, timers) change without writes
+  setVolatile(0xD000, 0x1000);
+
+  setAllFastPaths(true);
+}
+
+void
+C6502C64::
+setFastPath(FastPath fastPath, bool b)
+{
+  uint mask = (1U << uint(fastPath));
+
+  fastPaths_ = (b ? fastPaths_ | mask : fastPaths_ & ~mask);
+
+  installFastPath(fastPath);
+}
+
+void
+C6502C64::
+setAllFastPaths(bool b)
+{
+  setFastPath(FastPath::CHROUT, b);
+  setFastPath(FastPath::CHRIN , b);
+  setFastPath(FastPath::GETIN , b);
+  setFastPath(FastPath::LOAD  , b);
+  setFastPath(FastPath::SAVE  , b);
+}
+
+void
+C6502C64::
+installFastPath(FastPath fastPath)
+{
+  auto addTrapOrRemove = [&](ushort addr, const TrapProc &proc) {
+    if (isFastPath(fastPath))
+      addTrap(addr, proc);
+    else
+      removeTrap(addr); // real ROM code runs
+  };
+
+  auto c64 = [](C6502 &cpu) -> C6502C64 & { return static_cast<C6502C64 &>(cpu); };
+
+  switch (fastPath) {
+    case FastPath::CHROUT:
+      addTrapOrRemove(CHROUT_ADDR, [c64](C6502 &cpu) { return c64(cpu).chroutTrap(); }); break;
+    case FastPath::CHRIN:
+      addTrapOrRemove(CHRIN_ADDR , [c64](C6502 &cpu) { return c64(cpu).chrinTrap (); }); break;
+    case FastPath::GETIN:
+      addTrapOrRemove(GETIN_ADDR , [c64](C6502 &cpu) { return c64(cpu).getinTrap (); }); break;
+    case FastPath::LOAD:
+      addTrapOrRemove(LOAD_ADDR  , [c64](C6502 &cpu) { return c64(cpu).loadTrap  (); }); break;
+    case FastPath::SAVE:
+      addTrapOrRemove(SAVE_ADDR  , [c64](C6502 &cpu) { return c64(cpu).saveTrap  (); }); break;
+  }
+}
+
+void
+C6502C64::
+mapRoms()
+{
+  C6502::memset(0xA000, c64_basic_data , 0x2000);
+  C6502::memset(0xE000, c64_kernel_data, 0x2000);
+}
+
+void
+C6502C64::
+resetC64()
+{
+  reset();
+
+  clearMemory();
+
+  mapRoms();
+
+  // processor port (all ROMs and I/O visible)
+  C6502::setByte(0x0000, 0x2F);
+  C6502::setByte(0x0001, 0x37);
+
+  input_.clear();
+
+  setHalt(false);
+
+  setIFlag(true);
+
+  resetSystem();
+}
+
+bool
+C6502C64::
+bootBasic()
+{
+  auto &cache = bootCache();
+
+  ulong hash = romHash();
+
+  std::string filename;
+
+  {
+  std::unique_lock<std::mutex> lock(cache.mutex);
+
+  // in memory
+  auto p = cache.states.find(hash);
+
+  if (p != cache.states.end()) {
+    restoreState(*(*p).second);
+    return true;
+  }
+
+  // in file
+  if (cache.dir != "") {
+    char hstr[17];
+
+    snprintf(hstr, sizeof(hstr), "%016lx", hash);
+
+    filename = cache.dir + "/c64boot_" + hstr + ".state";
+
+    if (loadState(filename)) {
+      auto state = std::make_shared<State>();
+
+      saveState(*state);
+
+      cache.states[hash] = state;
+
+      return true;
+    }
+  }
+  }
+
+  //---
+
+  // boot from reset vector without fast paths so state does not depend on them.
+  // Stop at first BASIC input line JSR CHRIN so restored state can use CHRIN fast path
+  uint fastPaths = fastPaths_;
+
+  setAllFastPaths(false);
+
+  resetC64();
+
+  while (PC() != READY_ADDR && t() < bootCycles)
+    step();
+
+  for (uint i = 0; i <= uint(FastPath::SAVE); ++i)
+    setFastPath(FastPath(i), fastPaths & (1U << i));
+
+  if (PC() != READY_ADDR)
+    return false;
+
+  //---
+
+  auto state = std::make_shared<State>();
+
+  saveState(*state);
+
+  std::unique_lock<std::mutex> lock(cache.mutex);
+
+  cache.states[hash] = state;
+
+  if (filename != "")
+    (void) C6502::saveState(filename);
+
+  return true;
+}
+
+const std::string &
+C6502C64::
+bootCacheDir()
+{
+  return bootCache().dir;
+}
+
+void
+C6502C64::
+setBootCacheDir(const std::string &dir)
+{
+  auto &cache = bootCache();
+
+  std::unique_lock<std::mutex> lock(cache.mutex);
+
+  cache.dir = dir;
+}
+
+void
+C6502C64::
+clearBootCache()
+{
+  auto &cache = bootCache();
+
+  std::unique_lock<std::mutex> lock(cache.mutex);
+
+  cache.states.clear();
+}
+
+// FNV-1a hash of ROM images
+C6502::ulong
+C6502C64::
+romHash()
+{
+  static ulong hash = []() {
+    uint64_t h = 14695981039346656037ULL;
+
+    auto add = [&](const uchar *data, uint len) {
+      for (uint i = 0; i < len; ++i) {
+        h ^= data[i];
+        h *= 1099511628211ULL;
+      }
+    };
+
+    add(c64_basic_data , 0x2000);
+    add(c64_kernel_data, 0x2000);
+
+    return ulong(h);
+  }();
+
+  return hash;
+}
+
+bool
+C6502C64::
+isReadOnly(ushort pos, ushort len) const
+{
+  uint end = uint(pos) + len;
+
+  for (uint addr = pos; addr < end && addr < 0x10000; ++addr)
+    if (isRom(ushort(addr)))
+      return true;
+
+  return false;
+}
+
+bool
+C6502C64::
+injectPrg(const std::string &filename, bool run)
+{
+  FILE *fp = fopen(filename.c_str(), "rb");
+  if (! fp) return false;
+
+  std::vector<uchar> data;
+
+  int c;
+
+  while ((c = fgetc(fp)) != EOF && data.size() < 0x10002)
+    data.push_back(uchar(c));
+
+  fclose(fp);
+
+  return injectPrg(data.data(), uint(data.size()), run);
+}
+
+bool
+C6502C64::
+injectPrg(const uchar *data, uint len, bool run)
+{
+  if (len < 2)
+    return false;
+
+  ushort addr = ushort(data[0] | (data[1] << 8));
+
+  uint dlen = std::min(len - 2, 0x10000U - addr);
+
+  for (uint i = 0; i < dlen; ++i)
+    setByte(ushort(addr + i), data[i + 2]);
+
+  ushort end = ushort(addr + dlen);
+
+  // BASIC program : set end of program and rechain lines (as LOAD and LINKPRG)
+  if (addr == getWord(TXTTAB)) {
+    setWord(VARTAB, end);
+    setWord(ARYTAB, end);
+    setWord(STREND, end);
+
+    linkBasicLines();
+  }
+
+  setWord(EAL, end);
+
+  if (run)
+    return typeKeys("RUN\n");
+
+  return true;
+}
+
+// recalculate BASIC line links from start of program
+void
+C6502C64::
+linkBasicLines()
+{
+  ushort addr = getWord(TXTTAB);
+  ushort end  = getWord(VARTAB);
+
+  // line : link (2), line number (2), tokenized text, 0
+  while (addr < end && getWord(addr) != 0) {
+    ushort next = ushort(addr + 4);
+
+    while (next < end && getByte(next) != 0)
+      ++next;
+
+    ++next;
+
+    setWord(addr, next);
+
+    addr = next;
+  }
+}
+
+bool
+C6502C64::
+typeKeys(const std::string &str)
+{
+  uchar n = getByte(NDX);
+
+  for (const auto &c : str) {
+    if (n >= KEYDLEN)
+      return false;
+
+    setByte(ushort(KEYD + n), asciiToPetscii(c));
+
+    ++n;
+
+    setByte(NDX, n);
+  }
+
+  return true;
+}
+
+void
+C6502C64::
+addInput(const std::string &str)
+{
+  for (const auto &c : str)
+    input_.push_back(asciiToPetscii(c));
+}
+
+//---
+
+// CHROUT : output char in A to current output device (only screen handled)
+int
+C6502C64::
+chroutTrap()
+{
+  if (getByte(DFLTO) != 3)
+    return -1;
+
+  char c = petsciiToAscii(A());
+
+  if (c)
+    output().putChar(c);
+
+  // screen renderer attached so real ROM routine also updates screen memory and cursor
+  if (hasDevice(ushort(getByte(HIBASE) << 8)))
+    return -1;
+
+  setCFlag(false);
+
+  return CHAR_CYCLES;
+}
+
+// CHRIN : input char from current input device (only keyboard handled)
+int
+C6502C64::
+chrinTrap()
+{
+  // no host input so use real ROM (keyboard buffer)
+  if (getByte(DFLTN) != 0 || input_.empty())
+    return -1;
+
+  setA(input_.front()); input_.pop_front();
+
+  setCFlag(false);
+
+  return CHAR_CYCLES;
+}
+
+// GETIN : get char from keyboard (0 if none)
+int
+C6502C64::
+getinTrap()
+{
+  if (getByte(DFLTN) != 0 || input_.empty())
+    return -1;
+
+  setA(input_.front()); input_.pop_front();
+
+  setNZFlags(A());
+
+  setCFlag(false);
+
+  return CHAR_CYCLES;
+}
+
+// LOAD : A = 0 load, 1 verify; X/Y load address (used if secondary address is 0)
+int
+C6502C64::
+loadTrap()
+{
+  // keyboard, screen not valid
+  uchar device = getByte(FA);
+
+  if (device == 0 || device == 3)
+    return -1;
+
+  auto fail = [&](uchar err) {
+    setA(err); setCFlag(true); return FILE_CYCLES;
+  };
+
+  std::string name = fileName();
+
+  if (name == "")
+    return fail(8); // missing filename
+
+  std::string path = hostPath(name, /*exists*/true);
+
+  FILE *fp = (path != "" ? fopen(path.c_str(), "rb") : nullptr);
+
+  if (! fp)
+    return fail(4); // file not found
+
+  int lo = fgetc(fp);
+  int hi = fgetc(fp);
+
+  if (lo == EOF || hi == EOF) {
+    fclose(fp);
+    return fail(4);
+  }
+
+  bool verify = (A() != 0);
+
+  ushort addr = (getByte(SA) == 0 ? ushort(X() | (Y() << 8)) : ushort(lo | (hi << 8)));
+
+  uchar status = 0x40; // EOF
+
+  int c;
+
+  while ((c = fgetc(fp)) != EOF) {
+    if (verify) {
+      if (getByte(addr) != uchar(c))
+        status |= 0x10; // verify error
+    }
+    else
+      setByte(addr, uchar(c));
+
+    if (addr == 0xFFFF)
+      break;
+
+    ++addr;
+  }
+
+  fclose(fp);
+
+  C6502::setByte(STATUS, status);
+
+  setWord(EAL, addr);
+
+  setX(uchar(addr & 0xFF));
+  setY(uchar(addr >> 8));
+
+  setCFlag(false);
+
+  return FILE_CYCLES;
+}
+
+// SAVE : A = zero page address of start pointer; X/Y end address (exclusive)
+int
+C6502C64::
+saveTrap()
+{
+  uchar device = getByte(FA);
+
+  if (device == 0 || device == 3)
+    return -1;
+
+  auto fail = [&](uchar err) {
+    setA(err); setCFlag(true); return FILE_CYCLES;
+  };
+
+  std::string name = fileName();
+
+  if (name == "")
+    return fail(8); // missing filename
+
+  ushort start = getWord(A());
+  ushort end   = ushort(X() | (Y() << 8));
+
+  std::string path = hostPath(name, /*exists*/false);
+
+  FILE *fp = fopen(path.c_str(), "wb");
+
+  if (! fp)
+    return fail(5); // device not present
+
+  fputc(start & 0xFF, fp);
+  fputc(start >> 8  , fp);
+
+  for (uint addr = start; addr < end; ++addr)
+    fputc(getByte(ushort(addr)), fp);
+
+  fclose(fp);
+
+  C6502::setByte(STATUS, 0x00);
+
+  setCFlag(false);
+
+  return FILE_CYCLES;
+}
+
+// filename set by SETNAM (as ASCII)
+std::string
+C6502C64::
+fileName() const
+{
+  std::string name;
+
+  uchar  len  = getByte(FNLEN);
+  ushort addr = getWord(FNADR);
+
+  for (uchar i = 0; i < len; ++i) {
+    char c = petsciiToAscii(getByte(ushort(addr + i)));
+
+    if (c)
+      name += c;
+  }
+
+  return name;
+}
+
+// path in host directory for C64 filename (try as is, lower case and with .prg suffix)
+std::string
+C6502C64::
+hostPath(const std::string &name, bool exists) const
+{
+  std::string lname = name;
+
+  for (auto &c : lname)
+    c = char(std::tolower(c));
+
+  std::string dir = hostDir_ + "/";
+
+  if (! exists)
+    return dir + lname + (lname.find('.') == std::string::npos ? ".prg" : "");
+
+  auto fileExists = [](const std::string &path) {
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (! fp) return false;
+    fclose(fp);
+    return true;
+  };
+
+  for (const auto &name1 : { name, lname, name + ".prg", lname + ".prg" }) {
+    if (fileExists(dir + name1))
+      return dir + name1;
+  }
+
+  return "";
+}
+
+//---
+
+// PETSCII (unshifted) to ASCII (0 if no equivalent)
+char
+C6502C64::
+petsciiToAscii(uchar c)
+{
+  if (c == 13)
+    return '\n';
+
+  if (c >= 0x20 && c <= 0x5F)
+    return char(c);
+
+  // shifted letters
+  if (c >= 0xC1 && c <= 0xDA)
+    return char('a' + (c - 0xC1));
+
+  return 0;
+}
+
+// ASCII to PETSCII (unshifted)
+uchar
+C6502C64::
+asciiToPetscii(char c)
+{
+  if (c == '\n')
+    return 13;
+
+  if (c >= 'a' && c <= 'z')
+    return uchar('A' + (c - 'a'));
+
+  return uchar(c);
+}
@@ -0,0 +1,176 @@
+#include <C6502Env.h>
+
+C6502Env::
+C6502Env(uint n, const StateP &state, ushort screenAddr, uint screenLen, uint numThreads) :
+ state_(state), screenAddr_(screenAddr), screenLen_(screenLen)
+{
+  assert(state_);
+
+  if (screenAddr_ + screenLen_ > 0x10000)
+    screenLen_ = 0x10000 - screenAddr_;
+
+  screens_.resize(std::max(n, 1U)*screenLen_);
+
+  for (uint i = 0; i < n; ++i) {
+    auto instance = std::make_unique<Instance>();
+
+    instance->cpu = std::make_unique<C6502>();
+
+    instance->cpu->setIdleSkip(true);
+
+    instance->input  = std::make_unique<C6502Input>(instance->cpu.get(), 0xFE, keyAddr_);
+    instance->screen = std::make_unique<ScreenMirror>(instance->cpu.get(), screenAddr_,
+                                                      screenLen_, &screens_[i*screenLen_]);
+
+    instance->input->setLogging(false);
+
+    instance->cpu->addDevice(instance->screen.get(), screenAddr_, screenLen_);
+
+    instances_.push_back(std::move(instance));
+  }
+
+  //---
+
+  if (numThreads == 0)
+    numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+
+  numThreads = std::min(numThreads, std::max(n, 1U));
+
+  // calling thread is also a worker
+  for (uint i = 1; i < numThreads; ++i)
+    workers_.emplace_back([this]() { workerLoop(); });
+
+  resetAll();
+}
+
+C6502Env::
+~C6502Env()
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    stop_ = true;
+  }
+
+  startCond_.notify_all();
+
+  for (auto &worker : workers_)
+    worker.join();
+}
+
+//---
+
+void
+C6502Env::
+reset(uint i)
+{
+  auto &instance = *instances_[i];
+
+  instance.cpu->restoreState(*state_);
+
+  instance.cpu->setHalt(false);
+
+  instance.input->setSeed(seed_ + i);
+
+  instance.done = false;
+}
+
+void
+C6502Env::
+resetAll()
+{
+  runParallel([this](uint i) { reset(i); });
+}
+
+void
+C6502Env::
+step(const uchar *actions)
+{
+  runParallel([&](uint i) {
+    auto &instance = *instances_[i];
+    if (instance.done) return;
+
+    auto &cpu = *instance.cpu;
+
+    cpu.setByte(keyAddr_, actions[i]);
+
+    ulong t = cpu.t() + frameCycles_;
+
+    cpu.contCycles(frameCycles_);
+
+    // stopped before end of frame (BRK, halt or breakpoint)
+    if (cpu.isHalt() || cpu.t() < t)
+      instance.done = true;
+  });
+}
+
+//---
+
+void
+C6502Env::
+runParallel(const Job &job)
+{
+  job_     = job;
+  nextJob_ = 0;
+
+  if (! workers_.empty()) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      numActive_ = uint(workers_.size());
+
+      ++generation_;
+    }
+
+    startCond_.notify_all();
+  }
+
+  runJobs();
+
+  if (! workers_.empty()) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    doneCond_.wait(lock, [this]() { return numActive_ == 0; });
+  }
+
+  job_ = Job();
+}
+
+void
+C6502Env::
+runJobs()
+{
+  uint n = numInstances();
+
+  for (uint i = nextJob_++; i < n; i = nextJob_++)
+    job_(i);
+}
+
+void
+C6502Env::
+workerLoop()
+{
+  uint generation = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      startCond_.wait(lock, [&]() { return stop_ || generation_ != generation; });
+
+      if (stop_)
+        return;
+
+      generation = generation_;
+    }
+
+    runJobs();
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      if (--numActive_ == 0)
+        doneCond_.notify_one();
+    }
+  }
+}
@@ -0,0 +1,246 @@
+#include <C6502Input.h>
+#include <C6502.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char *inputMagic = "C6502IN1";
+
+}
+
+//---
+
+C6502Input::
+C6502Input(C6502 *cpu, ushort randomAddr, ushort keyAddr) :
+ cpu_(cpu), randomAddr_(randomAddr), keyAddr_(keyAddr)
+{
+  setSeed(0);
+
+  cpu_->addDevice(this, randomAddr_, 1);
+
+  if (keyAddr_ != randomAddr_)
+    cpu_->addDevice(this, keyAddr_, 1);
+}
+
+C6502Input::
+~C6502Input()
+{
+  cpu_->removeDevice(this);
+}
+
+void
+C6502Input::
+setSeed(ulong seed)
+{
+  seed_  = seed;
+  state_ = seed;
+}
+
+void
+C6502Input::
+addKeys(const std::string &str)
+{
+  for (auto c : str)
+    addKey(uchar(c));
+}
+
+//---
+
+bool
+C6502Input::
+saveLog(const std::string &filename) const
+{
+  FILE *fp = fopen(filename.c_str(), "w");
+  if (! fp) return false;
+
+  fprintf(fp, "%s\n", inputMagic);
+
+  for (const auto &entry : log_)
+    fprintf(fp, "%lu %04x %02x\n", entry.t, uint(entry.addr), uint(entry.value));
+
+  bool rc = (ferror(fp) == 0);
+
+  fclose(fp);
+
+  return rc;
+}
+
+bool
+C6502Input::
+loadLog(const std::string &filename, Log &log)
+{
+  FILE *fp = fopen(filename.c_str(), "r");
+  if (! fp) return false;
+
+  char magic[16];
+
+  bool rc = (fscanf(fp, "%15s", magic) == 1 && strcmp(magic, inputMagic) == 0);
+
+  log.clear();
+
+  ulong t;
+  uint  addr, value;
+
+  while (rc && fscanf(fp, "%lu %x %x", &t, &addr, &value) == 3)
+    log.push_back(Entry(t, ushort(addr), uchar(value)));
+
+  fclose(fp);
+
+  return rc;
+}
+
+//---
+
+void
+C6502Input::
+startReplay(const Log &log)
+{
+  replay_        = true;
+  replayLog_     = log;
+  replayPos_     = 0;
+  numMismatches_ = 0;
+}
+
+void
+C6502Input::
+stopReplay()
+{
+  replay_ = false;
+
+  replayLog_.clear();
+
+  replayPos_ = 0;
+}
+
+bool
+C6502Input::
+replayValue(ulong t, ushort addr, uchar &value)
+{
+  if (replayPos_ >= replayLog_.size())
+    return false;
+
+  const auto &entry = replayLog_[replayPos_];
+
+  if (entry.t != t || entry.addr != addr)
+    return false;
+
+  value = entry.value;
+
+  ++replayPos_;
+
+  return true;
+}
+
+//---
+
+bool
+C6502Input::
+memRead(ushort addr, uchar &value)
+{
+  ulong t = cpu_->t();
+
+  if      (addr == randomAddr_) {
+    if (! replay_ || ! replayValue(t, addr, value)) {
+      if (replay_)
+        ++numMismatches_;
+
+      value = nextRandom();
+    }
+
+    logValue(t, addr, value);
+  }
+  else if (addr == keyAddr_) {
+    // new key only logged when delivered, reads of held key are not
+    if (replay_) {
+      if (replayValue(t, addr, lastKey_))
+        logValue(t, addr, lastKey_);
+    }
+    else if (! keys_.empty()) {
+      lastKey_ = keys_.front();
+
+      keys_.pop_front();
+
+      logValue(t, addr, lastKey_);
+    }
+
+    value = lastKey_;
+  }
+  else
+    return false;
+
+  return true;
+}
+
+// inspection shows held key (random value is only generated when read by program)
+bool
+C6502Input::
+memPeek(ushort addr, uchar &value) const
+{
+  if (addr != keyAddr_)
+    return false;
+
+  value = lastKey_;
+
+  return true;
+}
+
+void
+C6502Input::
+memWritten(ushort addr, uchar /*oldValue*/, uchar value)
+{
+  // program can clear/set held key
+  if (addr == keyAddr_)
+    lastKey_ = value;
+}
+
+void
+C6502Input::
+memReset(ushort addr, uint len)
+{
+  // held key is memory contents after restore/memset
+  if (keyAddr_ >= addr && keyAddr_ < addr + len)
+    cpu_->memget(keyAddr_, &lastKey_, 1);
+}
+
+void
+C6502Input::
+checkpoint()
+{
+  checkpoint_.state         = state_;
+  checkpoint_.keys          = keys_;
+  checkpoint_.lastKey       = lastKey_;
+  checkpoint_.logSize       = log_.size();
+  checkpoint_.replayPos     = replayPos_;
+  checkpoint_.numMismatches = numMismatches_;
+}
+
+void
+C6502Input::
+restoreCheckpoint()
+{
+  state_         = checkpoint_.state;
+  keys_          = checkpoint_.keys;
+  lastKey_       = checkpoint_.lastKey;
+  replayPos_     = checkpoint_.replayPos;
+  numMismatches_ = checkpoint_.numMismatches;
+
+  if (log_.size() > checkpoint_.logSize)
+    log_.resize(checkpoint_.logSize);
+}
+
+C6502Input::uchar
+C6502Input::
+nextRandom()
+{
+  // xorshift64* (zero state not allowed)
+  if (state_ == 0)
+    state_ = 0x9E3779B97F4A7C15UL;
+
+  state_ ^= state_ >> 12;
+  state_ ^= state_ << 25;
+  state_ ^= state_ >> 27;
+
+  return uchar((state_*0x2545F4914F6CDD1DUL) >> 56);
+}
@@ -0,0 +1,221 @@
+#include <C6502Lockstep.h>
+#include <algorithm>
+#include <cstring>
+
+C6502Lockstep::
+C6502Lockstep(C6502 *cpu1, C6502 *cpu2) :
+ cpu1_(cpu1), cpu2_(cpu2)
+{
+  cpu1_->setTrackDirtyPages(true);
+
+  cpu2_->setWriteJournal(true);
+  cpu2_->setDecimalTables(false);
+}
+
+C6502Lockstep::
+~C6502Lockstep()
+{
+  cpu1_->setTrackDirtyPages(false);
+
+  cpu2_->setWriteJournal(false);
+  cpu2_->setDecimalTables(true);
+}
+
+bool
+C6502Lockstep::
+run(ulong maxSteps)
+{
+  diverged_ = false;
+
+  report_.clear();
+
+  cpu1_->setBreak(false);
+  cpu2_->setBreak(false);
+
+  cpu1_->clearDirtyPages();
+  cpu2_->clearWriteJournal();
+
+  ulong steps = 0;
+
+  while (steps < maxSteps) {
+    uint n = uint(std::min(ulong(blockSize_), maxSteps - steps));
+
+    bool stopped = false;
+
+    if (n == 1) {
+      steps += runBlock(1, true, stopped);
+    }
+    else {
+      ulong numSteps = numSteps_;
+
+      cpu1_->setCheckpoint();
+      cpu2_->setCheckpoint();
+
+      uint n1 = runBlock(n, false, stopped);
+
+      if (! compare()) {
+        // rerun block one instruction at a time to find first divergence
+        std::string blockReport = report_;
+
+        cpu1_->restoreCheckpoint(); cpu1_->setBreak(false); cpu1_->clearDirtyPages();
+        cpu2_->restoreCheckpoint(); cpu2_->setBreak(false); cpu2_->clearWriteJournal();
+
+        numSteps_ = numSteps;
+        diverged_ = false;
+
+        runBlock(n1, true, stopped);
+
+        // not reproduced stepping singly so report block
+        if (! diverged_) {
+          diverged_ = true;
+          report_   = blockReport;
+        }
+      }
+
+      cpu1_->clearCheckpoint();
+      cpu2_->clearCheckpoint();
+
+      steps += n1;
+    }
+
+    if (diverged_)
+      return false;
+
+    if (stopped)
+      break;
+  }
+
+  return true;
+}
+
+uint
+C6502Lockstep::
+runBlock(uint n, bool compareEach, bool &stopped)
+{
+  stopped = false;
+
+  for (uint i = 0; i < n; ++i) {
+    stepBoth();
+
+    if (compareEach && ! compare())
+      return i + 1;
+
+    if (isStopped(cpu1_) || isStopped(cpu2_)) {
+      stopped = true;
+      return i + 1;
+    }
+  }
+
+  return n;
+}
+
+void
+C6502Lockstep::
+stepBoth()
+{
+  lastPC_ = cpu1_->PC();
+
+  cpu1_->step();
+  cpu2_->step();
+
+  ++numSteps_;
+}
+
+bool
+C6502Lockstep::
+compare()
+{
+  std::stringstream ss;
+
+  auto hex = [&](uint value, int w) {
+    ss << std::hex << std::setfill('0') << std::setw(w) << value << std::dec;
+  };
+
+  auto cmpReg = [&](const char *name, uint v1, uint v2, int w) {
+    if (v1 == v2) return;
+
+    ss << "  " << name << ": "; hex(v1, w); ss << " != "; hex(v2, w); ss << "\n";
+  };
+
+  cmpReg("PC", cpu1_->PC(), cpu2_->PC(), 4);
+  cmpReg("A" , cpu1_->A (), cpu2_->A (), 2);
+  cmpReg("X" , cpu1_->X (), cpu2_->X (), 2);
+  cmpReg("Y" , cpu1_->Y (), cpu2_->Y (), 2);
+  cmpReg("SR", cpu1_->SR(), cpu2_->SR(), 2);
+  cmpReg("SP", cpu1_->SP(), cpu2_->SP(), 2);
+
+  if (cpu1_->t() != cpu2_->t())
+    ss << "  t: " << cpu1_->t() << " != " << cpu2_->t() << "\n";
+
+  compareMemory(ss);
+
+  std::string diffs = ss.str();
+
+  cpu1_->clearDirtyPages();
+  cpu2_->clearWriteJournal();
+
+  if (diffs.empty())
+    return true;
+
+  //---
+
+  std::string str;
+  int         len;
+
+  cpu1_->disassembleAddr(lastPC_, str, len);
+
+  std::stringstream ss1;
+
+  ss1 << "Divergence after " << numSteps_ << " instructions\n";
+
+  ss1 << "  "; ss1 << std::hex << std::setfill('0') << std::setw(4) << lastPC_ << std::dec;
+  ss1 << " " << str << "\n";
+
+  ss1 << diffs;
+
+  report_   = ss1.str();
+  diverged_ = true;
+
+  return false;
+}
+
+// compare pages written by either CPU (first CPU dirty pages, second CPU journal)
+void
+C6502Lockstep::
+compareMemory(std::stringstream &ss)
+{
+  std::vector<uchar> pages = cpu1_->dirtyPages();
+
+  for (const auto &e : cpu2_->writeJournal())
+    pages.push_back(uchar(e.addr >> 8));
+
+  std::sort(pages.begin(), pages.end());
+
+  pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+  uint numDiffs = 0;
+
+  for (auto page : pages) {
+    ushort addr = ushort(page << 8);
+
+    uchar mem1[0x100], mem2[0x100];
+
+    cpu1_->memget(addr, mem1, 0x100);
+    cpu2_->memget(addr, mem2, 0x100);
+
+    if (std::memcmp(mem1, mem2, 0x100) == 0)
+      continue;
+
+    for (uint i = 0; i < 0x100; ++i) {
+      if (mem1[i] == mem2[i]) continue;
+
+      // limit report size
+      if (++numDiffs > 8)
+        return;
+
+      ss << "  mem " << std::hex << std::setfill('0') << std::setw(4) << (addr + i) << ": " <<
+            std::setw(2) << uint(mem1[i]) << " != " << std::setw(2) << uint(mem2[i]) <<
+            std::dec << "\n";
+    }
+  }
+}
@@ -0,0 +1,355 @@
+#include <C6502Rewind.h>
+
+C6502Rewind::
+C6502Rewind(C6502 *cpu, ulong interval, size_t budget) :
+ cpu_(cpu), interval_(std::max(interval, 1UL)), budget_(budget)
+{
+}
+
+C6502Rewind::
+~C6502Rewind()
+{
+  setEnabled(false);
+}
+
+void
+C6502Rewind::
+setEnabled(bool b)
+{
+  if (b == enabled_)
+    return;
+
+  enabled_ = b;
+
+  snapshots_.clear();
+
+  memUsed_ = 0;
+
+  numTaken_ = 0;
+
+  checkpoint_.set = false;
+
+  if (enabled_) {
+    cpu_->setTrackDirtyPages(true);
+
+    cpu_->addDevice(this, 0, 0);
+
+    // shadow is memory at latest snapshot
+    shadow_.resize(0x10000);
+
+    cpu_->memget(0x0000, &shadow_[0x0000], 0x8000);
+    cpu_->memget(0x8000, &shadow_[0x8000], 0x8000);
+
+    snapshot();
+
+    schedule();
+  }
+  else {
+    if (eventId_)
+      cpu_->cancelEvent(eventId_);
+
+    eventId_ = 0;
+
+    cpu_->removeDevice(this);
+
+    cpu_->setTrackDirtyPages(false);
+
+    Mem().swap(shadow_);
+  }
+}
+
+void
+C6502Rewind::
+setInterval(ulong n)
+{
+  interval_ = std::max(n, 1UL);
+
+  if (enabled_) {
+    if (eventId_)
+      cpu_->cancelEvent(eventId_);
+
+    schedule();
+  }
+}
+
+void
+C6502Rewind::
+schedule()
+{
+  eventId_ = cpu_->addEventIn(interval_, [this]() {
+    eventId_ = 0;
+
+    snapshot();
+
+    schedule();
+  });
+}
+
+//---
+
+void
+C6502Rewind::
+snapshot()
+{
+  if (! enabled_)
+    return;
+
+  Snapshot snap;
+
+  cpu_->saveRegs(snap.state);
+
+  snap.halt = cpu_->isHalt();
+
+  // encode XOR of each written page with shadow and update shadow
+  uchar page[0x100], delta[0x100];
+
+  for (auto p : cpu_->dirtyPages()) {
+    ushort addr = ushort(p << 8);
+
+    cpu_->memget(addr, page, 0x100);
+
+    uchar *shadow = &shadow_[addr];
+
+    uchar diff = 0;
+
+    for (uint i = 0; i < 0x100; ++i) {
+      delta[i] = page[i] ^ shadow[i];
+
+      diff |= delta[i];
+    }
+
+    if (! diff)
+      continue;
+
+    snap.data.push_back(p);
+
+    encodePage(delta, snap.data);
+
+    std::memcpy(shadow, page, 0x100);
+  }
+
+  cpu_->clearDirtyPages();
+
+  snap.data.shrink_to_fit();
+
+  memUsed_ += sizeof(Snapshot) + snap.data.size();
+
+  snapshots_.push_back(std::move(snap));
+
+  ++numTaken_;
+
+  dropOld();
+}
+
+void
+C6502Rewind::
+dropOld()
+{
+  while (memUsed_ > budget_ && snapshots_.size() > 1) {
+    memUsed_ -= sizeof(Snapshot) + snapshots_.front().data.size();
+
+    snapshots_.pop_front();
+
+    // oldest delta leads to dropped snapshot so no longer needed
+    auto &front = snapshots_.front();
+
+    memUsed_ -= front.data.size();
+
+    std::vector<uchar>().swap(front.data);
+  }
+}
+
+//---
+
+bool
+C6502Rewind::
+seek(uint i)
+{
+  if (i >= snapshots_.size())
+    return false;
+
+  bool changed[0x100] = { };
+
+  // pages written since latest snapshot are restored from shadow
+  for (auto p : cpu_->dirtyPages())
+    changed[p] = true;
+
+  // apply deltas (newest first) to shadow back to snapshot i
+  while (snapshots_.size() > i + 1)
+    undoSnapshot(changed);
+
+  for (uint p = 0; p < 0x100; ++p) {
+    if (changed[p])
+      cpu_->memset(ushort(p << 8), &shadow_[p << 8], 0x100);
+  }
+
+  const auto &snap = snapshots_.back();
+
+  cpu_->restoreRegs(snap.state);
+
+  cpu_->setHalt(snap.halt);
+
+  cpu_->clearDirtyPages();
+
+  // next snapshot interval from restored cycle count
+  if (eventId_) {
+    cpu_->cancelEvent(eventId_);
+
+    schedule();
+  }
+
+  return true;
+}
+
+void
+C6502Rewind::
+undoSnapshot(bool *changed)
+{
+  auto &snap = snapshots_.back();
+
+  const uchar *data = snap.data.data();
+  const uchar *end  = data + snap.data.size();
+
+  while (data < end) {
+    uchar p = *data++;
+
+    data += decodePage(data, &shadow_[ushort(p << 8)]);
+
+    changed[p] = true;
+  }
+
+  memUsed_ -= sizeof(Snapshot) + snap.data.size();
+
+  snapshots_.pop_back();
+
+  --numTaken_;
+}
+
+bool
+C6502Rewind::
+seekT(ulong t)
+{
+  for (uint i = numSnapshots(); i > 0; --i) {
+    if (snapshotT(i - 1) <= t)
+      return seek(i - 1);
+  }
+
+  return false;
+}
+
+bool
+C6502Rewind::
+stepBack()
+{
+  if (snapshots_.empty())
+    return false;
+
+  uint i = numSnapshots() - 1;
+
+  // already at latest snapshot so go to one before
+  if (cpu_->t() == snapshotT(i) && cpu_->dirtyPages().empty()) {
+    if (i == 0)
+      return false;
+
+    --i;
+  }
+
+  return seek(i);
+}
+
+//---
+
+void
+C6502Rewind::
+checkpoint()
+{
+  checkpoint_.set      = true;
+  checkpoint_.numTaken = numTaken_;
+  checkpoint_.eventId  = eventId_;
+}
+
+// undo snapshots taken after checkpoint (CPU memory, registers and events are restored)
+void
+C6502Rewind::
+restoreCheckpoint()
+{
+  if (! checkpoint_.set)
+    return;
+
+  bool changed[0x100] = { };
+
+  while (numTaken_ > checkpoint_.numTaken && snapshots_.size() > 1)
+    undoSnapshot(changed);
+
+  if (numTaken_ > checkpoint_.numTaken) {
+    // earlier snapshots dropped (budget) so restart from restored memory
+    snapshots_.clear();
+
+    memUsed_ = 0;
+
+    cpu_->memget(0x0000, &shadow_[0x0000], 0x8000);
+    cpu_->memget(0x8000, &shadow_[0x8000], 0x8000);
+
+    cpu_->clearDirtyPages();
+
+    snapshot();
+
+    numTaken_ = checkpoint_.numTaken;
+  }
+  else {
+    // pages which differ from rolled back shadow are written since its snapshot
+    for (uint p = 0; p < 0x100; ++p) {
+      if (changed[p])
+        cpu_->setDirtyPage(p);
+    }
+  }
+
+  // snapshot event restored with CPU events
+  eventId_ = checkpoint_.eventId;
+}
+
+//---
+
+// encode as (zero run, literal count, literals) tokens covering 256 bytes
+void
+C6502Rewind::
+encodePage(const uchar *delta, std::vector<uchar> &data)
+{
+  uint pos = 0;
+
+  while (pos < 0x100) {
+    uint z = 0;
+
+    while (pos < 0x100 && delta[pos] == 0 && z < 255) { ++pos; ++z; }
+
+    uint start = pos, n = 0;
+
+    while (pos < 0x100 && delta[pos] != 0 && n < 255) { ++pos; ++n; }
+
+    data.push_back(uchar(z));
+    data.push_back(uchar(n));
+
+    data.insert(data.end(), &delta[start], &delta[start] + n);
+  }
+}
+
+// XOR encoded delta into page (returns encoded size)
+size_t
+C6502Rewind::
+decodePage(const uchar *data, uchar *page)
+{
+  const uchar *data1 = data;
+
+  uint pos = 0;
+
+  while (pos < 0x100) {
+    pos += *data++;
+
+    uint n = *data++;
+
+    for (uint i = 0; i < n; ++i)
+      page[pos++] ^= *data++;
+  }
+
+  return size_t(data - data1);
+}
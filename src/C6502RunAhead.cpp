@@ -0,0 +1,56 @@
+#include <C6502RunAhead.h>
+#include <C6502.h>
+
+C6502RunAhead::
+C6502RunAhead(C6502 *cpu, uint numFrames, ulong frameCycles) :
+ cpu_(cpu), numFrames_(numFrames), frameCycles_(frameCycles)
+{
+}
+
+bool
+C6502RunAhead::
+runFrame(const PresentProc &present)
+{
+  bool rc = runCycles();
+
+  if (numFrames_ == 0 || ! rc) {
+    if (present)
+      present();
+
+    return rc;
+  }
+
+  cpu_->setCheckpoint();
+
+  // ahead frames output is dropped (real frames output it)
+  bool enabled = cpu_->output().isEnabled();
+
+  cpu_->output().setEnabled(false);
+
+  for (uint i = 0; i < numFrames_; ++i) {
+    if (! runCycles())
+      break;
+  }
+
+  cpu_->output().setEnabled(enabled);
+
+  if (present)
+    present();
+
+  cpu_->restoreCheckpoint();
+
+  cpu_->clearCheckpoint();
+
+  return true;
+}
+
+bool
+C6502RunAhead::
+runCycles()
+{
+  ulong t = cpu_->t() + frameCycles_;
+
+  cpu_->contCycles(frameCycles_);
+
+  return (! cpu_->isHalt() && cpu_->t() >= t);
+}
@@ -0,0 +1,269 @@
+#include <C6502Screen.h>
+#include <C6502.h>
+#include <string>
+
+namespace {
+
+// C64 palette (also used by snake style pixel screens)
+const C6502Screen::uchar palette[16][3] = {
+  { 0x00, 0x00, 0x00 }, // black
+  { 0xFF, 0xFF, 0xFF }, // white
+  { 0x68, 0x37, 0x2B }, // red
+  { 0x70, 0xA4, 0xB2 }, // cyan
+  { 0x6F, 0x3D, 0x86 }, // purple
+  { 0x58, 0x8D, 0x43 }, // green
+  { 0x35, 0x28, 0x79 }, // blue
+  { 0xB8, 0xC7, 0x6F }, // yellow
+  { 0x6F, 0x4F, 0x25 }, // orange
+  { 0x43, 0x39, 0x00 }, // brown
+  { 0x9A, 0x67, 0x59 }, // light red
+  { 0x44, 0x44, 0x44 }, // dark grey
+  { 0x6C, 0x6C, 0x6C }, // grey
+  { 0x9A, 0xD2, 0x84 }, // light green
+  { 0x6C, 0x5E, 0xB5 }, // light blue
+  { 0x95, 0x95, 0x95 }  // light grey
+};
+
+}
+
+//---
+
+C6502Screen::
+C6502Screen(C6502 *cpu, ushort addr, uint width, uint height, Mode mode) :
+ cpu_(cpu), addr_(addr), width_(std::max(width, 1U)), height_(std::max(height, 1U)),
+ mode_(mode)
+{
+  dirty_.resize(width_*height_);
+
+  // text is drawn as one block per character so scale up
+  if (mode_ == Mode::TEXT)
+    scale_ = 8;
+
+  cpu_->addDevice(this, addr_, width_*height_);
+
+  // first frame always output
+  setAllDirty();
+}
+
+C6502Screen::
+~C6502Screen()
+{
+  cpu_->removeDevice(this);
+}
+
+void
+C6502Screen::
+setAllDirty()
+{
+  std::fill(dirty_.begin(), dirty_.end(), 1);
+
+  numDirty_ = uint(dirty_.size());
+}
+
+void
+C6502Screen::
+clearDirty()
+{
+  std::fill(dirty_.begin(), dirty_.end(), 0);
+
+  numDirty_ = 0;
+}
+
+C6502Screen::uchar
+C6502Screen::
+cell(uint x, uint y) const
+{
+  return cpu_->getByte(ushort(addr_ + y*width_ + x));
+}
+
+//---
+
+bool
+C6502Screen::
+updateFrame(std::ostream &os, Format format)
+{
+  if (! isDirty())
+    return false;
+
+  writeFrame(os, format);
+
+  return true;
+}
+
+void
+C6502Screen::
+writeFrame(std::ostream &os, Format format)
+{
+  switch (format) {
+    case Format::PPM : writePPM (os); break;
+    case Format::Y4M : writeY4M (os); break;
+    case Format::TEXT: writeText(os); break;
+  }
+
+  clearDirty();
+
+  ++numFrames_;
+}
+
+void
+C6502Screen::
+writePPM(std::ostream &os) const
+{
+  uint w = width_*scale_;
+  uint h = height_*scale_;
+
+  os << "P6\n" << w << " " << h << "\n255\n";
+
+  std::vector<uchar> row(w*3);
+
+  uchar rgb[3];
+
+  for (uint y = 0; y < height_; ++y) {
+    for (uint x = 0; x < width_; ++x) {
+      cellRGB(x, y, rgb);
+
+      for (uint s = 0; s < scale_; ++s)
+        std::copy(rgb, rgb + 3, &row[(x*scale_ + s)*3]);
+    }
+
+    for (uint s = 0; s < scale_; ++s)
+      os.write(reinterpret_cast<const char *>(&row[0]), std::streamsize(row.size()));
+  }
+}
+
+void
+C6502Screen::
+writeY4M(std::ostream &os)
+{
+  uint w = width_*scale_;
+  uint h = height_*scale_;
+
+  // stream header once (size can't change after it is written)
+  if (! y4mHeader_) {
+    os << "YUV4MPEG2 W" << w << " H" << h << " F" << fps_ << ":1 Ip A1:1 C444\n";
+
+    y4mHeader_ = true;
+  }
+
+  os << "FRAME\n";
+
+  // planar Y, U, V (BT.601)
+  image_.resize(w*h*3);
+
+  uchar *yp = &image_[0];
+  uchar *up = yp + w*h;
+  uchar *vp = up + w*h;
+
+  uchar rgb[3];
+
+  for (uint y = 0; y < height_; ++y) {
+    for (uint x = 0; x < width_; ++x) {
+      cellRGB(x, y, rgb);
+
+      int r = rgb[0], g = rgb[1], b = rgb[2];
+
+      uchar Y = uchar(( 66*r + 129*g +  25*b + 128)/256 +  16);
+      uchar U = uchar((-38*r -  74*g + 112*b + 128)/256 + 128);
+      uchar V = uchar((112*r -  94*g -  18*b + 128)/256 + 128);
+
+      for (uint sy = 0; sy < scale_; ++sy) {
+        uint i = (y*scale_ + sy)*w + x*scale_;
+
+        for (uint sx = 0; sx < scale_; ++sx, ++i) {
+          yp[i] = Y; up[i] = U; vp[i] = V;
+        }
+      }
+    }
+  }
+
+  os.write(reinterpret_cast<const char *>(&image_[0]), std::streamsize(image_.size()));
+}
+
+void
+C6502Screen::
+writeText(std::ostream &os) const
+{
+  static const char *xchars = " 123456789abcdef";
+
+  os << "--- Frame " << numFrames_ << " ---\n";
+
+  std::string line;
+
+  for (uint y = 0; y < height_; ++y) {
+    line.clear();
+
+    for (uint x = 0; x < width_; ++x) {
+      uchar c = cell(x, y);
+
+      if (mode_ == Mode::TEXT)
+        line += screenCodeToAscii(c);
+      else
+        line += xchars[c & 0xF];
+    }
+
+    // trim trailing space
+    auto len = line.find_last_not_of(' ');
+
+    line.resize(len != std::string::npos ? len + 1 : 0);
+
+    os << line << "\n";
+  }
+}
+
+//---
+
+void
+C6502Screen::
+memWritten(ushort addr, uchar oldValue, uchar value)
+{
+  if (oldValue == value)
+    return;
+
+  uint i = uint(addr - addr_);
+
+  if (i < dirty_.size())
+    setDirty(i);
+}
+
+void
+C6502Screen::
+memReset(ushort addr, uint len)
+{
+  uint i1 = std::max(uint(addr), uint(addr_)) - addr_;
+  uint i2 = std::min(uint(addr) + len, uint(addr_) + uint(dirty_.size())) - addr_;
+
+  for (uint i = i1; i < i2; ++i)
+    setDirty(i);
+}
+
+//---
+
+void
+C6502Screen::
+cellRGB(uint x, uint y, uchar rgb[3]) const
+{
+  uchar c = cell(x, y);
+
+  const uchar *prgb;
+
+  if (mode_ == Mode::TEXT)
+    prgb = palette[(c & 0x7F) != 0x20 ? 14 : 6]; // no character ROM so block per character
+  else
+    prgb = palette[c & 0xF];
+
+  rgb[0] = prgb[0]; rgb[1] = prgb[1]; rgb[2] = prgb[2];
+}
+
+char
+C6502Screen::
+screenCodeToAscii(uchar c)
+{
+  c &= 0x7F; // ignore reverse
+
+  if (c == 0x00) return '@';
+  if (c <= 0x1A) return char('A' + c - 1);
+  if (c <  0x20) return "[\\]^_"[c - 0x1B]; // £ shown as backslash
+  if (c <  0x40) return char(c);            // space, punctuation, digits
+
+  return '.';
+}
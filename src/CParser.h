@@ -2,13 +2,15 @@
 #define CParser_H
 
 #include <string>
+#include <string_view>
 
+// Parser over string view (source text is not copied so must outlive parser)
 class CParser {
  public:
   using uchar = unsigned char;
 
  public:
-  CParser(const std::string &str) :
+  CParser(std::string_view str) :
    str_(str), len_(uint(str.size())) {
   }
 
@@ -16,7 +18,7 @@ class CParser {
 
   bool isChar(char c) const { return (! eof() && str_[pos_] == c); }
 
-  bool isChars(const std::string &str) const {
+  bool isChars(std::string_view str) const {
     auto len = str.size();
 
     for (uint i = 0; i < len; ++i)
@@ -61,6 +63,17 @@ class CParser {
   }
 
   bool readWord(std::string &word) {
+    std::string_view word1;
+
+    if (! readWord(word1))
+      return false;
+
+    word = word1;
+
+    return true;
+  }
+
+  bool readWord(std::string_view &word) {
     skipSpace();
 
     int pos1 = pos_;
@@ -85,6 +98,17 @@ class CParser {
   }
 
   bool readSepWord(std::string &word, char sep) {
+    std::string_view word1;
+
+    if (! readSepWord(word1, sep))
+      return false;
+
+    word = word1;
+
+    return true;
+  }
+
+  bool readSepWord(std::string_view &word, char sep) {
     skipSpace();
 
     int pos1 = pos_;
@@ -116,8 +140,8 @@ class CParser {
     return true;
   }
 
-  std::string toUpper(const std::string &s) const {
-    std::string s1 = s;
+  std::string toUpper(std::string_view s) const {
+    std::string s1(s);
 
     std::transform(s1.begin(), s1.end(), s1.begin(),
                    [](unsigned char c){ return std::toupper(c); } // correct
@@ -126,8 +150,6 @@ class CParser {
   }
 
   ushort getHexValue(uchar &alen) {
-    static std::string xchars = "0123456789abcdef";
-
     alen = 0;
 
     ushort hvalue = 0;
@@ -135,9 +157,9 @@ class CParser {
     while (! eof() && isXDigit()) {
       char c1 = char(std::tolower(getChar()));
 
-      auto p = xchars.find(c1);
+      int p = (c1 <= '9' ? c1 - '0' : c1 - 'a' + 10);
 
-      hvalue = ushort(hvalue*16 + int(p));
+      hvalue = ushort(hvalue*16 + p);
 
       skipChar();
 
@@ -148,16 +170,14 @@ class CParser {
   }
 
   ushort getDecValue(uchar &alen) {
-    static std::string dchars = "0123456789";
-
     alen = 0;
 
     ushort dvalue = 0;
 
     while (! eof() && isDigit()) {
-      auto p = dchars.find(getChar());
+      int p = getChar() - '0';
 
-      dvalue = ushort(dvalue*10 + int(p));
+      dvalue = ushort(dvalue*10 + p);
 
       skipChar();
 
@@ -190,20 +210,32 @@ class CParser {
   }
 
   int readLabel(std::string &label) {
-    label = "";
+    std::string_view label1;
+
+    readLabel(label1);
+
+    label = label1;
+
+    return (label.size() > 0);
+  }
+
+  int readLabel(std::string_view &label) {
+    uint pos1 = pos_;
 
     while (! eof()) {
       if (isSpace() || isChar(',') || isChar(')'))
         break;
 
-      label += readChar();
+      skipChar();
     }
 
+    label = str_.substr(pos1, pos_ - pos1);
+
     return (label.size() > 0);
   }
 
  private:
-  std::string str_;
+  std::string_view str_;
   uint        pos_ { 0 };
   uint        len_ { 0 };
 };
@@ -5,6 +5,7 @@
 #include <CQ6502TraceBack.h>
 #include <CQ6502RegEdit.h>
 #include <C6502.h>
+#include <C6502Rewind.h>
 #include <CQTabSplit.h>
 #include <CQUtil.h>
 #include <CStrUtil.h>
@@ -57,6 +58,16 @@ init()
   updateRegisters();
 }
 
+void
+CQ6502Dbg::
+setRewind(C6502Rewind *rewind)
+{
+  rewind_ = rewind;
+
+  if (rewindButton_)
+    rewindButton_->setEnabled(rewind_ != nullptr);
+}
+
 void
 CQ6502Dbg::
 setFixedFont(const QFont &font)
@@ -486,6 +497,7 @@ addButtonsWidgets()
   continueButton_ = addButtonWidget("continue", "Continue");
   stopButton_     = addButtonWidget("stop"    , "Stop");
   restartButton_  = addButtonWidget("restart" , "Restart");
+  rewindButton_   = addButtonWidget("rewind"  , "Rewind");
   exitButton_     = addButtonWidget("exit"    , "Exit");
 
   connect(runButton_     , SIGNAL(clicked()), this, SLOT(runSlot()));
@@ -494,6 +506,9 @@ addButtonsWidgets()
   connect(continueButton_, SIGNAL(clicked()), this, SLOT(continueSlot()));
   connect(stopButton_    , SIGNAL(clicked()), this, SLOT(stopSlot()));
   connect(restartButton_ , SIGNAL(clicked()), this, SLOT(restartSlot()));
+  connect(rewindButton_  , SIGNAL(clicked()), this, SLOT(rewindSlot()));
+
+  rewindButton_->setEnabled(rewind_ != nullptr);
   connect(exitButton_    , SIGNAL(clicked()), this, SLOT(exitSlot()));
 }
 
@@ -944,6 +959,17 @@ restartSlot()
   updateAll();
 }
 
+// seek back to previous rewind snapshot
+void
+CQ6502Dbg::
+rewindSlot()
+{
+  if (! rewind_ || ! rewind_->stepBack())
+    return;
+
+  updateAll();
+}
+
 void
 CQ6502Dbg::
 exitSlot()
@@ -0,0 +1,414 @@
+#include <C6502.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Coverage guided fuzzer for CPU core.
+//
+// Input is initial registers (A, X, Y, SR, SP) followed by code placed at $0200.
+// Each input is run on two reusable CPU instances configured to use different paths:
+//  . fast : reset by checkpoint restore (only pages written by the previous run are
+//           copied), incremental memory hashing and idle loop skip
+//  . plain: reset by reloading all memory, no hashing or idle skip
+// and checked for:
+//  . both instances agree on registers, cycle count and memory writes after each
+//    instruction
+//  . cycle count increases by 1 to 8 cycles per instruction
+//  . an idle loop found by the fast instance repeats on the plain instance with no
+//    memory change
+//  . incremental memory hash matches a full hash of plain memory (every 64 runs)
+//
+// Coverage is an edge bitmap of (previous PC, PC) pairs. Inputs which hit a new
+// edge are added to the corpus for mutation.
+//
+// Build with -DC6502_LIBFUZZER (and -fsanitize=fuzzer) for a libFuzzer target.
+class C6502Fuzz {
+ public:
+  using uchar  = C6502::uchar;
+  using ushort = C6502::ushort;
+  using ulong  = C6502::ulong;
+
+  using Data = std::vector<uchar>;
+
+  enum { CODE_ADDR = 0x0200, MAX_CODE = 0x0600, NUM_REGS = 5 };
+
+ public:
+  C6502Fuzz() {
+    // random code returns from interrupts never taken (RTI/BRK nesting warnings)
+    std::cerr.setstate(std::ios::badbit);
+
+    initBase();
+
+    initCPU(cpu1_, /*fast*/true );
+    initCPU(cpu2_, /*fast*/false);
+
+    std::memset(edges_, 0, sizeof(edges_));
+  }
+
+  void setMaxSteps(uint n) { maxSteps_ = n; }
+
+  uint numEdges() const { return numEdges_; }
+
+  const std::string &report() const { return report_; }
+
+  // run input (returns false if check failed, newEdges set if new coverage)
+  bool runOne(const uchar *data, size_t size, bool &newEdges) {
+    reset(cpu1_, data, size, /*fast*/true );
+    reset(cpu2_, data, size, /*fast*/false);
+
+    uint numEdges = numEdges_;
+
+    bool rc = true;
+
+    for (uint i = 0; i < maxSteps_; ++i) {
+      ushort pc = cpu1_.PC();
+      ulong  t  = cpu1_.t();
+
+      cpu1_.step();
+      cpu2_.step();
+
+      // edge coverage
+      ushort edge = ushort((pc >> 1) ^ cpu1_.PC());
+
+      if (! edges_[edge]) { edges_[edge] = 1; ++numEdges_; }
+
+      if (! check(t)) {
+        rc = false;
+        break;
+      }
+
+      if (cpu1_.isBreak() || cpu1_.isHalt())
+        break;
+    }
+
+    // halt without jam on plain instance is an idle loop
+    if (rc && cpu1_.isHalt() && ! cpu2_.isHalt())
+      rc = checkIdle();
+
+    if (rc && (++numRuns_ & 0x3F) == 0)
+      rc = checkHash();
+
+    newEdges = (numEdges_ > numEdges);
+
+    return rc;
+  }
+
+  // mutate corpus entry or create random input
+  void mutate(const Data &corpus, Data &data) {
+    if (corpus.empty() || rand() % 16 == 0) {
+      data.resize(NUM_REGS + 1 + rand() % 64);
+
+      for (auto &c : data)
+        c = uchar(rand());
+
+      return;
+    }
+
+    data = corpus;
+
+    uint n = 1 + rand() % 4;
+
+    for (uint i = 0; i < n; ++i) {
+      size_t pos = rand() % data.size();
+
+      switch (rand() % 5) {
+        case 0: data[pos] ^= uchar(1 << (rand() % 8)); break; // bit flip
+        case 1: data[pos]  = uchar(rand()); break;            // byte
+        case 2: data[pos] += uchar(1 + rand() % 8); break;    // arith
+        case 3: {                                             // insert bytes
+          if (data.size() < NUM_REGS + MAX_CODE - 4) {
+            uchar bytes[3] = { uchar(rand()), uchar(rand()), uchar(rand()) };
+
+            data.insert(data.begin() + long(pos), bytes, bytes + 1 + rand() % 3);
+          }
+          break;
+        }
+        case 4: {                                             // erase byte
+          if (data.size() > NUM_REGS + 1)
+            data.erase(data.begin() + long(pos));
+          break;
+        }
+      }
+    }
+  }
+
+  ulong rand() {
+    // xorshift64
+    seed_ ^= seed_ << 13; seed_ ^= seed_ >> 7; seed_ ^= seed_ << 17;
+
+    return seed_;
+  }
+
+  void setSeed(ulong seed) { seed_ = (seed ? seed : 1); }
+
+ private:
+  void initBase() {
+    // fixed base memory (zero page pointers spread over memory, code area BRK)
+    base_.resize(0x10000);
+
+    ulong seed = 0x1234567;
+
+    for (uint addr = 0; addr < 0x10000; ++addr) {
+      seed = seed*6364136223846793005UL + 1442695040888963407UL;
+
+      base_[addr] = uchar(seed >> 56);
+    }
+
+    std::memset(&base_[CODE_ADDR], 0, MAX_CODE + 0x100);
+
+    // IRQ/BRK vector to code so interrupts keep running generated code
+    base_[0xFFFE] = uchar(CODE_ADDR & 0xFF);
+    base_[0xFFFF] = uchar(CODE_ADDR >> 8);
+  }
+
+  void loadBase(C6502 &cpu) {
+    for (uint addr = 0; addr < 0x10000; addr += 0x100)
+      cpu.memset(ushort(addr), &base_[addr], 0x100);
+  }
+
+  void initCPU(C6502 &cpu, bool fast) {
+    loadBase(cpu);
+
+    // run undocumented instructions
+    cpu.setUnsupported(true);
+
+    cpu.setWriteJournal(true);
+
+    if (fast) {
+      cpu.setHashMemory(true);
+      cpu.setIdleSkip(true);
+
+      cpu.setCheckpoint();
+    }
+  }
+
+  void reset(C6502 &cpu, const uchar *data, size_t size, bool fast) {
+    if (fast)
+      cpu.restoreCheckpoint();
+    else {
+      loadBase(cpu);
+
+      cpu.setHalt(false);
+    }
+
+    cpu.setBreak(false);
+
+    C6502::State state;
+
+    state.PC = CODE_ADDR;
+
+    if (size >= NUM_REGS) {
+      state.A  = data[0];
+      state.X  = data[1];
+      state.Y  = data[2];
+      state.SR = data[3];
+      state.SP = data[4];
+
+      data += NUM_REGS; size -= NUM_REGS;
+    }
+
+    cpu.restoreRegs(state);
+
+    if (size > MAX_CODE)
+      size = MAX_CODE;
+
+    if (size > 0)
+      cpu.memset(CODE_ADDR, data, ushort(size));
+
+    cpu.clearWriteJournal();
+  }
+
+  bool check(ulong t) {
+    ulong dt = cpu1_.t() - t;
+
+    // KIL halts (jam) without cycles
+    bool ok = (cpu1_.isBreak() || (cpu1_.isHalt() && dt == 0) || (dt >= 1 && dt <= 8));
+
+    if (cpu1_.PC() != cpu2_.PC() || cpu1_.A () != cpu2_.A () || cpu1_.X () != cpu2_.X () ||
+        cpu1_.Y () != cpu2_.Y () || cpu1_.SR() != cpu2_.SR() || cpu1_.SP() != cpu2_.SP() ||
+        cpu1_.t () != cpu2_.t () || cpu1_.writeJournal() != cpu2_.writeJournal())
+      ok = false;
+
+    cpu1_.clearWriteJournal();
+    cpu2_.clearWriteJournal();
+
+    if (! ok) {
+      char buffer[128];
+
+      snprintf(buffer, sizeof(buffer), "Check failed @ %04x (%lu cycles)\n",
+               uint(cpu1_.PC()), dt);
+
+      report_ = buffer;
+    }
+
+    return ok;
+  }
+
+  // plain instance must return to idle loop state with memory unchanged
+  bool checkIdle() {
+    Data mem1, mem2;
+
+    getMemory(cpu1_, mem1);
+
+    for (uint i = 0; i < maxSteps_; ++i) {
+      cpu2_.step();
+
+      if (cpu2_.PC() == cpu1_.PC() && cpu2_.A () == cpu1_.A () && cpu2_.X () == cpu1_.X () &&
+          cpu2_.Y () == cpu1_.Y () && cpu2_.SR() == cpu1_.SR() && cpu2_.SP() == cpu1_.SP()) {
+        getMemory(cpu2_, mem2);
+
+        if (mem1 == mem2)
+          return true;
+
+        break;
+      }
+    }
+
+    char buffer[128];
+
+    snprintf(buffer, sizeof(buffer), "Idle loop failed @ %04x\n", uint(cpu1_.PC()));
+
+    report_ = buffer;
+
+    return false;
+  }
+
+  // incremental hash of fast instance must match full hash of plain memory
+  bool checkHash() {
+    Data mem;
+
+    getMemory(cpu2_, mem);
+
+    ulong h = 0;
+
+    for (uint addr = 0; addr < 0x10000; ++addr)
+      h ^= C6502::byteHash(ushort(addr), mem[addr]);
+
+    if (cpu1_.memHash() == h)
+      return true;
+
+    report_ = "Memory hash mismatch\n";
+
+    return false;
+  }
+
+  static void getMemory(C6502 &cpu, Data &mem) {
+    mem.resize(0x10000);
+
+    for (uint addr = 0; addr < 0x10000; addr += 0x100)
+      cpu.memget(ushort(addr), &mem[addr], 0x100);
+  }
+
+ private:
+  C6502       cpu1_;
+  C6502       cpu2_;
+  Data        base_;
+  uint        maxSteps_ { 1000 };
+  ulong       numRuns_  { 0 };
+  uchar       edges_[0x10000];
+  uint        numEdges_ { 0 };
+  ulong       seed_     { 1 };
+  std::string report_;
+};
+
+#ifdef C6502_LIBFUZZER
+
+extern "C" int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  static C6502Fuzz fuzz;
+
+  bool newEdges;
+
+  if (! fuzz.runOne(data, size, newEdges)) {
+    fputs(fuzz.report().c_str(), stderr);
+    abort();
+  }
+
+  return 0;
+}
+
+#else
+
+int
+main(int argc, char **argv)
+{
+  C6502Fuzz::ulong runs    = 1000000;
+  double           seconds = 0.0;
+  C6502Fuzz::ulong seed    = 1;
+  uint             steps   = 1000;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+
+    if      (arg == "-runs" && i < argc - 1)
+      runs = C6502Fuzz::ulong(atol(argv[++i]));
+    else if (arg == "-time" && i < argc - 1)
+      seconds = atof(argv[++i]);
+    else if (arg == "-seed" && i < argc - 1)
+      seed = C6502Fuzz::ulong(atol(argv[++i]));
+    else if (arg == "-steps" && i < argc - 1)
+      steps = uint(atoi(argv[++i]));
+    else {
+      fprintf(stderr, "Usage: C6502Fuzz [-runs <n>] [-time <secs>] [-seed <n>] [-steps <n>]\n");
+      exit(1);
+    }
+  }
+
+  C6502Fuzz fuzz;
+
+  fuzz.setSeed(seed);
+  fuzz.setMaxSteps(steps);
+
+  std::vector<C6502Fuzz::Data> corpus;
+
+  C6502Fuzz::Data data, empty;
+
+  auto t1 = std::chrono::steady_clock::now();
+
+  C6502Fuzz::ulong run = 0, numFailed = 0;
+
+  for ( ; run < runs; ++run) {
+    fuzz.mutate(corpus.empty() ? empty : corpus[fuzz.rand() % corpus.size()], data);
+
+    bool newEdges;
+
+    if (! fuzz.runOne(&data[0], data.size(), newEdges)) {
+      // save failing input
+      char filename[64];
+
+      snprintf(filename, sizeof(filename), "crash-%lu.bin", numFailed++);
+
+      FILE *fp = fopen(filename, "wb");
+
+      if (fp) {
+        fwrite(&data[0], 1, data.size(), fp);
+        fclose(fp);
+      }
+
+      fprintf(stderr, "%s -> %s\n", fuzz.report().c_str(), filename);
+    }
+
+    if (newEdges)
+      corpus.push_back(data);
+
+    if (seconds > 0.0 && (run & 0xFFF) == 0) {
+      std::chrono::duration<double> d = std::chrono::steady_clock::now() - t1;
+
+      if (d.count() >= seconds)
+        break;
+    }
+  }
+
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - t1;
+
+  printf("%lu runs, %.0f runs/s, %u edges, %zu corpus, %lu failed\n",
+         run, double(run)/std::max(d.count(), 1e-9), fuzz.numEdges(), corpus.size(), numFailed);
+
+  return (numFailed ? 1 : 0);
+}
+
+#endif
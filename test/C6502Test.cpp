@@ -1,5 +1,205 @@
 #include <C6502Test.h>
 
+using Args = std::vector<std::string>;
+
+// cycles per screen frame (PAL C64: 63 cycles per line, 312 lines)
+static const ulong frameCycles = 63*312;
+
+// frame output file (format from extension .ppm, .y4m or .txt)
+struct Frames {
+  std::string         filename;
+  std::ofstream       os;
+  C6502Screen::Format format { C6502Screen::Format::TEXT };
+  uint                runAhead { 0 };
+
+  bool open() {
+    auto pos = filename.rfind('.');
+
+    std::string ext = (pos != std::string::npos ? filename.substr(pos + 1) : "");
+
+    if      (ext == "ppm") format = C6502Screen::Format::PPM;
+    else if (ext == "y4m") format = C6502Screen::Format::Y4M;
+    else                   format = C6502Screen::Format::TEXT;
+
+    os.open(filename.c_str(), std::ios::out | std::ios::binary);
+
+    if (! os) {
+      std::cerr << "Failed to open '" << filename << "'\n";
+      return false;
+    }
+
+    return true;
+  }
+
+  void close() {
+    if (os.is_open())
+      os.close();
+  }
+};
+
+// run for cycles from current PC outputting screen frames which changed
+static void
+runFrames(C6502 &cpu, C6502Screen &screen, Frames &frames, ulong cycles)
+{
+  ulong endT = cpu.t() + cycles;
+
+  // present frames run ahead (real state is restored after each frame)
+  if (frames.runAhead > 0) {
+    C6502RunAhead runAhead(&cpu, frames.runAhead, frameCycles);
+
+    while (cpu.t() < endT) {
+      if (! runAhead.runFrame([&]() { screen.updateFrame(frames.os, frames.format); }))
+        break;
+    }
+
+    return;
+  }
+
+  while (cpu.t() < endT) {
+    ulong t = cpu.t() + std::min(frameCycles, endT - cpu.t());
+
+    cpu.contCycles(t - cpu.t());
+
+    screen.updateFrame(frames.os, frames.format);
+
+    // stopped before end of frame (BRK, halt or breakpoint)
+    if (cpu.isHalt() || cpu.t() < t)
+      break;
+  }
+}
+
+// boot C64 BASIC, inject PRG files (run last) and run for cycles
+static void
+runC64(const Args &prgs, ulong cycles, bool idle, Frames &frames)
+{
+  C6502C64 cpu;
+
+  cpu.setIdleSkip(idle);
+
+  if (! cpu.bootBasic()) {
+    std::cerr << "C64 boot failed\n";
+    exit(1);
+  }
+
+  for (size_t i = 0; i < prgs.size(); ++i) {
+    if (! cpu.injectPrg(prgs[i], i == prgs.size() - 1)) {
+      std::cerr << "Failed to load '" << prgs[i] << "'\n";
+      exit(1);
+    }
+  }
+
+  if (frames.filename != "") {
+    // 40x25 text screen
+    C6502Screen screen(&cpu, 0x0400, 40, 25, C6502Screen::Mode::TEXT);
+
+    runFrames(cpu, screen, frames, cycles);
+  }
+  else
+    cpu.contCycles(cycles);
+}
+
+// run program in batched environment with random w/a/s/d actions and report rate
+static void
+runEnv(C6502 &cpu, ushort org, uint n, ulong cycles)
+{
+  auto state = std::make_shared<C6502::State>();
+
+  cpu.reset();
+
+  cpu.setPC(org);
+
+  cpu.saveState(*state);
+
+  C6502Env env(n, state);
+
+  static const char *keys = "wasd";
+
+  std::vector<C6502::uchar> actions(n);
+
+  uint  seed   = 1;
+  ulong nsteps = std::max(cycles/env.frameCycles(), 1UL);
+
+  auto t1 = std::chrono::steady_clock::now();
+
+  for (ulong step = 0; step < nsteps; ++step) {
+    for (uint i = 0; i < n; ++i) {
+      seed = seed*1103515245 + 12345;
+
+      actions[i] = C6502::uchar(keys[(seed >> 16) & 3]);
+    }
+
+    env.step(&actions[0]);
+  }
+
+  auto t2 = std::chrono::steady_clock::now();
+
+  double secs = std::chrono::duration<double>(t2 - t1).count();
+
+  uint ndone = 0;
+
+  for (uint i = 0; i < n; ++i)
+    if (env.isDone(i)) ++ndone;
+
+  std::cerr << std::dec << "Env: " << n << " instances, " << env.numThreads() << " threads, " <<
+               nsteps << " steps, " << ndone << " done, " <<
+               ulong(double(n*nsteps)/std::max(secs, 1e-9)) << " frames/s\n";
+}
+
+// CPU variant from name (nmos, 6502x (nmos with undocumented opcodes), cmos, 2a03)
+static bool
+stringToVariant(const std::string &str, C6502::Variant &variant, bool &undoc)
+{
+  undoc = false;
+
+  if      (str == "nmos") variant = C6502::Variant::NMOS;
+  else if (str == "6502x") { variant = C6502::Variant::NMOS; undoc = true; }
+  else if (str == "cmos") variant = C6502::Variant::CMOS;
+  else if (str == "2a03") variant = C6502::Variant::R2A03;
+  else {
+    std::cerr << "Invalid variant '" << str << "'\n";
+    return false;
+  }
+
+  return true;
+}
+
+// run program on second CPU (engine) in lockstep (compare after each block of instructions)
+static bool
+runLockstep(C6502 &cpu, ushort org, uint blockSize, ulong maxSteps, C6502::Variant variant2)
+{
+  C6502::State state;
+
+  cpu.reset();
+
+  cpu.setPC(org);
+
+  cpu.saveState(state);
+
+  C6502 cpu2;
+
+  cpu2.setVariant(variant2);
+  cpu2.setUnsupported(cpu.isUnsupported());
+  cpu2.setEnableOutputProcs(true);
+  cpu2.setIdleSkip(cpu.isIdleSkip());
+
+  cpu2.output().setProc([](const char *, size_t) { }); // output from first only
+
+  cpu2.restoreState(state);
+
+  C6502Lockstep lockstep(&cpu, &cpu2);
+
+  lockstep.setBlockSize(blockSize);
+
+  bool rc = lockstep.run(maxSteps);
+
+  cpu.output().flush();
+
+  if (! rc)
+    std::cerr << lockstep.report();
+
+  return rc;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -10,11 +210,28 @@ main(int argc, char **argv)
   ushort len         = 0x0100;
   bool   assemble    = false;
   bool   disassemble = false;
+  bool   analyze     = false;
+  bool   optimize    = false;
   bool   run         = false;
   bool   print       = false;
   bool   debug       = false;
+  bool   idle        = false;
+  bool   c64         = false;
+  ulong  cycles      = 1000000;
+  uint   envN        = 0;
+  uint   lockstepN   = 0;
+
+  C6502::Variant variant = C6502::Variant::NMOS, lockstepVariant = variant;
+  bool           lockstepVariantSet = false;
+  bool           undoc              = false;
+
+  std::string outFile;
+  Frames      frames;
 
-  using Args = std::vector<std::string>;
+  // input device ($fe random, $ff key)
+  bool        useInput = false;
+  ulong       seed     = 0;
+  std::string keys, recordFile, replayFile;
 
   Args args;
 
@@ -26,12 +243,18 @@ main(int argc, char **argv)
         assemble = true;
       else if (arg == "d")
         disassemble = true;
+      else if (arg == "analyze")
+        analyze = true;
+      else if (arg == "O" || arg == "optimize")
+        optimize = true;
       else if (arg == "r")
         run = true;
       else if (arg == "p")
         print = true;
       else if (arg == "D")
         debug = true;
+      else if (arg == "i" || arg == "idle")
+        idle = true;
       else if (arg == "o" || arg == "org") {
         ++i;
 
@@ -39,6 +262,87 @@ main(int argc, char **argv)
           org = ushort(atoi(argv[i]));
         }
       }
+      else if (arg == "ao" || arg == "aorg") {
+        ++i;
+
+        if (i < argc) {
+          aorg = ushort(atoi(argv[i]));
+        }
+      }
+      else if (arg == "c64")
+        c64 = true;
+      else if (arg == "cycles") {
+        ++i;
+
+        if (i < argc) {
+          cycles = ulong(atol(argv[i]));
+        }
+      }
+      else if (arg == "seed" || arg == "keys" || arg == "record" || arg == "replay") {
+        ++i;
+
+        if (i < argc) {
+          if      (arg == "seed"  ) seed       = ulong(atol(argv[i]));
+          else if (arg == "keys"  ) keys       = argv[i];
+          else if (arg == "record") recordFile = argv[i];
+          else                      replayFile = argv[i];
+        }
+
+        useInput = true;
+      }
+      else if (arg == "lockstep") {
+        ++i;
+
+        if (i < argc) {
+          lockstepN = uint(atoi(argv[i]));
+        }
+      }
+      else if (arg == "variant" || arg == "lockstep_variant") {
+        ++i;
+
+        if (i < argc) {
+          if (arg == "variant") {
+            if (! stringToVariant(argv[i], variant, undoc))
+              exit(1);
+          }
+          else {
+            bool undoc2;
+
+            if (! stringToVariant(argv[i], lockstepVariant, undoc2))
+              exit(1);
+
+            lockstepVariantSet = true;
+          }
+        }
+      }
+      else if (arg == "env") {
+        ++i;
+
+        if (i < argc) {
+          envN = uint(atoi(argv[i]));
+        }
+      }
+      else if (arg == "runahead") {
+        ++i;
+
+        if (i < argc) {
+          frames.runAhead = uint(atoi(argv[i]));
+        }
+      }
+      else if (arg == "frames") {
+        ++i;
+
+        if (i < argc) {
+          frames.filename = argv[i];
+        }
+      }
+      else if (arg == "out") {
+        ++i;
+
+        if (i < argc) {
+          outFile = argv[i];
+        }
+      }
       else if (arg == "l" || arg == "len") {
         ++i;
 
@@ -56,19 +360,64 @@ main(int argc, char **argv)
     }
   }
 
+  if (frames.filename != "" && ! frames.open())
+    exit(1);
+
+  if (c64) {
+    runC64(args, cycles, idle, frames);
+
+    frames.close();
+
+    exit(0);
+  }
+
+  cpu.setVariant(variant);
+
+  if (undoc)
+    cpu.setUnsupported(true);
+
   if (debug)
     cpu.setDebug(true);
 
+  if (idle)
+    cpu.setIdleSkip(true);
+
+  if (optimize)
+    cpu.setOptimize(true);
+
   cpu.setEnableOutputProcs(true);
 
+  FILE *outFp = nullptr;
+
+  if (outFile != "") {
+    outFp = fopen(outFile.c_str(), "w");
+
+    if (! outFp) {
+      std::cerr << "Failed to open '" << outFile << "'\n";
+      exit(1);
+    }
+
+    cpu.output().setFile(outFp);
+  }
+
   if (assemble) {
     std::cerr << "--- Assemble ---\n";
 
-    for (const auto &arg : args) {
-      std::ifstream ifs(arg.c_str(), std::ios::in);
+    for (const auto &arg : args)
+      cpu.assembleFile(aorg, arg, len);
+  }
 
-      cpu.assemble(aorg, ifs, len);
-    }
+  if (analyze) {
+    std::cerr << "--- Analyze ---\n";
+
+    // subroutine cycles from run org
+    C6502Analyze analyzer(&cpu);
+
+    analyzer.addEntry(org);
+
+    analyzer.analyze();
+
+    analyzer.print(std::cerr);
   }
 
   if (disassemble) {
@@ -77,10 +426,59 @@ main(int argc, char **argv)
     cpu.disassemble(org);
   }
 
+  std::unique_ptr<C6502Input> input;
+
+  if (useInput) {
+    input = std::make_unique<C6502Input>(&cpu);
+
+    input->setSeed(seed);
+    input->addKeys(keys);
+
+    if (replayFile != "") {
+      C6502Input::Log log;
+
+      if (! C6502Input::loadLog(replayFile, log)) {
+        std::cerr << "Failed to load '" << replayFile << "'\n";
+        exit(1);
+      }
+
+      input->startReplay(log);
+    }
+  }
+
   if (run) {
     std::cerr << "--- Run ---\n";
 
-    cpu.run(org);
+    // default lockstep variant from program (CPU directive)
+    if (! lockstepVariantSet)
+      lockstepVariant = cpu.variant();
+
+    if      (lockstepN > 0) {
+      if (! runLockstep(cpu, org, lockstepN, cycles, lockstepVariant))
+        exit(1);
+    }
+    else if (envN > 0)
+      runEnv(cpu, org, envN, cycles);
+    else if (frames.filename != "") {
+      // snake style 32x32 pixel screen
+      C6502Screen screen(&cpu, 0x0200, 32, 32, C6502Screen::Mode::PIXEL);
+
+      cpu.reset();
+
+      cpu.setPC(org);
+
+      runFrames(cpu, screen, frames, cycles);
+    }
+    else
+      cpu.run(org);
+  }
+
+  if (input) {
+    if (recordFile != "" && ! input->saveLog(recordFile))
+      std::cerr << "Failed to save '" << recordFile << "'\n";
+
+    if (input->isReplay() && (input->numMismatches() || ! input->isReplayDone()))
+      std::cerr << "Replay diverged (" << input->numMismatches() << " mismatches)\n";
   }
 
   if (print) {
@@ -89,5 +487,13 @@ main(int argc, char **argv)
     cpu.print(org, len);
   }
 
+  if (outFp) {
+    cpu.output().flush();
+
+    fclose(outFp);
+  }
+
+  frames.close();
+
   exit(0);
 }
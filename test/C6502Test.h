@@ -1,4 +1,13 @@
 #include <C6502.h>
+#include <C6502Analyze.h>
+#include <C6502C64.h>
+#include <C6502Screen.h>
+#include <C6502Input.h>
+#include <C6502Env.h>
+#include <C6502RunAhead.h>
+#include <C6502Lockstep.h>
+#include <chrono>
 #include <fstream>
+#include <memory>
 #include <vector>
 #include <string>
@@ -0,0 +1,647 @@
+#include <C6502.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Exhaustive ALU check.
+//
+// Runs every A x operand x C x D combination of ADC, SBC and CMP (immediate), and the
+// undocumented immediate instructions (ANC, ALR, ARR, AXS, SBC $EB, XAA, LAX) through
+// the CPU instruction path and compares A, X and SR against a reference NMOS model (X is
+// set from A for each case). ADC and SBC are also checked against a 65C02 model. Work is
+// split by A value over all cores.
+//
+// Also checks the cycles of every NMOS opcode (base, page cross and branch taken)
+// against a reference cycle table (plus the 65C02 decimal ADC/SBC cycle), and the value and address (page cross corruption)
+// of the unstable stores AHX, SHX, SHY and TAS. Exits with 1 if any result differs.
+namespace {
+
+using uchar = C6502::uchar;
+using schar = C6502::schar;
+
+struct Result {
+  uchar A  { 0 };
+  uchar X  { 0 };
+  uchar SR { 0 };
+};
+
+// X register for A value (spread so A AND X varies)
+uchar sweepX(uint a) { return uchar(a*0x1D + 0x35); }
+
+// set N/V/Z/C in status register
+uchar setFlags(uchar sr, bool N, bool V, bool Z, bool C) {
+  return uchar((sr & ~0xC3) | (N ? 0x80 : 0) | (V ? 0x40 : 0) | (Z ? 0x02 : 0) | (C ? 0x01 : 0));
+}
+
+//---
+
+// Reference model (NMOS 6502, decimal sequences from "Decimal Mode" by Bruce Clark)
+
+Result refAdc(uchar a, uchar x, uchar b, uchar sr) {
+  bool C = (sr & 0x01);
+  bool D = (sr & 0x08);
+
+  int  res;
+  bool N, V, Z, C1;
+
+  if (! D) {
+    res = a + b + C;
+
+    C1 = (res > 0xFF);
+    V  = (int(schar(a)) + int(schar(b)) + C < -128 ||
+          int(schar(a)) + int(schar(b)) + C >  127);
+    N  = (res & 0x80);
+    Z  = ((res & 0xFF) == 0);
+  }
+  else {
+    // seq. 1 (result and carry)
+    int al = (a & 0x0F) + (b & 0x0F) + C;
+
+    if (al >= 0x0A)
+      al = ((al + 0x06) & 0x0F) + 0x10;
+
+    res = (a & 0xF0) + (b & 0xF0) + al;
+
+    if (res >= 0xA0)
+      res += 0x60;
+
+    C1 = (res >= 0x100);
+
+    // seq. 2 (N and V from signed high digit add)
+    int s = int(schar(a & 0xF0)) + int(schar(b & 0xF0)) + al;
+
+    N = (s & 0x80);
+    V = (s < -128 || s > 127);
+
+    // Z from binary add
+    Z = (((a + b + C) & 0xFF) == 0);
+  }
+
+  return Result { uchar(res), x, setFlags(sr, N, V, Z, C1) };
+}
+
+Result refSbc(uchar a, uchar x, uchar b, uchar sr) {
+  bool C = (sr & 0x01);
+  bool D = (sr & 0x08);
+
+  // flags always from binary subtract
+  int bin = a - b - (C ? 0 : 1);
+
+  int  sres = int(schar(a)) - int(schar(b)) - (C ? 0 : 1);
+  bool V    = (sres < -128 || sres > 127);
+  bool N    = (bin & 0x80);
+  bool Z    = ((bin & 0xFF) == 0);
+  bool C1   = (bin >= 0);
+
+  int res = bin;
+
+  if (D) {
+    // seq. 3
+    int al = (a & 0x0F) - (b & 0x0F) + C - 1;
+
+    if (al < 0)
+      al = ((al - 0x06) & 0x0F) - 0x10;
+
+    res = (a & 0xF0) - (b & 0xF0) + al;
+
+    if (res < 0)
+      res -= 0x60;
+  }
+
+  return Result { uchar(res), x, setFlags(sr, N, V, Z, C1) };
+}
+
+// Reference model (65C02, N and Z from decimal result, SBC decimal seq. 4)
+
+Result refAdcCmos(uchar a, uchar x, uchar b, uchar sr) {
+  Result r = refAdc(a, x, b, sr);
+
+  r.SR = setFlags(r.SR, r.A & 0x80, r.SR & 0x40, r.A == 0, r.SR & 0x01);
+
+  return r;
+}
+
+Result refSbcCmos(uchar a, uchar x, uchar b, uchar sr) {
+  Result r = refSbc(a, x, b, sr);
+
+  bool C = (sr & 0x01);
+  bool D = (sr & 0x08);
+
+  if (D) {
+    // seq. 4
+    int al  = (a & 0x0F) - (b & 0x0F) + C - 1;
+    int res = a - b + C - 1;
+
+    if (res < 0)
+      res -= 0x60;
+
+    if (al < 0)
+      res -= 0x06;
+
+    r.A = uchar(res);
+  }
+
+  r.SR = setFlags(r.SR, r.A & 0x80, r.SR & 0x40, r.A == 0, r.SR & 0x01);
+
+  return r;
+}
+
+Result refCmp(uchar a, uchar x, uchar b, uchar sr) {
+  uchar t = uchar(a - b);
+
+  return Result { a, x, setFlags(sr, t & 0x80, sr & 0x40, t == 0, a >= b) };
+}
+
+// undocumented (immediate)
+
+Result refAnc(uchar a, uchar x, uchar b, uchar sr) {
+  uchar t = a & b;
+
+  return Result { t, x, setFlags(sr, t & 0x80, sr & 0x40, t == 0, t & 0x80) };
+}
+
+Result refAlr(uchar a, uchar x, uchar b, uchar sr) {
+  uchar t = a & b;
+  uchar r = uchar(t >> 1);
+
+  return Result { r, x, setFlags(sr, false, sr & 0x40, r == 0, t & 0x01) };
+}
+
+Result refArr(uchar a, uchar x, uchar b, uchar sr) {
+  bool C = (sr & 0x01);
+  bool D = (sr & 0x08);
+
+  int t = a & b;
+  int r = (t >> 1) | (C ? 0x80 : 0);
+
+  if (! D)
+    return Result { uchar(r), x, setFlags(sr, r & 0x80, ((r >> 6) ^ (r >> 5)) & 1, r == 0, r & 0x40) };
+
+  // decimal ("NMOS 6510 Unintended Opcodes")
+  bool N = C;
+  bool Z = (r == 0);
+  bool V = ((t ^ r) & 0x40);
+
+  int al = t & 0x0F, ah = t >> 4;
+
+  if (al + (al & 1) > 5)
+    r = (r & 0xF0) | ((r + 6) & 0x0F);
+
+  bool C1 = (ah + (ah & 1) > 5);
+
+  if (C1)
+    r = (r + 0x60) & 0xFF;
+
+  return Result { uchar(r), x, setFlags(sr, N, V, Z, C1) };
+}
+
+Result refAxs(uchar a, uchar x, uchar b, uchar sr) {
+  int t = (a & x) - b;
+
+  return Result { a, uchar(t), setFlags(sr, t & 0x80, sr & 0x40, (t & 0xFF) == 0, t >= 0) };
+}
+
+// unstable immediate ('magic' constant used by CPU)
+const uchar magic = 0xEE;
+
+Result refXaa(uchar a, uchar x, uchar b, uchar sr) {
+  uchar t = (a | magic) & x & b;
+
+  return Result { t, x, setFlags(sr, t & 0x80, sr & 0x40, t == 0, sr & 0x01) };
+}
+
+Result refLax(uchar a, uchar, uchar b, uchar sr) {
+  uchar t = (a | magic) & b;
+
+  return Result { t, t, setFlags(sr, t & 0x80, sr & 0x40, t == 0, sr & 0x01) };
+}
+
+//---
+
+struct Sweep {
+  const char *name;
+  uchar       opcode;
+  Result    (*ref)(uchar, uchar, uchar, uchar);
+  C6502::Variant variant { C6502::Variant::NMOS };
+
+  std::atomic<ulong>       numCases      { 0 };
+  std::atomic<ulong>       numMismatches { 0 };
+  std::mutex               mutex;
+  std::vector<std::string> report;
+};
+
+const uint maxReport = 8;
+
+void
+sweepRange(Sweep &sweep, uint a1, uint a2)
+{
+  C6502 cpu;
+
+  cpu.setVariant(sweep.variant);
+  cpu.setUnsupported(true);
+
+  const C6502::ushort addr = 0x0200;
+
+  cpu.setByte(addr, sweep.opcode);
+
+  ulong numCases = 0, numMismatches = 0;
+
+  for (uint a = a1; a < a2; ++a) {
+    for (uint b = 0; b < 0x100; ++b) {
+      cpu.setByte(addr + 1, uchar(b));
+
+      for (uint flags = 0; flags < 4; ++flags) {
+        // unused (0x20) and I flags set, C and D from sweep
+        uchar sr = uchar(0x24 | ((flags & 1) ? 0x01 : 0) | ((flags & 2) ? 0x08 : 0));
+
+        uchar x = sweepX(a);
+
+        cpu.setPC(addr);
+        cpu.setA (uchar(a));
+        cpu.setX (x);
+        cpu.setSR(sr);
+
+        cpu.step();
+
+        Result res = sweep.ref(uchar(a), x, uchar(b), sr);
+
+        ++numCases;
+
+        if (cpu.A() == res.A && cpu.X() == res.X && cpu.SR() == res.SR)
+          continue;
+
+        ++numMismatches;
+
+        std::lock_guard<std::mutex> lock(sweep.mutex);
+
+        if (sweep.report.size() < maxReport) {
+          char buffer[128];
+
+          snprintf(buffer, sizeof(buffer),
+                   "%s A=%02X X=%02X M=%02X C=%d D=%d : "
+                   "A=%02X X=%02X SR=%02X expected A=%02X X=%02X SR=%02X",
+                   sweep.name, a, uint(x), b, flags & 1, (flags >> 1) & 1,
+                   uint(cpu.A()), uint(cpu.X()), uint(cpu.SR()),
+                   uint(res.A), uint(res.X), uint(res.SR));
+
+          sweep.report.push_back(buffer);
+        }
+      }
+    }
+  }
+
+  sweep.numCases      += numCases;
+  sweep.numMismatches += numMismatches;
+}
+
+//---
+
+// NMOS cycles (0 is KIL), page cross adds one for indexed reads
+const uchar nmosCycles[256] = {
+/*        0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F */
+/* 0 */   7, 6, 0, 8, 3, 3, 5, 5, 3, 2, 2, 2, 4, 4, 6, 6,
+/* 1 */   2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* 2 */   6, 6, 0, 8, 3, 3, 5, 5, 4, 2, 2, 2, 4, 4, 6, 6,
+/* 3 */   2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* 4 */   6, 6, 0, 8, 3, 3, 5, 5, 3, 2, 2, 2, 3, 4, 6, 6,
+/* 5 */   2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* 6 */   6, 6, 0, 8, 3, 3, 5, 5, 4, 2, 2, 2, 5, 4, 6, 6,
+/* 7 */   2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* 8 */   2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4,
+/* 9 */   2, 6, 0, 6, 4, 4, 4, 4, 2, 5, 2, 5, 5, 5, 5, 5,
+/* A */   2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4,
+/* B */   2, 5, 0, 5, 4, 4, 4, 4, 2, 4, 2, 4, 4, 4, 4, 4,
+/* C */   2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6,
+/* D */   2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* E */   2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6,
+/* F */   2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+};
+
+// opcode has page cross penalty (indexed read)
+bool isPageCrossOp(uint op) {
+  switch (op) {
+    case 0x11: case 0x31: case 0x51: case 0x71: case 0xB1: case 0xD1: case 0xF1: case 0xB3:
+    case 0x19: case 0x39: case 0x59: case 0x79: case 0xB9: case 0xD9: case 0xF9:
+    case 0xBE: case 0xBF: case 0xBB:
+    case 0x1D: case 0x3D: case 0x5D: case 0x7D: case 0xBD: case 0xDD: case 0xFD: case 0xBC:
+    case 0x1C: case 0x3C: case 0x5C: case 0x7C: case 0xDC: case 0xFC:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool isBranchOp(uint op) { return (op & 0x1F) == 0x10; }
+
+// run opcode at address with operand bytes (index registers and status given)
+ulong opCycles(C6502 &cpu, uint op, C6502::ushort addr, uchar lo, uchar hi,
+               uchar ind, uchar sr) {
+  cpu.setByte(addr, uchar(op));
+  cpu.setByte(addr + 1, lo);
+  cpu.setByte(addr + 2, hi);
+
+  cpu.setPC(addr);
+  cpu.setX (ind);
+  cpu.setY (ind);
+  cpu.setSP(0xF0);
+  cpu.setSR(sr);
+
+  cpu.setBreak(false);
+
+  ulong t = cpu.t();
+
+  cpu.step();
+
+  return cpu.t() - t;
+}
+
+ulong
+checkCycles(std::vector<std::string> &report)
+{
+  C6502 cpu;
+
+  cpu.setUnsupported(true);
+
+  // zero page pointer $10 -> $0310 and $20 -> $02F0 (crosses page with index $FF)
+  cpu.setByte(0x10, 0x10); cpu.setByte(0x11, 0x03);
+  cpu.setByte(0x20, 0xF0); cpu.setByte(0x21, 0x02);
+
+  ulong numMismatches = 0;
+
+  auto check = [&](uint op, const char *desc, ulong t, ulong t1) {
+    if (t == t1) return;
+
+    ++numMismatches;
+
+    char buffer[128];
+
+    snprintf(buffer, sizeof(buffer), "Cycles %02X %s : %lu expected %lu", op, desc, t, t1);
+
+    report.push_back(buffer);
+  };
+
+  for (uint op = 0; op < 0x100; ++op) {
+    // skip KIL and RTI (needs interrupt)
+    if (nmosCycles[op] == 0 || op == 0x40)
+      continue;
+
+    if (isBranchOp(op)) {
+      // all flags clear or set so branch is taken in one
+      for (uchar sr : { uchar(0x24), uchar(0xE7) }) {
+        ulong t     = opCycles(cpu, op, 0x0200, 0x10, 0x00, 0x00, sr);
+        bool  taken = (cpu.PC() != 0x0202);
+
+        check(op, taken ? "taken" : "not taken", t, nmosCycles[op] + (taken ? 1 : 0));
+
+        if (taken) {
+          // branch from $02F0 to $0371
+          t = opCycles(cpu, op, 0x02F0, 0x7F, 0x00, 0x00, sr);
+
+          check(op, "taken page cross", t, nmosCycles[op] + 2);
+        }
+      }
+
+      continue;
+    }
+
+    // operand $0310 or zero page $10, no index
+    ulong t = opCycles(cpu, op, 0x0200, 0x10, 0x03, 0x00, 0x24);
+
+    check(op, "", t, nmosCycles[op]);
+
+    if (isPageCrossOp(op)) {
+      // operand $02F0 or zero page pointer $20 ($02F0), index $FF
+      bool indirect = ((op & 0x1F) == 0x11 || (op & 0x1F) == 0x13);
+
+      t = opCycles(cpu, op, 0x0200, indirect ? 0x20 : 0xF0, 0x02, 0xFF, 0x24);
+
+      check(op, "page cross", t, nmosCycles[op] + 1);
+    }
+  }
+
+  // 65C02 decimal ADC/SBC take one extra cycle
+  C6502 cmos;
+
+  cmos.setVariant(C6502::Variant::CMOS);
+
+  cmos.setByte(0x10, 0x10); cmos.setByte(0x11, 0x03);
+
+  for (uint op : { 0x61, 0x65, 0x69, 0x6D, 0x71, 0x72, 0x75, 0x79, 0x7D,
+                   0xE1, 0xE5, 0xE9, 0xED, 0xF1, 0xF2, 0xF5, 0xF9, 0xFD }) {
+    // (zero page) is 5 cycles
+    ulong t1 = ((op & 0x1F) == 0x12 ? 5 : nmosCycles[op]);
+
+    ulong t = opCycles(cmos, op, 0x0200, 0x10, 0x03, 0x00, 0x24);
+
+    check(op, "65C02", t, t1);
+
+    t = opCycles(cmos, op, 0x0200, 0x10, 0x03, 0x00, 0x2C);
+
+    check(op, "65C02 decimal", t, t1 + 1);
+  }
+
+  return numMismatches;
+}
+
+
+//---
+
+// unstable stores (value AND high byte of base plus one, on page cross the value
+// replaces the high byte of the address)
+ulong
+checkStores(std::vector<std::string> &report)
+{
+  C6502 cpu;
+
+  cpu.setUnsupported(true);
+
+  // code above stores, zero page pointer $F0 -> base (page cross low bytes are < $F0)
+  const C6502::ushort addr = 0x8000;
+  const C6502::ushort base = 0x12F0;
+
+  cpu.setByte(0xF0, uchar(base & 0xFF));
+  cpu.setByte(0xF1, uchar(base >> 8));
+
+  const uchar high = uchar((base >> 8) + 1);
+
+  ulong numMismatches = 0;
+
+  for (uint op : { 0x93, 0x9F, 0x9C, 0x9E, 0x9B }) {
+    cpu.setByte(addr, uchar(op));
+
+    if (op == 0x93)
+      cpu.setByte(addr + 1, 0xF0);
+    else {
+      cpu.setByte(addr + 1, uchar(base & 0xFF));
+      cpu.setByte(addr + 2, uchar(base >> 8));
+    }
+
+    for (uint ind = 0; ind < 0x100; ++ind) {
+      for (uint v = 0; v < 0x100; ++v) {
+        // SHY indexed by X, others by Y
+        uchar a = uchar(v), x = sweepX(v), y = uchar(ind);
+
+        if      (op == 0x9C) { x = uchar(ind); y = uchar(v); }
+        else if (op == 0x9E) { x = uchar(v); }
+
+        uchar sp = (op == 0x9B ? uchar(a & x) : uchar(0xF0));
+
+        uchar value;
+
+        switch (op) {
+          case 0x9C: value = y     ; break; // SHY
+          case 0x9E: value = x     ; break; // SHX
+          case 0x9B: value = sp    ; break; // TAS
+          default  : value = a & x ; break; // AHX
+        }
+
+        value &= high;
+
+        C6502::ushort a1 = C6502::ushort(base + ind);
+
+        if ((a1 & 0xFF00) != (base & 0xFF00))
+          a1 = C6502::ushort((value << 8) | (a1 & 0xFF));
+
+        cpu.setByte(a1, uchar(~value));
+
+        cpu.setPC(addr);
+        cpu.setA (a);
+        cpu.setX (x);
+        cpu.setY (y);
+        cpu.setSP(0xF0);
+        cpu.setSR(0x24);
+
+        cpu.step();
+
+        if (cpu.getByte(a1) == value && cpu.SP() == sp)
+          continue;
+
+        ++numMismatches;
+
+        if (report.size() < maxReport) {
+          char buffer[128];
+
+          snprintf(buffer, sizeof(buffer),
+                   "Store %02X A=%02X X=%02X Y=%02X : $%04X=%02X SP=%02X expected %02X SP=%02X",
+                   op, uint(a), uint(x), uint(y), uint(a1), uint(cpu.getByte(a1)),
+                   uint(cpu.SP()), uint(value), uint(sp));
+
+          report.push_back(buffer);
+        }
+      }
+    }
+  }
+
+  return numMismatches;
+}
+
+}
+
+int
+main(int argc, char **argv)
+{
+  uint numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+
+    if (arg == "-threads" && i < argc - 1)
+      numThreads = std::max(uint(atoi(argv[++i])), 1U);
+    else {
+      fprintf(stderr, "Usage: C6502Verify [-threads <n>]\n");
+      exit(1);
+    }
+  }
+
+  numThreads = std::min(numThreads, 256U);
+
+  Sweep sweeps[13];
+
+  auto initSweep = [&](uint i, const char *name, uchar opcode,
+                       Result (*ref)(uchar, uchar, uchar, uchar),
+                       C6502::Variant variant=C6502::Variant::NMOS) {
+    sweeps[i].name = name; sweeps[i].opcode = opcode; sweeps[i].ref = ref;
+    sweeps[i].variant = variant;
+  };
+
+  initSweep( 0, "ADC"    , 0x69, refAdc);
+  initSweep( 1, "SBC"    , 0xE9, refSbc);
+  initSweep( 2, "CMP"    , 0xC9, refCmp);
+  initSweep( 3, "ANC $0B", 0x0B, refAnc);
+  initSweep( 4, "ANC $2B", 0x2B, refAnc);
+  initSweep( 5, "ALR"    , 0x4B, refAlr);
+  initSweep( 6, "ARR"    , 0x6B, refArr);
+  initSweep( 7, "AXS"    , 0xCB, refAxs);
+  initSweep( 8, "SBC $EB", 0xEB, refSbc);
+  initSweep( 9, "XAA"    , 0x8B, refXaa);
+  initSweep(10, "LAX #"  , 0xAB, refLax);
+  initSweep(11, "ADC 65C02", 0x69, refAdcCmos, C6502::Variant::CMOS);
+  initSweep(12, "SBC 65C02", 0xE9, refSbcCmos, C6502::Variant::CMOS);
+
+  auto t1 = std::chrono::steady_clock::now();
+
+  // split each sweep by A value
+  std::vector<std::thread> threads;
+
+  for (auto &sweep : sweeps) {
+    for (uint i = 0; i < numThreads; ++i) {
+      uint a1 = (i      *0x100)/numThreads;
+      uint a2 = ((i + 1)*0x100)/numThreads;
+
+      threads.emplace_back(sweepRange, std::ref(sweep), a1, a2);
+    }
+
+    // limit to one sweep in flight per core
+    for (auto &thread : threads)
+      thread.join();
+
+    threads.clear();
+  }
+
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - t1;
+
+  ulong numMismatches = 0;
+
+  for (auto &sweep : sweeps) {
+    printf("%s: %lu cases, %lu mismatches\n", sweep.name,
+           sweep.numCases.load(), sweep.numMismatches.load());
+
+    std::sort(sweep.report.begin(), sweep.report.end());
+
+    for (const auto &line : sweep.report)
+      printf("  %s\n", line.c_str());
+
+    numMismatches += sweep.numMismatches;
+  }
+
+  std::vector<std::string> cycleReport;
+
+  ulong numCycleMismatches = checkCycles(cycleReport);
+
+  printf("Cycles: %lu mismatches\n", numCycleMismatches);
+
+  for (const auto &line : cycleReport)
+    printf("  %s\n", line.c_str());
+
+  numMismatches += numCycleMismatches;
+
+  std::vector<std::string> storeReport;
+
+  ulong numStoreMismatches = checkStores(storeReport);
+
+  printf("Stores: %lu mismatches\n", numStoreMismatches);
+
+  for (const auto &line : storeReport)
+    printf("  %s\n", line.c_str());
+
+  numMismatches += numStoreMismatches;
+
+  printf("%.3fs (%u threads)\n", d.count(), numThreads);
+
+  return (numMismatches ? 1 : 0);
+}